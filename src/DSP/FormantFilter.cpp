@@ -13,6 +13,7 @@
 
 #include <cmath>
 #include <cstdio>
+#include <cstring>
 #include "../Misc/Util.h"
 #include "../Misc/Allocator.h"
 #include "FormantFilter.h"
@@ -21,12 +22,40 @@
 
 namespace zyn {
 
-FormantFilter::FormantFilter(const FilterParams *pars, Allocator *alloc, unsigned int srate, int bufsize)
-    :Filter(srate, bufsize), memory(*alloc)
+const float MAX_FREQ = 20000.0f;
+
+//constants of Value_Smoothing_Filter::apply()
+const float AMP_SMOOTH_A      = 0.07f;
+const float AMP_SMOOTH_THRESH = 0.0001f;
+
+FormantFilter::FormantFilter(const FilterParams *pars, Allocator */*alloc*/, unsigned int srate, int bufsize)
+    :Filter(srate, bufsize), freqbufsize(bufsize/8)
 {
     numformants = pars->Pnumformants;
-    for(int i = 0; i < numformants; ++i)
-        formant[i] = memory.alloc<AnalogFilter>(4 /*BPF*/, 1000.0f, 10.0f, pars->Pstages, srate, bufsize);
+    if(numformants > FF_MAX_FORMANTS)
+        numformants = FF_MAX_FORMANTS;
+    nlanes = (numformants + 3) & ~3;
+    if(nlanes > FF_MAX_FORMANTS)
+        nlanes = FF_MAX_FORMANTS;
+
+    stages = pars->Pstages;
+    if(stages >= MAX_FILTER_STAGES)
+        stages = MAX_FILTER_STAGES;
+
+    //unused lanes keep zero coefficients and a zero amplitude
+    memset(&coeff, 0, sizeof(coeff));
+    for(int i = 0; i < FF_MAX_FORMANTS; ++i) {
+        bpf[i].freq            = 1000.0f;
+        bpf[i].q               = 10.0f;
+        bpf[i].newq            = 10.0f;
+        bpf[i].recompute       = true;
+        bpf[i].beforeFirstTick = true;
+        freq_smoothing[i].sample_rate(samplerate_f/8);
+        freq_smoothing[i].thresh(2.0f); // 2Hz
+        freq_smoothing[i].reset(1000.0f);
+        amp_g1[i] = amp_g2[i] = i < numformants ? 1.0f : 0.0f;
+    }
+    amp_w = 10.0f / (srate * 0.05f);
     cleanup();
 
     for(int j = 0; j < FF_MAX_VOWELS; ++j)
@@ -39,12 +68,6 @@ FormantFilter::FormantFilter(const FilterParams *pars, Allocator *alloc, unsigne
                 pars->Pvowels[j].formants[i].q);
         }
 
-    for(int i = 0; i < FF_MAX_FORMANTS; ++i)
-    {
-        formant_amp_smoothing[i].sample_rate(srate);
-        formant_amp_smoothing[i].reset(1.0f);
-    }
-
     for(int i = 0; i < numformants; ++i) {
         currentformants[i].freq = 1000.0f;
         currentformants[i].amp  = 1.0f;
@@ -74,15 +97,48 @@ FormantFilter::FormantFilter(const FilterParams *pars, Allocator *alloc, unsigne
 }
 
 FormantFilter::~FormantFilter()
+{}
+
+void FormantFilter::cleanup()
 {
-    for(int i = 0; i < numformants; ++i)
-        memory.dealloc(formant[i]);
+    memset(history, 0, sizeof(history));
 }
 
-void FormantFilter::cleanup()
+void FormantFilter::computecoefs(int n, float frequency)
 {
-    for(int i = 0; i < numformants; ++i)
-        formant[i]->cleanup();
+    int order;
+    const AnalogFilter::Coeff c = AnalogFilter::computeCoeff(4 /*BPF*/,
+            frequency, bpf[n].q, stages, 1.0f, samplerate_f, order);
+    coeff.c0[n] = c.c[0];
+    coeff.c2[n] = c.c[2];
+    coeff.d1[n] = c.d[1];
+    coeff.d2[n] = c.d[2];
+}
+
+void FormantFilter::setformant(int n, float frequency, float q_)
+{
+    bpf[n].newq = q_;
+    const float q = bpf[n].q;
+    if(q == 0.0f || q_ == 0.0f || ((q > q_ ? q / q_ : q_ / q) > 1.1f))
+        bpf[n].recompute = true;
+
+    if(frequency < 0.1f)
+        frequency = 0.1f;
+    else if(frequency > MAX_FREQ)
+        frequency = MAX_FREQ;
+    frequency = ceilf(frequency);
+
+    if(fabsf(frequency - bpf[n].freq) >= 1.0f) {
+        bpf[n].freq      = frequency;
+        bpf[n].recompute = true;
+    }
+    if(bpf[n].recompute)
+        bpf[n].q = bpf[n].newq;
+
+    if(bpf[n].beforeFirstTick) {
+        freq_smoothing[n].reset(bpf[n].freq);
+        bpf[n].beforeFirstTick = false;
+    }
 }
 
 inline float log_2(float x)
@@ -140,8 +196,8 @@ void FormantFilter::setpos(float frequency)
                 * (1.0f - pos) + formantpar[p2][i].amp * pos;
             currentformants[i].q =
                 formantpar[p1][i].q * (1.0f - pos) + formantpar[p2][i].q * pos;
-            formant[i]->setfreq_and_q(currentformants[i].freq,
-                                      currentformants[i].q * Qfactor);
+            setformant(i, currentformants[i].freq,
+                       currentformants[i].q * Qfactor);
         }
         firsttime = false;
     }
@@ -165,8 +221,8 @@ void FormantFilter::setpos(float frequency)
                                       * pos) * formantslowness;
 
 
-            formant[i]->setfreq_and_q(currentformants[i].freq,
-                                      currentformants[i].q * Qfactor);
+            setformant(i, currentformants[i].freq,
+                       currentformants[i].q * Qfactor);
         }
 
     oldQfactor = Qfactor;
@@ -180,8 +236,10 @@ void FormantFilter::setfreq(float frequency)
 void FormantFilter::setq(float q_)
 {
     Qfactor = q_;
-    for(int i = 0; i < numformants; ++i)
-        formant[i]->setq(Qfactor * currentformants[i].q);
+    for(int i = 0; i < numformants; ++i) {
+        bpf[i].newq = bpf[i].q = Qfactor * currentformants[i].q;
+        computecoefs(i, bpf[i].freq);
+    }
 }
 
 void FormantFilter::setgain(float /*dBgain*/)
@@ -194,34 +252,86 @@ void FormantFilter::setfreq_and_q(float frequency, float q_)
 }
 
 
-void FormantFilter::filterout(float *smp)
+/*
+ * Runs all formants over nsmps samples with the current coefficients.
+ * The inner loops go across the formants, so they map to SIMD lanes.
+ */
+void FormantFilter::filterblock(float *smp, int nsmps,
+                                const float *ampw, const float *ampgm)
 {
-    float inbuffer[buffersize];
+    const int n = nlanes;
+    for(int i = 0; i < nsmps; ++i) {
+        float v[FF_MAX_FORMANTS];
+        const float in = smp[i] * outgain;
+        for(int k = 0; k < n; ++k)
+            v[k] = in;
+
+        for(int s = 0; s < stages + 1; ++s) {
+            auto &h = history[s];
+            for(int k = 0; k < n; ++k) {
+                const float y = coeff.c0[k] * v[k] + coeff.c2[k] * h.x2[k]
+                                + coeff.d1[k] * h.y1[k] + coeff.d2[k] * h.y2[k];
+                h.x2[k] = h.x1[k];
+                h.x1[k] = v[k];
+                h.y2[k] = h.y1[k];
+                h.y1[k] = y;
+                v[k]    = y;
+            }
+        }
 
-    memcpy(inbuffer, smp, bufferbytes);
-    memset(smp, 0, bufferbytes);
+        float out = 0.0f;
+        for(int k = 0; k < n; ++k) {
+            amp_g1[k] += ampw[k] * (ampgm[k] - amp_g1[k] - AMP_SMOOTH_A * amp_g2[k]);
+            amp_g2[k] += ampw[k] * (amp_g1[k] - amp_g2[k]);
+            out       += v[k] * amp_g2[k];
+        }
+        smp[i] = out;
+    }
+}
 
-    float formantbuf[buffersize];
+void FormantFilter::filterout(float *smp)
+{
+    float freqbuf[FF_MAX_FORMANTS][freqbufsize];
+    bool  sweeping[FF_MAX_FORMANTS];
+    bool  anysweeping = false;
 
+    //formants in a frequency transition get new coefficients every 8 samples
     for(int j = 0; j < numformants; ++j) {
+        sweeping[j] = freq_smoothing[j].apply(freqbuf[j], freqbufsize,
+                                              bpf[j].freq);
+        if(sweeping[j])
+            anysweeping = true;
+        else if(bpf[j].recompute)
+            computecoefs(j, bpf[j].freq);
+        bpf[j].recompute = false;
+    }
 
-        float tmpbuf[buffersize];
-
-        for(int i = 0; i < buffersize; ++i)
-            tmpbuf[i] = inbuffer[i] * outgain;
-
-        formant[j]->filterout(tmpbuf);
+    //lanes with a zero rate hold their amplitude
+    float ampw[FF_MAX_FORMANTS], ampgm[FF_MAX_FORMANTS];
+    bool  ampsweeping[FF_MAX_FORMANTS];
+    for(int j = 0; j < nlanes; ++j) {
+        const float target = j < numformants ? currentformants[j].amp : 0.0f;
+        ampsweeping[j] = amp_g2[j] != target;
+        ampw[j]  = ampsweeping[j] ? amp_w : 0.0f;
+        ampgm[j] = (1.0f + AMP_SMOOTH_A) * target;
+    }
 
-        if ( formant_amp_smoothing[j].apply( formantbuf, buffersize, currentformants[j].amp ) )
-        {
-            for(int i = 0; i < buffersize; ++i)
-                smp[i] += tmpbuf[i] * formantbuf[i];
-        }
-        else
-        {
-            for(int i = 0; i < buffersize; ++i)
-                smp[i] += tmpbuf[i] * currentformants[j].amp;
+    if(anysweeping)
+        for(int i = 0; i < freqbufsize; ++i) {
+            for(int j = 0; j < numformants; ++j)
+                if(sweeping[j])
+                    computecoefs(j, freqbuf[j][i]);
+            filterblock(&smp[i * 8], 8, ampw, ampgm);
         }
+    else
+        filterblock(smp, buffersize, ampw, ampgm);
+
+    for(int j = 0; j < numformants; ++j) {
+        if(!ampsweeping[j])
+            continue;
+        amp_g2[j] += 1e-10f; //denormal protection
+        if(fabsf(currentformants[j].amp - amp_g2[j]) < AMP_SMOOTH_THRESH)
+            amp_g2[j] = currentformants[j].amp;
     }
 }
 
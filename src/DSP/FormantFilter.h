@@ -20,6 +20,12 @@
 
 namespace zyn {
 
+/**Vowel filter made of up to FF_MAX_FORMANTS parallel bandpasses
+ *
+ * The bandpasses behave like AnalogFilter (type 4), but are run as one bank:
+ * the state and coefficients are stored per formant, so every sample is
+ * filtered by all formants at once and the amplitudes are smoothed in the
+ * same loop instead of making one pass over the buffer per formant.*/
 class FormantFilter:public Filter
 {
     public:
@@ -35,9 +41,37 @@ class FormantFilter:public Filter
 
     private:
         void setpos(float input);
+        //equivalent of AnalogFilter::setfreq_and_q() for one formant
+        void setformant(int n, float frequency, float q_);
+        void computecoefs(int n, float frequency);
+        void filterblock(float *smp, int nsmps,
+                         const float *ampw, const float *ampgm);
 
+        //formants in the bank, rounded up to a multiple of 4
+        int nlanes;
 
-        class AnalogFilter * formant[FF_MAX_FORMANTS];
+        //bandpass coefficients and history, one entry per formant
+        struct {
+            float c0[FF_MAX_FORMANTS], c2[FF_MAX_FORMANTS],
+                  d1[FF_MAX_FORMANTS], d2[FF_MAX_FORMANTS];
+        } coeff;
+        struct {
+            float x1[FF_MAX_FORMANTS], x2[FF_MAX_FORMANTS],
+                  y1[FF_MAX_FORMANTS], y2[FF_MAX_FORMANTS];
+        } history[MAX_FILTER_STAGES + 1];
+        int stages;
+
+        //per formant frequency state, see AnalogFilter
+        struct {
+            float freq, q, newq;
+            bool  recompute, beforeFirstTick;
+        } bpf[FF_MAX_FORMANTS];
+        Value_Smoothing_Filter freq_smoothing[FF_MAX_FORMANTS];
+        int freqbufsize;
+
+        //amplitude smoothing, same response as Value_Smoothing_Filter
+        float amp_g1[FF_MAX_FORMANTS], amp_g2[FF_MAX_FORMANTS];
+        float amp_w;
 
         struct {
             float freq, amp, q; //frequency,amplitude,Q
@@ -53,9 +87,6 @@ class FormantFilter:public Filter
         float oldinput, slowinput;
         float Qfactor, formantslowness, oldQfactor;
         float vowelclearness, sequencestretch;
-        Allocator &memory;
-
-        Value_Smoothing_Filter formant_amp_smoothing[FF_MAX_FORMANTS];
 };
 
 }
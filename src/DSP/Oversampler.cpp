@@ -0,0 +1,182 @@
+/*
+  ZynAddSubFX - a software synthesizer
+
+  Oversampler.cpp - Polyphase half-band up/down sampling
+
+  This program is free software; you can redistribute it and/or
+  modify it under the terms of the GNU General Public License
+  as published by the Free Software Foundation; either version 2
+  of the License, or (at your option) any later version.
+*/
+
+#include <cmath>
+#include <cstring>
+
+#include "../Misc/Allocator.h"
+#include "../globals.h"
+#include "Oversampler.h"
+
+namespace zyn {
+
+//non-zero coefficient pairs of the first and of the following stages
+#define OVERSAMPLER_TAPS_FIRST 16
+#define OVERSAMPLER_TAPS_NEXT  6
+
+Oversampler::Oversampler(Allocator &alloc_, int factor_, int bufsize_)
+    :factor(1), nstages(0), bufsize(bufsize_), latency(0), pad(0),
+     padwork(nullptr), padhist(nullptr), alloc(alloc_)
+{
+    if(factor_ >= 8)
+        nstages = 3;
+    else if(factor_ >= 4)
+        nstages = 2;
+    else if(factor_ >= 2)
+        nstages = 1;
+    factor = 1 << nstages;
+
+    for(int i = 0; i < nstages; ++i)
+        initStage(stages[i],
+                  i == 0 ? OVERSAMPLER_TAPS_FIRST : OVERSAMPLER_TAPS_NEXT,
+                  bufsize << i);
+
+    //each stage delays by 2*taps-1 samples at its output rate, once when
+    //interpolating and once when decimating, minus the one sample that
+    //the decimator skips. In high rate samples that is
+    int delay = 0;
+    for(int i = 0; i < nstages; ++i)
+        delay += (4 * stages[i].taps - 3) * factor / (2 << i);
+    pad     = (factor - delay % factor) % factor;
+    latency = (delay + pad) / factor;
+    if(pad) {
+        padwork = alloc.valloc<float>(pad + bufsize * factor);
+        padhist = alloc.valloc<float>(pad);
+    }
+    cleanup();
+}
+
+Oversampler::~Oversampler()
+{
+    for(int i = 0; i < nstages; ++i) {
+        alloc.devalloc(stages[i].coeff);
+        alloc.devalloc(stages[i].upwork);
+        alloc.devalloc(stages[i].downwork);
+        alloc.devalloc(stages[i].out);
+    }
+    alloc.devalloc(padwork);
+    alloc.devalloc(padhist);
+}
+
+/*
+ * Half-band lowpass of length 4*taps-1 with the center tap 0.5.
+ * Every other tap is zero, the remaining ones are the pairs
+ * h[center +- (2j+1)] = coeff[j], a Blackman windowed sinc.
+ */
+void Oversampler::initStage(Stage &s, int taps, int insize)
+{
+    s.taps     = taps;
+    s.coeff    = alloc.valloc<float>(taps);
+    s.upwork   = alloc.valloc<float>(2 * taps - 1 + insize);
+    s.downwork = alloc.valloc<float>(4 * taps - 3 + 2 * insize);
+    s.out      = alloc.valloc<float>(2 * insize);
+
+    float sum = 0.0f;
+    for(int j = 0; j < taps; ++j) {
+        const float d    = 2 * j + 1; //distance to the center
+        const float x    = PI * d / 2.0f;
+        const float w    = PI * d / (2.0f * taps);
+        const float win  = 0.42f + 0.5f * cosf(w) + 0.08f * cosf(2.0f * w);
+        s.coeff[j] = sinf(x) / x * win;
+        sum       += s.coeff[j];
+    }
+    //unity gain at DC: 0.5 + 2 * sum(coeff) = 1
+    for(int j = 0; j < taps; ++j)
+        s.coeff[j] *= 0.25f / sum;
+}
+
+void Oversampler::cleanup(void)
+{
+    for(int i = 0; i < nstages; ++i) {
+        Stage &s = stages[i];
+        memset(s.upwork, 0, (2 * s.taps - 1) * sizeof(float));
+        memset(s.downwork, 0, (4 * s.taps - 3) * sizeof(float));
+    }
+    if(pad)
+        memset(padhist, 0, pad * sizeof(float));
+}
+
+/*
+ * Interpolation by two, with x being the input:
+ *   out[2p]   = 2 * sum_j coeff[j] * (x[p-K+1+j] + x[p-K-j])
+ *   out[2p+1] = x[p-K+1]
+ */
+void Oversampler::upStage(Stage &s, const float *in, int n)
+{
+    const int    K    = s.taps;
+    const int    hist = 2 * K - 1;
+    float       *w    = s.upwork;
+    const float *c    = s.coeff;
+
+    memcpy(w + hist, in, n * sizeof(float));
+    for(int p = 0; p < n; ++p) {
+        const float *x = w + hist + p; //x[p]
+        float sum = 0.0f;
+        for(int j = 0; j < K; ++j)
+            sum += c[j] * (x[j + 1 - K] + x[-K - j]);
+        s.out[2 * p]     = 2.0f * sum;
+        s.out[2 * p + 1] = x[1 - K];
+    }
+    memmove(w, w + n, hist * sizeof(float));
+}
+
+/*
+ * Decimation by two, with v being the input:
+ *   out[p] = 0.5 * v[2p-2K+2] + sum_j coeff[j] * (v[2p-2K+3+2j] + v[2p-2K+1-2j])
+ */
+void Oversampler::downStage(Stage &s, const float *in, float *out, int n)
+{
+    const int    K    = s.taps;
+    const int    hist = 4 * K - 3;
+    float       *w    = s.downwork;
+    const float *c    = s.coeff;
+
+    memcpy(w + hist, in, 2 * n * sizeof(float));
+    for(int p = 0; p < n; ++p) {
+        const float *v = w + hist + 2 * p + 1; //v[2p+1]
+        float sum = 0.5f * v[1 - 2 * K];
+        for(int j = 0; j < K; ++j)
+            sum += c[j] * (v[2 - 2 * K + 2 * j] + v[-2 * K - 2 * j]);
+        out[p] = sum;
+    }
+    memmove(w, w + 2 * n, hist * sizeof(float));
+}
+
+float *Oversampler::up(float *smps, int n)
+{
+    //without stages the block is processed in place
+    float *in = smps;
+    for(int i = 0; i < nstages; ++i) {
+        upStage(stages[i], in, n << i);
+        in = stages[i].out;
+    }
+    if(!pad)
+        return in;
+
+    //delay by pad samples, the processing is memoryless so this can be
+    //done before it
+    const int hn = n * factor;
+    memcpy(padwork, padhist, pad * sizeof(float));
+    memcpy(padwork + pad, in, hn * sizeof(float));
+    memcpy(padhist, padwork + hn, pad * sizeof(float));
+    return padwork;
+}
+
+void Oversampler::down(float *smps, int n)
+{
+    for(int i = nstages - 1; i >= 0; --i) {
+        float *in  = i == nstages - 1 && pad ? padwork : stages[i].out;
+        float *out = i == 0 ? smps : stages[i - 1].out;
+        downStage(stages[i], in, out, n << i);
+    }
+}
+
+}
@@ -0,0 +1,88 @@
+/*
+  ZynAddSubFX - a software synthesizer
+
+  Oversampler.h - Polyphase half-band up/down sampling
+
+  This program is free software; you can redistribute it and/or
+  modify it under the terms of the GNU General Public License
+  as published by the Free Software Foundation; either version 2
+  of the License, or (at your option) any later version.
+*/
+
+#ifndef OVERSAMPLER_H
+#define OVERSAMPLER_H
+
+namespace zyn {
+
+class Allocator;
+
+/**
+ * Runs a block at 2x, 4x or 8x the sample rate, e.g. to let a non-linearity
+ * generate harmonics above the base Nyquist frequency without aliasing.
+ *
+ * Each factor of two is one stage of windowed-sinc half-band FIR filters in
+ * polyphase form, so only the non-zero taps are computed. The first stage
+ * does the steep filtering; later stages only need to reject the images of
+ * an already band limited signal and use fewer taps.
+ *
+ * Usage per block:
+ * @code
+ * float *hi = os.up(smps, n);   //n*factor samples
+ * ...process hi...
+ * os.down(smps, n);             //back to n samples
+ * @endcode
+ * The round trip delays the signal by getLatency() base rate samples. It is
+ * padded to a whole number of samples, so a dry signal can be delayed to
+ * match.
+ */
+class Oversampler
+{
+    public:
+        /**
+         * @param alloc_   realtime allocator for all buffers
+         * @param factor_  1, 2, 4 or 8 (other values are rounded down)
+         * @param bufsize_ maximum number of base rate samples per block
+         */
+        Oversampler(Allocator &alloc_, int factor_, int bufsize_);
+        ~Oversampler();
+
+        /**Upsample n base rate samples
+         * @returns buffer holding n*getFactor() samples
+         *          (smps itself for a factor of 1)*/
+        float *up(float *smps, int n);
+        /**Downsample the buffer returned by the last up() into smps*/
+        void down(float *smps, int n);
+
+        void cleanup(void);
+
+        int getFactor(void) const { return factor; }
+        /**Delay of an up() and down() round trip in base rate samples*/
+        int getLatency(void) const { return latency; }
+
+    private:
+        struct Stage {
+            int    taps;      //non-zero coefficient pairs
+            float *coeff;     //taps coefficients of the odd phase
+            float *upwork;    //history + input of the interpolator
+            float *downwork;  //history + input of the decimator
+            float *out;       //upsampled output of this stage
+        };
+
+        void initStage(Stage &s, int taps, int insize);
+        static void upStage(Stage &s, const float *in, int n);
+        static void downStage(Stage &s, const float *in, float *out, int n);
+
+        int    factor;
+        int    nstages;
+        int    bufsize;
+        int    latency;
+        Stage  stages[3];
+        int    pad;       //extra delay at the high rate to round the latency
+        float *padwork;   //pad samples of history + upsampled block
+        float *padhist;   //the delayed samples for the next block
+        Allocator &alloc;
+};
+
+}
+
+#endif
@@ -18,6 +18,10 @@
 #include "Unison.h"
 #include "globals.h"
 
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
 #define errx(...) {}
 #define warnx(...) {}
 #ifndef errx
@@ -118,6 +122,65 @@ void Unison::updateParameters(void)
     updateUnisonData();
 }
 
+/*
+ * Sum of all voices for one sample: each voice reads the delay line at its
+ * own fractional position (linear interpolation) with alternating signs.
+ */
+static inline float sumVoices(const float *delay_buffer, int max_delay,
+                              float base, float xpos, int voices,
+                              const float *realpos1, const float *realpos2,
+                              const float *sign)
+{
+    float out = 0.0f;
+    int   k   = 0;
+#ifdef __AVX2__
+    //compilers tend to avoid gathers on their own, so do it explicitly
+    const __m256  vbase = _mm256_set1_ps(base);
+    const __m256  fone  = _mm256_set1_ps(1.0f);
+    const __m256  vx    = _mm256_set1_ps(xpos);
+    const __m256  vx1   = _mm256_set1_ps(1.0f - xpos);
+    const __m256i vmax  = _mm256_set1_epi32(max_delay);
+    const __m256i vmax1 = _mm256_set1_epi32(max_delay - 1);
+    const __m256i one   = _mm256_set1_epi32(1);
+    __m256 acc = _mm256_setzero_ps();
+    for(; k + 8 <= voices; k += 8) {
+        const __m256 vpos = _mm256_add_ps(
+                _mm256_mul_ps(_mm256_loadu_ps(realpos1 + k), vx1),
+                _mm256_mul_ps(_mm256_loadu_ps(realpos2 + k), vx));
+        const __m256  pos  = _mm256_sub_ps(_mm256_sub_ps(vbase, vpos), fone);
+        __m256i       posi = _mm256_cvttps_epi32(pos);
+        const __m256  posf = _mm256_sub_ps(pos, _mm256_cvtepi32_ps(posi));
+        posi = _mm256_sub_epi32(posi,
+                _mm256_and_si256(_mm256_cmpgt_epi32(posi, vmax1), vmax));
+        __m256i posn = _mm256_add_epi32(posi, one);
+        posn = _mm256_sub_epi32(posn,
+                _mm256_and_si256(_mm256_cmpgt_epi32(posn, vmax1), vmax));
+        const __m256 a = _mm256_i32gather_ps(delay_buffer, posi, 4);
+        const __m256 b = _mm256_i32gather_ps(delay_buffer, posn, 4);
+        const __m256 v = _mm256_add_ps(_mm256_mul_ps(_mm256_sub_ps(fone, posf), a),
+                                       _mm256_mul_ps(posf, b));
+        acc = _mm256_add_ps(acc, _mm256_mul_ps(v, _mm256_loadu_ps(sign + k)));
+    }
+    __m128 acc4 = _mm_add_ps(_mm256_castps256_ps128(acc),
+                             _mm256_extractf128_ps(acc, 1));
+    acc4 = _mm_add_ps(acc4, _mm_movehl_ps(acc4, acc4));
+    acc4 = _mm_add_ss(acc4, _mm_shuffle_ps(acc4, acc4, 1));
+    out  = _mm_cvtss_f32(acc4);
+#endif
+    for(; k < voices; ++k) {
+        const float vpos = realpos1[k] * (1.0f - xpos) + realpos2[k] * xpos;
+        const float pos  = base - vpos - 1.0f;
+        int posi = (int)pos; //pos is always positive
+        const float posf = pos - posi;
+        posi -= (posi >= max_delay) ? max_delay : 0;
+        int posi_next = posi + 1;
+        posi_next -= (posi_next >= max_delay) ? max_delay : 0;
+        out += ((1.0f - posf) * delay_buffer[posi] + posf
+             * delay_buffer[posi_next]) * sign[k];
+    }
+    return out;
+}
+
 void Unison::process(int bufsize, float *inbuf, float *outbuf)
 {
     if(!uv)
@@ -125,37 +188,47 @@ void Unison::process(int bufsize, float *inbuf, float *outbuf)
     if(!outbuf)
         outbuf = inbuf;
 
-    float volume    = 1.0f / sqrtf(unison_size);
-    float xpos_step = 1.0f / (float) update_period_samples;
-    float xpos      = (float) update_period_sample_k * xpos_step;
-    for(int i = 0; i < bufsize; ++i) {
-        if(update_period_sample_k++ >= update_period_samples) {
+    const float volume    = 1.0f / sqrtf(unison_size);
+    const float xpos_step = 1.0f / (float) update_period_samples;
+    float       xpos      = (float) update_period_sample_k * xpos_step;
+
+    //voice data as plain arrays, so the voice loop maps to SIMD lanes
+    float realpos1[unison_size], realpos2[unison_size], sign[unison_size];
+    for(int k = 0; k < unison_size; ++k)
+        sign[k] = (k & 1) ? -1.0f : 1.0f;
+
+    int i = 0;
+    while(i < bufsize) {
+        //the voice positions only change at the start of an update period,
+        //so process everything up to the next update as one block
+        int n;
+        if(update_period_sample_k >= update_period_samples) {
             updateUnisonData();
-            update_period_sample_k = 0;
             xpos = 0.0f;
+            n = std::min(update_period_samples + 1, bufsize - i);
+            update_period_sample_k = n - 1;
+        }
+        else {
+            n = std::min(update_period_samples - update_period_sample_k,
+                         bufsize - i);
+            update_period_sample_k += n;
         }
-        xpos += xpos_step;
-        float in   = inbuf[i], out = 0.0f;
-        float sign = 1.0f;
+
         for(int k = 0; k < unison_size; ++k) {
-            float vpos = uv[k].realpos1 * (1.0f - xpos) + uv[k].realpos2 * xpos;        //optimize
-            float pos  = (float)(delay_k + max_delay) - vpos - 1.0f;
-            int   posi;
-            F2I(pos, posi); //optimize!
-            int posi_next = posi + 1;
-            if(posi >= max_delay)
-                posi -= max_delay;
-            if(posi_next >= max_delay)
-                posi_next -= max_delay;
-            float posf = pos - floorf(pos);
-            out += ((1.0f - posf) * delay_buffer[posi] + posf
-                 * delay_buffer[posi_next]) * sign;
-            sign = -sign;
+            realpos1[k] = uv[k].realpos1;
+            realpos2[k] = uv[k].realpos2;
+        }
+
+        for(const int end = i + n; i < end; ++i) {
+            xpos += xpos_step;
+            const float in  = inbuf[i];
+            const float out = sumVoices(delay_buffer, max_delay,
+                                        (float)(delay_k + max_delay), xpos,
+                                        unison_size, realpos1, realpos2, sign);
+            outbuf[i] = out * volume;
+            delay_buffer[delay_k] = in;
+            delay_k = (delay_k + 1 < max_delay) ? delay_k + 1 : 0;
         }
-        outbuf[i] = out * volume;
-//		printf("%d %g\n",i,outbuf[i]);
-        delay_buffer[delay_k] = in;
-        delay_k = (++delay_k < max_delay) ? delay_k : 0;
     }
 }
 
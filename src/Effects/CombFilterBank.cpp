@@ -1,8 +1,14 @@
+#include <cassert>
 #include <cmath>
+#include <cstring>
 #include "../Misc/Allocator.h"
 #include "../Misc/Util.h"
 #include "CombFilterBank.h"
 
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
 namespace zyn {
 
     CombFilterBank::CombFilterBank(Allocator *alloc, unsigned int samplerate_, int buffersize_, float initgain):
@@ -37,36 +43,40 @@ namespace zyn {
             return;
 
         const unsigned int mem_size_new = (int)ceilf(( (float)samplerate/baseFreqNew*1.03f + buffersize + 2)/16) * 16;
-        if(mem_size_new == mem_size)
+        const unsigned int stride_new = (nrOfStringsNew + COMB_BANK_BLOCK - 1)
+                                        / COMB_BANK_BLOCK * COMB_BANK_BLOCK;
+        if(mem_size_new != mem_size || stride_new != stride)
         {
-            if(nrOfStringsNew>nrOfStrings)
+            // allocate the buffer with the new layout
+            float *string_smps_new = NULL;
+            if(stride_new)
             {
-                for(unsigned int i = nrOfStrings; i < nrOfStringsNew; ++i)
-                {
-                    string_smps[i] = memory.valloc<float>(mem_size);
-                    memset(string_smps[i], 0, mem_size*sizeof(float));
-                }
+                string_smps_new = memory.valloc<float>(mem_size_new*stride_new);
+                memset(string_smps_new, 0, mem_size_new*stride_new*sizeof(float));
+                // keep the remaining strings if only the layout changes
+                if(mem_size_new == mem_size && string_smps)
+                    for(unsigned int p = 0; p < mem_size; ++p)
+                        memcpy(string_smps_new + p*stride_new, string_smps + p*stride,
+                               min(nrOfStrings, nrOfStringsNew)*sizeof(float));
             }
-            else if(nrOfStringsNew<nrOfStrings)
-                for(unsigned int i = nrOfStringsNew; i < nrOfStrings; ++i)
-                    memory.devalloc(string_smps[i]);
-        } else
-        {
-            // free the old buffers (wrong size for baseFreqNew)
-            for(unsigned int i = 0; i < nrOfStrings; ++i)
-                memory.devalloc(string_smps[i]);
+            memory.devalloc(string_smps);
+            string_smps = string_smps_new;
+            stride = stride_new;
 
-            // allocate buffers with new size
-            for(unsigned int i = 0; i < nrOfStringsNew; ++i)
+            if(mem_size_new != mem_size)
             {
-                string_smps[i] = memory.valloc<float>(mem_size_new);
-                memset(string_smps[i], 0, mem_size_new*sizeof(float));
+                // update mem_size and baseFreq
+                mem_size = mem_size_new;
+                baseFreq = baseFreqNew;
+                // reset writer position
+                pos_writer = 0;
             }
-            // update mem_size and baseFreq
-            mem_size = mem_size_new;
-            baseFreq = baseFreqNew;
-            // reset writer position
-            pos_writer = 0;
+        } else if(nrOfStringsNew>nrOfStrings)
+        {
+            // clear the added strings
+            for(unsigned int p = 0; p < mem_size; ++p)
+                memset(string_smps + p*stride + nrOfStrings, 0,
+                       (nrOfStringsNew - nrOfStrings)*sizeof(float));
         }
         // update nrOfStrings
         nrOfStrings = nrOfStringsNew;
@@ -80,13 +90,6 @@ namespace zyn {
         return (x*(105.0f+10.0f*x2)/(105.0f+(45.0f+x2)*x2));
     }
 
-    inline float CombFilterBank::sampleLerp(const float *smp, const float pos) const {
-        int poshi = (int)pos; // integer part (pos >= 0)
-        float poslo = pos - (float) poshi; // decimal part
-        // linear interpolation between samples
-        return smp[poshi] + poslo * (smp[(poshi+1)%mem_size]-smp[poshi]);
-    }
-
     void CombFilterBank::filterout(float *smp)
     {
         // no string -> no sound
@@ -100,30 +103,99 @@ namespace zyn {
         if (!gain_smoothing.apply( gainbuf, gainbufsize, gainbwd ) ) // interpolate the gain value
             std::fill(gainbuf, gainbuf+gainbufsize, gainbwd); // if nothing to interpolate (constant value)
 
+        // the feedback sample positions move along with the writer, so they
+        // are computed once per buffer as offsets into string_smps and then
+        // only advanced by a row and wrapped at the end of the buffer
+        const int ring_size = mem_size*stride;
+        int   reader[COMB_BANK_MAX_STRIDE];      // interpolated samples
+        int   reader_next[COMB_BANK_MAX_STRIDE]; // and their successors
+        float reader_frac[COMB_BANK_MAX_STRIDE];
+        for (unsigned int j = 0; j < nrOfStrings; ++j)
+        {
+            assert(float(mem_size)>delays[j]);
+            const float pos = float(mem_size) - delays[j];
+            unsigned int poshi = (unsigned int)pos;
+            reader_frac[j] = pos - (float)poshi;
+            poshi += pos_writer;
+            if (poshi >= mem_size) poshi -= mem_size;
+            unsigned int posnext = poshi + 1;
+            if (posnext >= mem_size) posnext -= mem_size;
+            reader[j]      = poshi*stride + j;
+            reader_next[j] = posnext*stride + j;
+        }
+
         for (unsigned int i = 0; i < buffersize; ++i)
         {
             // apply input gain
             const float input_smp = smp[i]*inputgain;
-
-            for (unsigned int j = 0; j < nrOfStrings; ++j)
+            const float gain = gainbuf[i/16];
+            float *row = string_smps + pos_writer*stride;
+            float sum = 0.0f;
+
+            unsigned int j = 0;
+#ifdef __AVX2__
+            // COMB_BANK_BLOCK strings at once, reading with gathers
+            const __m256  vinput = _mm256_set1_ps(input_smp);
+            const __m256  vgain  = _mm256_set1_ps(gain);
+            const __m256i vrow   = _mm256_set1_epi32(stride);
+            const __m256i vsize  = _mm256_set1_epi32(ring_size);
+            const __m256i vlast  = _mm256_set1_epi32(ring_size - 1);
+            const __m256  c105   = _mm256_set1_ps(105.0f);
+            const __m256  c45    = _mm256_set1_ps(45.0f);
+            const __m256  c10    = _mm256_set1_ps(10.0f);
+            __m256 vsum = _mm256_setzero_ps();
+            for (; j + COMB_BANK_BLOCK <= nrOfStrings; j += COMB_BANK_BLOCK)
             {
-                assert(float(mem_size)>delays[j]);
-                // calculate the feedback sample positions in the buffer
-                const float pos_reader = fmodf(float(pos_writer+mem_size) - delays[j], float(mem_size));
-
-                // sample at that position
-                const float sample = sampleLerp(string_smps[j], pos_reader);
-                string_smps[j][pos_writer] = input_smp + tanhX(sample*gainbuf[i/16]);
+                __m256i r  = _mm256_loadu_si256((const __m256i*)(reader + j));
+                __m256i rn = _mm256_loadu_si256((const __m256i*)(reader_next + j));
+                const __m256 a = _mm256_i32gather_ps(string_smps, r, 4);
+                const __m256 b = _mm256_i32gather_ps(string_smps, rn, 4);
+                const __m256 sample = _mm256_add_ps(a, _mm256_mul_ps(
+                            _mm256_loadu_ps(reader_frac + j), _mm256_sub_ps(b, a)));
+
+                // tanhX
+                const __m256 x  = _mm256_mul_ps(sample, vgain);
+                const __m256 x2 = _mm256_mul_ps(x, x);
+                const __m256 t  = _mm256_div_ps(
+                        _mm256_mul_ps(x, _mm256_add_ps(c105, _mm256_mul_ps(c10, x2))),
+                        _mm256_add_ps(c105, _mm256_mul_ps(_mm256_add_ps(c45, x2), x2)));
+                const __m256 out = _mm256_add_ps(vinput, t);
+                _mm256_storeu_ps(row + j, out);
+                vsum = _mm256_add_ps(vsum, out);
+
+                // next row, wrapped at the end of the buffer
+                r  = _mm256_add_epi32(r, vrow);
+                rn = _mm256_add_epi32(rn, vrow);
+                r  = _mm256_sub_epi32(r, _mm256_and_si256(_mm256_cmpgt_epi32(r, vlast), vsize));
+                rn = _mm256_sub_epi32(rn, _mm256_and_si256(_mm256_cmpgt_epi32(rn, vlast), vsize));
+                _mm256_storeu_si256((__m256i*)(reader + j), r);
+                _mm256_storeu_si256((__m256i*)(reader_next + j), rn);
+            }
+            __m128 sum4 = _mm_add_ps(_mm256_castps256_ps128(vsum),
+                                     _mm256_extractf128_ps(vsum, 1));
+            sum4 = _mm_add_ps(sum4, _mm_movehl_ps(sum4, sum4));
+            sum4 = _mm_add_ss(sum4, _mm_shuffle_ps(sum4, sum4, 1));
+            sum  = _mm_cvtss_f32(sum4);
+#endif
+            for (; j < nrOfStrings; ++j)
+            {
+                // sample at the feedback position
+                const float a = string_smps[reader[j]];
+                const float b = string_smps[reader_next[j]];
+                const float sample = a + reader_frac[j] * (b - a);
+                row[j] = input_smp + tanhX(sample*gain);
+                sum += row[j];
+
+                reader[j]      += stride;
+                reader_next[j] += stride;
+                if (reader[j] >= ring_size) reader[j] -= ring_size;
+                if (reader_next[j] >= ring_size) reader_next[j] -= ring_size;
             }
-            // mix output buffer samples to output sample
-            smp[i]=0.0f;
-            for (unsigned int j = 0; j < nrOfStrings; ++j)
-                smp[i] += string_smps[j][pos_writer];
 
             // apply output gain to sum of strings and
             // divide by nrOfStrings to get mean value
             // division by zero is catched at the beginning filterOut()
-            smp[i] *= outgain / (float)nrOfStrings;
+            smp[i] = sum * outgain / (float)nrOfStrings;
 
             // increment writing position
             ++pos_writer %= mem_size;
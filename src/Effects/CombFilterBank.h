@@ -7,6 +7,11 @@
 
 namespace zyn {
 
+// strings processed together, one AVX register of floats
+#define COMB_BANK_BLOCK 8
+#define COMB_BANK_MAX_STRIDE ((NUM_SYMPATHETIC_STRINGS + COMB_BANK_BLOCK - 1) \
+                              / COMB_BANK_BLOCK * COMB_BANK_BLOCK)
+
 /**Comb Filter Bank for sympathetic Resonance*/
 class CombFilterBank
 {
@@ -25,9 +30,11 @@ class CombFilterBank
 
     private:
     static float tanhX(const float x);
-    float sampleLerp(const float *smp, const float pos) const;
 
-    float* string_smps[NUM_SYMPATHETIC_STRINGS] = {};
+    /* the strings are interleaved, so a sample of all strings is one
+     * contiguous row: sample p of string j is at string_smps[p*stride + j] */
+    float* string_smps = NULL;
+    unsigned int stride = 0; // nrOfStrings rounded up to COMB_BANK_BLOCK
     float baseFreq;
     unsigned int nrOfStrings=0;
     unsigned int pos_writer = 0;
@@ -13,6 +13,7 @@
 
 #include "Distortion.h"
 #include "../DSP/AnalogFilter.h"
+#include "../DSP/Oversampler.h"
 #include "../Misc/WaveShapeSmps.h"
 #include "../Misc/Allocator.h"
 #include <cmath>
@@ -66,6 +67,9 @@ rtosc::Ports Distortion::ports = {
             rLinear(0, 127), "Shape of the wave shaping function"),
     rEffPar(Poffset,   12, rShort("offset"), rDefault(64),
             rLinear(0, 127), "Input DC Offset"),
+    rEffParOpt(Poversampling, 13, rShort("oversmp"),
+            rOptions(1x, 2x, 4x, 8x), rDefault(1x),
+            "Oversampling of the wave shaping to reduce aliasing"),
     {"waveform:", 0, 0, [](const char *, rtosc::RtData &d)
         {
             Distortion  &dd = *(Distortion*)d.obj;
@@ -104,12 +108,16 @@ Distortion::Distortion(EffectParams pars)
       Pstereo(0),
       Pprefiltering(0),
       Pfuncpar(32),
-      Poffset(64)
+      Poffset(64),
+      Poversampling(0),
+      ovsl(nullptr),
+      ovsr(nullptr)
 {
     lpfl = memory.alloc<AnalogFilter>(2, 22000, 1, 0, pars.srate, pars.bufsize);
     lpfr = memory.alloc<AnalogFilter>(2, 22000, 1, 0, pars.srate, pars.bufsize);
     hpfl = memory.alloc<AnalogFilter>(3, 20, 1, 0, pars.srate, pars.bufsize);
     hpfr = memory.alloc<AnalogFilter>(3, 20, 1, 0, pars.srate, pars.bufsize);
+    setoversampling(0);
     setpreset(Ppreset);
     cleanup();
 }
@@ -120,6 +128,8 @@ Distortion::~Distortion()
     memory.dealloc(lpfr);
     memory.dealloc(hpfl);
     memory.dealloc(hpfr);
+    memory.dealloc(ovsl);
+    memory.dealloc(ovsr);
 }
 
 //Cleanup the effect
@@ -129,6 +139,13 @@ void Distortion::cleanup(void)
     hpfl->cleanup();
     lpfr->cleanup();
     hpfr->cleanup();
+    ovsl->cleanup();
+    ovsr->cleanup();
+}
+
+int Distortion::getlatency(void) const
+{
+    return ovsl->getLatency();
 }
 
 
@@ -144,6 +161,15 @@ void Distortion::applyfilters(float *efxoutl, float *efxoutr)
 }
 
 
+//Apply the non-linearity, oversampled if requested
+void Distortion::waveshape(Oversampler *os, float *smps)
+{
+    float *hi = os->up(smps, buffersize);
+    waveShapeSmps(buffersize * os->getFactor(), hi,
+                  Ptype + 1, Pdrive, Poffset, Pfuncpar);
+    os->down(smps, buffersize);
+}
+
 //Effect output
 void Distortion::out(const Stereo<float *> &smp)
 {
@@ -163,9 +189,9 @@ void Distortion::out(const Stereo<float *> &smp)
     if(Pprefiltering)
         applyfilters(efxoutl, efxoutr);
 
-    waveShapeSmps(buffersize, efxoutl, Ptype + 1, Pdrive, Poffset, Pfuncpar);
+    waveshape(ovsl, efxoutl);
     if(Pstereo)
-        waveShapeSmps(buffersize, efxoutr, Ptype + 1, Pdrive, Poffset, Pfuncpar);
+        waveshape(ovsr, efxoutr);
 
     if(!Pprefiltering)
         applyfilters(efxoutl, efxoutr);
@@ -219,23 +245,36 @@ void Distortion::sethpf(unsigned char _Phpf)
     hpfr->setfreq(fr);
 }
 
+void Distortion::setoversampling(unsigned char _Poversampling)
+{
+    if(_Poversampling > 3)
+        _Poversampling = 3;
+    if(ovsl && Poversampling == _Poversampling)
+        return;
+    Poversampling = _Poversampling;
+    memory.dealloc(ovsl);
+    memory.dealloc(ovsr);
+    ovsl = memory.alloc<Oversampler>(memory, 1 << Poversampling, buffersize);
+    ovsr = memory.alloc<Oversampler>(memory, 1 << Poversampling, buffersize);
+}
+
 unsigned char Distortion::getpresetpar(unsigned char npreset, unsigned int npar)
 {
-#define	PRESET_SIZE 13
+#define	PRESET_SIZE 14
 #define	NUM_PRESETS 6
     static const unsigned char presets[NUM_PRESETS][PRESET_SIZE] = {
         //Overdrive 1
-        {127, 64, 35, 56, 70, 0, 0, 96,  0,   0, 0, 32, 64},
+        {127, 64, 35, 56, 70, 0, 0, 96,  0,   0, 0, 32, 64, 0},
         //Overdrive 2
-        {127, 64, 35, 29, 75, 1, 0, 127, 0,   0, 0, 32, 64},
+        {127, 64, 35, 29, 75, 1, 0, 127, 0,   0, 0, 32, 64, 0},
         //A. Exciter 1
-        {64,  64, 35, 75, 80, 5, 0, 127, 105, 1, 0, 32, 64},
+        {64,  64, 35, 75, 80, 5, 0, 127, 105, 1, 0, 32, 64, 0},
         //A. Exciter 2
-        {64,  64, 35, 85, 62, 1, 0, 127, 118, 1, 0, 32, 64},
+        {64,  64, 35, 85, 62, 1, 0, 127, 118, 1, 0, 32, 64, 0},
         //Guitar Amp
-        {127, 64, 35, 63, 75, 2, 0, 55,  0,   0, 0, 32, 64},
+        {127, 64, 35, 63, 75, 2, 0, 55,  0,   0, 0, 32, 64, 0},
         //Quantisize
-        {127, 64, 35, 88, 75, 4, 0, 127, 0,   1, 0, 32, 64}
+        {127, 64, 35, 88, 75, 4, 0, 127, 0,   1, 0, 32, 64, 0}
     };
     if(npreset < NUM_PRESETS && npar < PRESET_SIZE) {
         if(npar == 0 && insertion == 0) {
@@ -305,6 +344,9 @@ void Distortion::changepar(int npar, unsigned char value)
         case 12:
             Poffset = value;
             break;
+        case 13:
+            setoversampling(value);
+            break;
     }
 }
 
@@ -324,6 +366,7 @@ unsigned char Distortion::getpar(int npar) const
         case 10: return Pprefiltering;
         case 11: return Pfuncpar;
         case 12: return Poffset;
+        case 13: return Poversampling;
         default: return 0; //in case of bogus parameter number
     }
 }
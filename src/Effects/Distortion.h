@@ -30,6 +30,7 @@ class Distortion:public Effect
         void changepar(int npar, unsigned char value);
         unsigned char getpar(int npar) const;
         void cleanup(void);
+        int getlatency(void) const;
         void applyfilters(float *efxoutl, float *efxoutr);
 
         static rtosc::Ports ports;
@@ -46,13 +47,17 @@ class Distortion:public Effect
         unsigned char Pprefiltering; //if you want to do the filtering before the distortion
         unsigned char Pfuncpar;      //for parametric functions
         unsigned char Poffset;       //the input offset
+        unsigned char Poversampling; //0=off, 1=2x, 2=4x, 3=8x for the non-linearity
 
         void setvolume(unsigned char _Pvolume);
         void setlpf(unsigned char _Plpf);
         void sethpf(unsigned char _Phpf);
+        void setoversampling(unsigned char _Poversampling);
+        void waveshape(class Oversampler *os, float *smps);
 
         //Real Parameters
         class AnalogFilter * lpfl, *lpfr, *hpfl, *hpfr;
+        class Oversampler  * ovsl, *ovsr;
 };
 
 }
@@ -117,8 +117,16 @@ void Echo::initdelays(void)
 }
 
 //Effect output
+//the write position is almost always within one delay line length, so the
+//integer division is only needed when it is not
+static inline int wrap(int pos, int len)
+{
+    return pos < len ? pos : pos % len;
+}
+
 void Echo::out(const Stereo<float *> &input)
 {
+    const int len = MAX_DELAY * samplerate;
     for(int i = 0; i < buffersize; ++i) {
         float ldl = delay.l[pos.l];
         float rdl = delay.r[pos.r];
@@ -132,9 +140,9 @@ void Echo::out(const Stereo<float *> &input)
         rdl = input.r[i] * pangainR - rdl * fb;
 
         //LowPass Filter
-        old.l = delay.l[(pos.l + delta.l) % (MAX_DELAY * samplerate)] =
+        old.l = delay.l[wrap(pos.l + delta.l, len)] =
                     ldl * hidamp + old.l * (1.0f - hidamp);
-        old.r = delay.r[(pos.r + delta.r) % (MAX_DELAY * samplerate)] =
+        old.r = delay.r[wrap(pos.r + delta.r, len)] =
                     rdl * hidamp + old.r * (1.0f - hidamp);
 
         //increment
@@ -142,8 +150,10 @@ void Echo::out(const Stereo<float *> &input)
         ++pos.r; // += delta.r;
 
         //ensure that pos is still in bounds
-        pos.l %= MAX_DELAY * samplerate;
-        pos.r %= MAX_DELAY * samplerate;
+        if(pos.l >= len)
+            pos.l = 0;
+        if(pos.r >= len)
+            pos.r = 0;
 
         //adjust delay if needed
         delta.l = (15 * delta.l + ndelta.l) / 16;
@@ -77,6 +77,8 @@
     __VA_ARGS__)
 
 
+#define EFFECT_MAX_LATENCY 64
+
 namespace zyn {
 
 class FilterParams;
@@ -149,6 +151,10 @@ class Effect
         /**Reset the state of the effect*/
         virtual void cleanup(void) {}
         virtual float getfreqresponse(float freq) { return freq; }
+        /**Delay of efxoutl/efxoutr against the input in samples, at most
+         * EFFECT_MAX_LATENCY. EffectMgr delays the dry signal of insertion
+         * effects by it.*/
+        virtual int getlatency(void) const { return 0; }
 
         unsigned char Ppreset;   /**<Currently used preset*/
         float *const  efxoutl; /**<Effect out Left Channel*/
@@ -13,8 +13,10 @@
 
 #include <rtosc/ports.h>
 #include <rtosc/port-sugar.h>
+#include <algorithm>
 #include <iostream>
 #include <cassert>
+#include <cstring>
 
 #include "EffectMgr.h"
 #include "Effect.h"
@@ -33,6 +35,7 @@
 #include "../Misc/Time.h"
 #include "../Params/FilterParams.h"
 #include "../Misc/Allocator.h"
+#include "../Misc/Denormal.h"
 
 namespace zyn {
 
@@ -233,7 +236,7 @@ static const rtosc::Ports local_ports = {
     {"efftype::i:c:S", rOptions(Disabled, Reverb, Echo, Chorus,
 
      Phaser, Alienwah, Distortion, EQ, DynFilter, Granular, Sympathetic) rDefault(Disabled)
-     rProp(parameter) rDoc("Get Effect Type"), NULL,
+     rProp(parameter) rProp(no cache) rDoc("Get Effect Type"), NULL,
      rCOptionCb(obj->nefx, obj->changeeffectrt(var))},
     {"efftype:b", rProp(internal) rDoc("Pointer swap EffectMgr"), NULL,
         [](const char *msg, rtosc::RtData &d)
@@ -279,7 +282,8 @@ EffectMgr::EffectMgr(Allocator &alloc, const SYNTH_T &synth_,
       denominator(4),
       dryonly(false),
       memory(alloc),
-      synth(synth_)
+      synth(synth_),
+      drylatency(0)
 {
     setpresettype("Peffect");
     memset(efxoutl, 0, synth.bufferbytes);
@@ -448,6 +452,32 @@ void EffectMgr::cleanup(void)
 {
     if(efx)
         efx->cleanup();
+    memset(drydelayl, 0, sizeof(drydelayl));
+    memset(drydelayr, 0, sizeof(drydelayr));
+}
+
+void EffectMgr::delaydry(float *smpsl, float *smpsr)
+{
+    const int latency = std::min(efx->getlatency(), EFFECT_MAX_LATENCY);
+    if(latency != drylatency) {
+        memset(drydelayl, 0, sizeof(drydelayl));
+        memset(drydelayr, 0, sizeof(drydelayr));
+        drylatency = latency;
+    }
+    if(!latency)
+        return;
+
+    const int n = synth.buffersize;
+    float tmp[latency + n];
+    memcpy(tmp, drydelayl, latency * sizeof(float));
+    memcpy(tmp + latency, smpsl, n * sizeof(float));
+    memcpy(smpsl, tmp, n * sizeof(float));
+    memcpy(drydelayl, tmp + n, latency * sizeof(float));
+
+    memcpy(tmp, drydelayr, latency * sizeof(float));
+    memcpy(tmp + latency, smpsr, n * sizeof(float));
+    memcpy(smpsr, tmp, n * sizeof(float));
+    memcpy(drydelayr, tmp + n, latency * sizeof(float));
 }
 
 
@@ -517,12 +547,17 @@ void EffectMgr::out(float *smpsl, float *smpsr)
             }
         return;
     }
+#if FLUSH_DENORMALS
+    memset(efxoutl, 0, synth.bufferbytes);
+    memset(efxoutr, 0, synth.bufferbytes);
+#else
     for(int i = 0; i < synth.buffersize; ++i) {
         smpsl[i]  += synth.denormalkillbuf[i];
         smpsr[i]  += synth.denormalkillbuf[i];
         efxoutl[i] = 0.0f;
         efxoutr[i] = 0.0f;
     }
+#endif
     efx->out(smpsl, smpsr);
 
     float volume = efx->volume;
@@ -535,6 +570,7 @@ void EffectMgr::out(float *smpsl, float *smpsr)
 
     //Insertion effect
     if(insertion != 0) {
+        delaydry(smpsl, smpsr);
         float v1, v2;
         if(volume < 0.5f) {
             v1 = 1.0f;
@@ -16,6 +16,7 @@
 
 #include <pthread.h>
 
+#include "Effect.h"
 #include "../Params/FilterParams.h"
 #include "../Params/Presets.h"
 
@@ -110,6 +111,12 @@ class EffectMgr:public Presets
         bool dryonly;
         Allocator &memory;
         const SYNTH_T &synth;
+
+        //Delay the dry signal by the latency of the effect
+        void delaydry(float *smpsl, float *smpsr) REALTIME;
+        int   drylatency;
+        float drydelayl[EFFECT_MAX_LATENCY];
+        float drydelayr[EFFECT_MAX_LATENCY];
         
         
 };
@@ -210,9 +210,7 @@ void Phaser::AnalogPhase(const Stereo<float *> &input)
             g.r -= floorf(g.r);
         }
 
-        xn.l = applyPhase(xn.l, g.l, fb.l, hpf.l, yn1.l, xn1.l);
-        xn.r = applyPhase(xn.r, g.r, fb.r, hpf.r, yn1.r, xn1.r);
-
+        xn = applyPhase(xn, g, fb, hpf);
 
         fb.l = xn.l * feedback;
         fb.r = xn.r * feedback;
@@ -226,8 +224,13 @@ void Phaser::AnalogPhase(const Stereo<float *> &input)
     }
 }
 
-float Phaser::applyPhase(float x, float g, float fb,
-                         float &hpf, float *yn1, float *xn1)
+/*
+ * Both channels run through their stages side by side: the chains don't
+ * depend on each other, so each stage is one dual-mono step instead of
+ * walking the left chain and then the right one.
+ */
+Stereo<float> Phaser::applyPhase(Stereo<float> x, Stereo<float> g,
+                                 Stereo<float> fb, Stereo<float> &hpf)
 {
     for(int j = 0; j < Pstages; ++j) { //Phasing routine
         mis = 1.0f + offsetpct * offset[j];
@@ -235,22 +238,32 @@ float Phaser::applyPhase(float x, float g, float fb,
         //This is symmetrical.
         //FET is not, so this deviates slightly, however sym dist. is
         //better sounding than a real FET.
-        float d = (1.0f + 2.0f * (0.25f + g) * hpf * hpf * distortion) * mis;
+        Stereo<float> d(
+            (1.0f + 2.0f * (0.25f + g.l) * hpf.l * hpf.l * distortion) * mis,
+            (1.0f + 2.0f * (0.25f + g.r) * hpf.r * hpf.r * distortion) * mis);
         Rconst = 1.0f + mis * Rmx;
 
         // This is 1/R. R is being modulated to control filter fc.
-        float b    = (Rconst - g) / (d * Rmin);
-        float gain = (CFs - b) / (CFs + b);
-        yn1[j] = gain * (x + yn1[j]) - xn1[j];
+        Stereo<float> b((Rconst - g.l) / (d.l * Rmin),
+                        (Rconst - g.r) / (d.r * Rmin));
+        Stereo<float> gain((CFs - b.l) / (CFs + b.l),
+                           (CFs - b.r) / (CFs + b.r));
+        yn1.l[j] = gain.l * (x.l + yn1.l[j]) - xn1.l[j];
+        yn1.r[j] = gain.r * (x.r + yn1.r[j]) - xn1.r[j];
 
         //high pass filter:
         //Distortion depends on the high-pass part of the AP stage.
-        hpf = yn1[j] + (1.0f - gain) * xn1[j];
-
-        xn1[j] = x;
-        x      = yn1[j];
-        if(j == 1)
-            x += fb;  //Insert feedback after first phase stage
+        hpf.l = yn1.l[j] + (1.0f - gain.l) * xn1.l[j];
+        hpf.r = yn1.r[j] + (1.0f - gain.r) * xn1.r[j];
+
+        xn1.l[j] = x.l;
+        xn1.r[j] = x.r;
+        x.l      = yn1.l[j];
+        x.r      = yn1.r[j];
+        if(j == 1) { //Insert feedback after first phase stage
+            x.l += fb.l;
+            x.r += fb.r;
+        }
     }
     return x;
 }
@@ -282,8 +295,7 @@ void Phaser::normalPhase(const Stereo<float *> &input)
         Stereo<float> g(gain.l * x + oldgain.l * x1,
                         gain.r * x + oldgain.r * x1);
 
-        xn.l = applyPhase(xn.l, g.l, old.l);
-        xn.r = applyPhase(xn.r, g.r, old.r);
+        xn = applyPhase(xn, g);
 
         //Left/Right crossing
         crossover(xn.l, xn.r, lrcross);
@@ -302,12 +314,14 @@ void Phaser::normalPhase(const Stereo<float *> &input)
     }
 }
 
-float Phaser::applyPhase(float x, float g, float *old)
+Stereo<float> Phaser::applyPhase(Stereo<float> x, Stereo<float> g)
 {
     for(int j = 0; j < Pstages * 2; ++j) { //Phasing routine
-        float tmp = old[j];
-        old[j] = g * tmp + x;
-        x      = tmp - g * old[j];
+        Stereo<float> tmp(old.l[j], old.r[j]);
+        old.l[j] = g.l * tmp.l + x.l;
+        old.r[j] = g.r * tmp.r + x.r;
+        x.l      = tmp.l - g.l * old.l[j];
+        x.r      = tmp.r - g.r * old.r[j];
     }
     return x;
 }
@@ -83,11 +83,11 @@ class Phaser:public Effect
         void analog_setup();
         void AnalogPhase(const Stereo<float *> &input);
         //analog case
-        float applyPhase(float x, float g, float fb,
-                         float &hpf, float *yn1, float *xn1);
+        Stereo<float> applyPhase(Stereo<float> x, Stereo<float> g,
+                                 Stereo<float> fb, Stereo<float> &hpf);
 
         void normalPhase(const Stereo<float *> &input);
-        float applyPhase(float x, float g, float *old);
+        Stereo<float> applyPhase(Stereo<float> x, Stereo<float> g);
 };
 
 }
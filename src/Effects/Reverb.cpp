@@ -151,42 +151,61 @@ void Reverb::cleanup(void)
         lpf->cleanup();
 }
 
-//Process one channel; 0=left, 1=right
-void Reverb::processmono(int ch, float *output, float *inputbuf)
+//One sample through all-pass j
+inline float Reverb::allpass(int j, float x)
 {
-    //todo: implement the high part from lohidamp
+    float &a  = ap[j][apk[j]];
+    float tmp = a;
+    a = 0.7f * tmp + x;
+    if((++apk[j]) >= aplen[j])
+        apk[j] = 0;
+    return tmp - 0.7f * a;
+}
 
-    for(int j = REV_COMBS * ch; j < REV_COMBS * (ch + 1); ++j) {
-        int &ck = combk[j];
-        const int comblength = comblen[j];
-        float    &lpcombj    = lpcomb[j];
+/*
+ * The combs and all-passes of both channels are independent chains fed by
+ * the same input. They run side by side per sample instead of one chain
+ * over the whole buffer after the other, so the 2*REV_COMBS comb updates
+ * of a sample are one vector operation and the lowpass states don't wait
+ * on each other.
+ */
+void Reverb::processstereo(float *outl, float *outr, const float *inputbuf)
+{
+    //todo: implement the high part from lohidamp
 
-        for(int i = 0; i < buffersize; ++i) {
-            float fbout = comb[j][ck] * combfb[j];
-            fbout   = fbout * (1.0f - lohifb) + lpcombj * lohifb;
-            lpcombj = fbout;
+    for(int i = 0; i < buffersize; ++i) {
+        float fbout[REV_COMBS * 2];
+        for(int j = 0; j < REV_COMBS * 2; ++j)
+            fbout[j] = comb[j][combk[j]];
+
+        for(int j = 0; j < REV_COMBS * 2; ++j) {
+            fbout[j]  = fbout[j] * combfb[j];
+            fbout[j]  = fbout[j] * (1.0f - lohifb) + lpcomb[j] * lohifb;
+            lpcomb[j] = fbout[j];
+        }
 
-            comb[j][ck] = inputbuf[i] + fbout;
-            output[i]  += fbout;
+        Stereo<float> x(outl[i], outr[i]);
+        for(int j = 0; j < REV_COMBS; ++j) {
+            x.l += fbout[j];
+            x.r += fbout[REV_COMBS + j];
+        }
 
-            if((++ck) >= comblength)
-                ck = 0;
+        for(int j = 0; j < REV_COMBS * 2; ++j) {
+            comb[j][combk[j]] = inputbuf[i] + fbout[j];
+            if((++combk[j]) >= comblen[j])
+                combk[j] = 0;
         }
-    }
 
-    for(int j = REV_APS * ch; j < REV_APS * (1 + ch); ++j) {
-        int &ak = apk[j];
-        const int aplength = aplen[j];
-        for(int i = 0; i < buffersize; ++i) {
-            float tmp = ap[j][ak];
-            ap[j][ak] = 0.7f * tmp + output[i];
-            output[i] = tmp - 0.7f * ap[j][ak];
-            if((++ak) >= aplength)
-                ak = 0;
+        for(int j = 0; j < REV_APS; ++j) {
+            x.l = allpass(j, x.l);
+            x.r = allpass(REV_APS + j, x.r);
         }
+        outl[i] = x.l;
+        outr[i] = x.r;
     }
 }
 
+
 //Effect output
 void Reverb::out(const Stereo<float *> &smp)
 {
@@ -216,8 +235,7 @@ void Reverb::out(const Stereo<float *> &smp)
     if(hpf)
         hpf->filterout(inputbuf);
 
-    processmono(0, efxoutl, inputbuf); //left
-    processmono(1, efxoutr, inputbuf); //right
+    processstereo(efxoutl, efxoutr, inputbuf);
 
     float lvol = rs / REV_COMBS * pangainL;
     float rvol = rs / REV_COMBS * pangainR;
@@ -60,7 +60,8 @@ class Reverb:public Effect
         void settype(unsigned char _Ptype);
         void setroomsize(unsigned char _Proomsize);
         void setbandwidth(unsigned char _Pbandwidth);
-        void processmono(int ch, float *output, float *inputbuf);
+        void processstereo(float *outl, float *outr, const float *inputbuf);
+        float allpass(int j, float x);
 
 
         //Parameters
@@ -29,6 +29,7 @@
 #include "Config.h"
 #include "Util.h"
 #include "Part.h"
+#include "XMLwrapper.h"
 #include "BankDb.h"
 #ifdef WIN32
 #include <windows.h>
@@ -169,6 +170,19 @@ int Bank::clearslot(unsigned int ninstrument)
  * Save the instrument to a slot
  */
 int Bank::savetoslot(unsigned int ninstrument, Part *part)
+{
+    XMLwrapper xml;
+    xml.beginbranch("INSTRUMENT");
+    part->add2XMLinstrument(xml);
+    xml.endbranch();
+    return savetoslot(ninstrument, (char *) part->Pname, xml);
+}
+
+/*
+ * Save an instrument which is already in a tree to a slot
+ */
+int Bank::savetoslot(unsigned int ninstrument, const std::string &name,
+                     XMLwrapper &xml)
 {
     int err = clearslot(ninstrument);
     if(err)
@@ -182,7 +196,7 @@ int Bank::savetoslot(unsigned int ninstrument, Part *part)
              maxfilename,
              "%04d-%s",
              ninstrument + 1,
-             (char *)part->Pname);
+             name.c_str());
 
     string filename = dirname + '/' + legalizeFilename(tmpfilename) + ".xiz";
 
@@ -195,11 +209,10 @@ int Bank::savetoslot(unsigned int ninstrument, Part *part)
             return err;
     }
 
-    err = part->saveXML(filename.c_str());
+    err = xml.saveXMLfile(filename, config->cfg.GzipCompression);
     if(err)
         return err;
-    addtobank(ninstrument, legalizeFilename(tmpfilename) + ".xiz",
-              (char *) part->Pname);
+    addtobank(ninstrument, legalizeFilename(tmpfilename) + ".xiz", name);
     //Since we've changed the contents of one of the banks, rescan the
     //database to keep it updated.
     db->scanBanks();
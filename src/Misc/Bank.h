@@ -45,6 +45,10 @@ class Bank
         int clearslot(unsigned int ninstrument);
         /**Saves the given Part to slot*/
         int savetoslot(unsigned int ninstrument, class Part * part);
+        /**Saves an instrument tree (e.g. a copy of a Part taken while the
+         * backend was frozen) to slot*/
+        int savetoslot(unsigned int ninstrument, const std::string &name,
+                       class XMLwrapper &xml);
         /**Loads the given slot into a Part*/
         int loadfromslot(unsigned int ninstrument, class Part * part);
 
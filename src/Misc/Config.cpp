@@ -46,11 +46,13 @@ static const rtosc::Ports ports = {
     rParamI(cfg.SampleRate, "samples of audio per second"),
     rParamI(cfg.SoundBufferSize, "Size of processed audio buffer"),
     rParamI(cfg.OscilSize, "Size Of Oscillator Wavetable"),
+    rParamI(cfg.ControlPeriod, "Samples between envelope and LFO updates, "
+            "0 for once per buffer (takes effect after restart)"),
     rToggle(cfg.SwapStereo, "Swap Left And Right Channels"),
     rToggle(cfg.AudioOutputCompressor, "Apply Compressor to Audio Output"),
     rToggle(cfg.BankUIAutoClose, "Automatic Closing of BackUI After Patch Selection"),
     rParamI(cfg.GzipCompression, "Level of Gzip Compression For Save Files"),
-    rParamI(cfg.Interpolation, "Level of Interpolation, Linear/Cubic"),
+    rParamI(cfg.Interpolation, "Level of Interpolation, Linear/Cubic/Sinc"),
     rToggle(cfg.SaveFullXml, "Include Disabled parts in save"),
     {"cfg.presetsDirList", rDoc("list of preset search directories"), 0,
         [](const char *msg, rtosc::RtData &d)
@@ -123,9 +125,13 @@ static const rtosc::Ports ports = {
     //rString(cfg.currentBankDir),
     //rArrayS(cfg.presetsDirList,MAX_BANK_ROOT_DIRS),
     rToggle(cfg.CheckPADsynth, "Old Check For PADsynth functionality within a patch"),
+    rToggle(cfg.CompactPADsamples,
+            "Store PADsynth samples as 16 bit (takes effect after restart)"),
     rToggle(cfg.IgnoreProgramChange, "Ignore MIDI Program Change Events"),
     rParamI(cfg.UserInterfaceMode, "Beginner/Advanced Mode Select"),
     rParamI(cfg.VirKeybLayout, "Keyboard Layout For Virtual Piano Keyboard"),
+    rParamI(cfg.OscBudget, rLinear(1, 100),
+            "Percent of each buffer period the synth may spend applying UI messages"),
     //rParamS(cfg.LinuxALSAaudioDev),
     //rParamS(cfg.nameTag)
     {"cfg.OscilPower::i", rProp(parameter) rDoc("Size Of Oscillator Wavetable"), 0,
@@ -194,6 +200,7 @@ void Config::init()
     cfg.SampleRate      = 44100;
     cfg.SoundBufferSize = 256;
     cfg.OscilSize  = 1024;
+    cfg.ControlPeriod = CONTROL_PERIOD;
     cfg.SwapStereo = 0;
     cfg.AudioOutputCompressor = 0;
 
@@ -212,10 +219,12 @@ void Config::init()
     cfg.Interpolation = 0;
     cfg.SaveFullXml = 0;
     cfg.CheckPADsynth = 1;
+    cfg.CompactPADsamples = 0;
     cfg.IgnoreProgramChange = 0;
 
     cfg.UserInterfaceMode = 0;
     cfg.VirKeybLayout     = 1;
+    cfg.OscBudget         = 25;
     winwavemax = 1;
     winmidimax = 1;
     //try to find out how many input midi devices are there
@@ -320,6 +329,10 @@ void Config::readConfig(const char *filename)
                                       cfg.OscilSize,
                                       MAX_AD_HARMONICS * 2,
                                       131072);
+        cfg.ControlPeriod = xmlcfg.getpar("control_period",
+                                          cfg.ControlPeriod,
+                                          0,
+                                          8192);
         cfg.SwapStereo = xmlcfg.getpar("swap_stereo",
                                        cfg.SwapStereo,
                                        0,
@@ -342,7 +355,7 @@ void Config::readConfig(const char *filename)
         cfg.Interpolation  = xmlcfg.getpar("interpolation",
                                            cfg.Interpolation,
                                            0,
-                                           1);
+                                           2);
 
         cfg.SaveFullXml  = xmlcfg.getpar("SaveFullXml",
                                            cfg.SaveFullXml,
@@ -354,11 +367,18 @@ void Config::readConfig(const char *filename)
                                           0,
                                           1);
 
+        cfg.CompactPADsamples = xmlcfg.getpar("compact_pad_samples",
+                                              cfg.CompactPADsamples,
+                                              0,
+                                              1);
+
         cfg.IgnoreProgramChange = xmlcfg.getpar("ignore_program_change",
                                           cfg.IgnoreProgramChange,
                                           0,
                                           1);
 
+        cfg.OscBudget = xmlcfg.getpar("osc_budget", cfg.OscBudget, 1, 100);
+
 
         cfg.UserInterfaceMode = xmlcfg.getpar("user_interface_mode",
                                               cfg.UserInterfaceMode,
@@ -423,6 +443,7 @@ void Config::saveConfig(const char *filename) const
     xmlcfg->addpar("sample_rate", cfg.SampleRate);
     xmlcfg->addpar("sound_buffer_size", cfg.SoundBufferSize);
     xmlcfg->addpar("oscil_size", cfg.OscilSize);
+    xmlcfg->addpar("control_period", cfg.ControlPeriod);
     xmlcfg->addpar("swap_stereo", cfg.SwapStereo);
     xmlcfg->addpar("audio_output_compressor", cfg.AudioOutputCompressor);
     xmlcfg->addpar("bank_window_auto_close", cfg.BankUIAutoClose);
@@ -430,7 +451,9 @@ void Config::saveConfig(const char *filename) const
     xmlcfg->addpar("gzip_compression", cfg.GzipCompression);
 
     xmlcfg->addpar("check_pad_synth", cfg.CheckPADsynth);
+    xmlcfg->addpar("compact_pad_samples", cfg.CompactPADsamples);
     xmlcfg->addpar("ignore_program_change", cfg.IgnoreProgramChange);
+    xmlcfg->addpar("osc_budget", cfg.OscBudget);
 
     xmlcfg->addparstr("bank_current", cfg.currentBankDir);
 
@@ -42,6 +42,7 @@ class Config
         struct {
             oss_devs_t oss_devs;
             int   SampleRate, SoundBufferSize, OscilSize, SwapStereo;
+            int   ControlPeriod; //samples per envelope/LFO update, 0: per buffer
             bool  AudioOutputCompressor;
             int   WindowsWaveOutId, WindowsMidiInId;
             int   BankUIAutoClose;
@@ -52,9 +53,11 @@ class Config
             std::string presetsDirList[MAX_BANK_ROOT_DIRS];
             std::string favoriteList[MAX_BANK_ROOT_DIRS];
             int CheckPADsynth;
+            int CompactPADsamples; //store PADsynth samples as int16
             int IgnoreProgramChange;
             int UserInterfaceMode;
             int VirKeybLayout;
+            int OscBudget; //percent of a buffer period for applying UI messages
             std::string LinuxALSAaudioDev;
             std::string nameTag;
         } cfg;
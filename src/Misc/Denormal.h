@@ -0,0 +1,94 @@
+/*
+  ZynAddSubFX - a software synthesizer
+
+  Denormal.h - Flush-to-zero/denormals-are-zero handling for realtime threads
+
+  This program is free software; you can redistribute it and/or
+  modify it under the terms of the GNU General Public License
+  as published by the Free Software Foundation; either version 2
+  of the License, or (at your option) any later version.
+*/
+#ifndef DENORMAL_H
+#define DENORMAL_H
+
+#include <stdint.h>
+
+#if defined(__SSE__) || defined(_M_X64) || defined(_M_IX86_FP)
+#include <xmmintrin.h>
+#define ZYN_DENORMAL_SSE 1
+#endif
+
+/*
+ * FLUSH_DENORMALS is set by the build system (option FlushDenormals).
+ * When enabled, every realtime entry point runs with the FPU flushing
+ * denormal results and inputs to zero, so the per-buffer noise from
+ * SYNTH_T::denormalkillbuf is no longer needed.
+ */
+#ifndef FLUSH_DENORMALS
+#define FLUSH_DENORMALS 0
+#endif
+
+namespace zyn {
+
+/**
+ * Puts the calling thread into flush-to-zero/denormals-are-zero mode for the
+ * lifetime of the object and restores the previous FPU state afterwards.
+ *
+ * Create one at the top of each realtime callback (audio driver, plugin run,
+ * worker threads). Restoring is required as plugin hosts own the thread.
+ * Without FLUSH_DENORMALS (or on unsupported platforms) this is a no-op.
+ */
+class DenormalGuard
+{
+    public:
+        DenormalGuard(void)
+        {
+#if FLUSH_DENORMALS
+#if defined(ZYN_DENORMAL_SSE)
+            old = _mm_getcsr();
+            //bit 15: flush to zero, bit 6: denormals are zero
+            _mm_setcsr(old | 0x8040);
+#elif defined(__aarch64__)
+            uint64_t fpcr;
+            __asm__ __volatile__ ("mrs %0, fpcr" : "=r" (fpcr));
+            old = fpcr;
+            //bit 24: flush to zero (covers inputs as well)
+            fpcr |= (1ULL << 24);
+            __asm__ __volatile__ ("msr fpcr, %0" : : "r" (fpcr));
+#elif defined(__arm__) && defined(__ARM_FP)
+            uint32_t fpscr;
+            __asm__ __volatile__ ("vmrs %0, fpscr" : "=r" (fpscr));
+            old = fpscr;
+            fpscr |= (1U << 24);
+            __asm__ __volatile__ ("vmsr fpscr, %0" : : "r" (fpscr));
+#endif
+#endif
+        }
+
+        ~DenormalGuard(void)
+        {
+#if FLUSH_DENORMALS
+#if defined(ZYN_DENORMAL_SSE)
+            _mm_setcsr((unsigned int)old);
+#elif defined(__aarch64__)
+            const uint64_t fpcr = old;
+            __asm__ __volatile__ ("msr fpcr, %0" : : "r" (fpcr));
+#elif defined(__arm__) && defined(__ARM_FP)
+            const uint32_t fpscr = (uint32_t)old;
+            __asm__ __volatile__ ("vmsr fpscr, %0" : : "r" (fpscr));
+#endif
+#endif
+        }
+
+        DenormalGuard(const DenormalGuard&) = delete;
+        DenormalGuard& operator=(const DenormalGuard&) = delete;
+
+#if FLUSH_DENORMALS
+    private:
+        uint64_t old = 0;
+#endif
+};
+
+}
+
+#endif
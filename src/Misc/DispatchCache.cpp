@@ -0,0 +1,124 @@
+/*
+  ZynAddSubFX - a software synthesizer
+
+  DispatchCache.cpp - Path to handler cache for realtime OSC dispatch
+
+  This program is free software; you can redistribute it and/or
+  modify it under the terms of the GNU General Public License
+  as published by the Free Software Foundation; either version 2
+  of the License, or (at your option) any later version.
+*/
+#include <cstring>
+#include <rtosc/rtosc.h>
+#include <rtosc/ports.h>
+#include "DispatchCache.h"
+
+namespace zyn {
+
+static_assert(sizeof(rtosc::RtData::idx) == sizeof(DispatchCache::Entry::idx),
+              "DispatchCache entries must hold all indices of RtData");
+
+DispatchCache::DispatchCache(void)
+    :hits(0), misses(0)
+{
+    clear();
+}
+
+void DispatchCache::clear(void)
+{
+    for(int i = 0; i < size; ++i)
+        entries[i].keylen = 0;
+}
+
+void DispatchCache::invalidate(const char *prefix, int len)
+{
+    for(int i = 0; i < size; ++i)
+        if(entries[i].keylen && !strncmp(entries[i].key, prefix, len))
+            entries[i].keylen = 0;
+}
+
+/*
+ * Copies "path\0types" into key and returns its FNV-1a hash.
+ * keylen is 0 if the key does not fit.
+ */
+uint32_t DispatchCache::makeKey(const char *msg, char *key, int &keylen)
+{
+    uint32_t hash = 2166136261u;
+    int      len  = 0;
+    const char *src = msg;
+    for(int part = 0; part < 2; ++part) {
+        for(; *src; ++src) {
+            if(len >= max_key - 1) {
+                keylen = 0;
+                return 0;
+            }
+            key[len++] = *src;
+            hash = (hash ^ (uint8_t)*src) * 16777619u;
+        }
+        key[len++] = 0;
+        hash = (hash ^ 0) * 16777619u;
+        src = rtosc_argument_string(msg);
+    }
+    keylen = len;
+    return hash;
+}
+
+const DispatchCache::Entry *DispatchCache::find(const char *msg)
+{
+    char key[max_key];
+    int  keylen;
+    const uint32_t hash = makeKey(msg, key, keylen);
+    if(keylen)
+        for(int i = 0; i < probes; ++i) {
+            //no early exit on a free slot, invalidate() leaves holes
+            const Entry &e = entries[(hash + i) & (size - 1)];
+            if(e.hash == hash && e.keylen == keylen
+               && !memcmp(e.key, key, keylen)) {
+                ++hits;
+                return &e;
+            }
+        }
+    ++misses;
+    return nullptr;
+}
+
+bool DispatchCache::insert(const char *msg, const rtosc::Port *port,
+                           void *obj, const int *idx)
+{
+    //only plain names, the leaf message is then the tail of the path
+    const char *name = port->name;
+    const int   nlen = strcspn(name, ":");
+    if(strcspn(name, "#/{}[]*?") < (size_t)nlen)
+        return false;
+    const int plen = strlen(msg);
+    if(plen <= nlen || msg[plen - nlen - 1] != '/'
+       || memcmp(msg + plen - nlen, name, nlen))
+        return false;
+
+    char key[max_key];
+    int  keylen;
+    const uint32_t hash = makeKey(msg, key, keylen);
+    if(!keylen)
+        return false;
+
+    //use the first free slot, otherwise replace the home slot
+    Entry *slot = &entries[hash & (size - 1)];
+    for(int i = 0; i < probes; ++i) {
+        Entry &e = entries[(hash + i) & (size - 1)];
+        if(!e.keylen) {
+            slot = &e;
+            break;
+        }
+    }
+
+    slot->hash     = hash;
+    slot->keylen   = keylen;
+    slot->leaf_off = plen - nlen;
+    slot->port     = port;
+    slot->obj      = obj;
+    memcpy(slot->idx, idx, sizeof(slot->idx));
+    memcpy(slot->key, key, keylen);
+    return true;
+}
+
+}
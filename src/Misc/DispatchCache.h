@@ -0,0 +1,75 @@
+/*
+  ZynAddSubFX - a software synthesizer
+
+  DispatchCache.h - Path to handler cache for realtime OSC dispatch
+
+  This program is free software; you can redistribute it and/or
+  modify it under the terms of the GNU General Public License
+  as published by the Free Software Foundation; either version 2
+  of the License, or (at your option) any later version.
+*/
+#pragma once
+#include <cstdint>
+
+namespace rtosc {
+struct Port;
+}
+
+namespace zyn {
+
+/**
+ * Remembers which port and object a message path resolved to, so that
+ * repeated messages (automation, MIDI learn, GUI drags) can call the leaf
+ * callback directly instead of walking the port tree level by level.
+ *
+ * Entries are keyed by the path together with the argument type string,
+ * so a hit only happens for exactly the signature that matched before.
+ * Besides the port they keep the object and the array indices (RtData::idx)
+ * the tree walk had reached. They hold raw object pointers, so entries below
+ * an object which may have been replaced must be dropped with invalidate().
+ *
+ * Fixed size and allocation free, so it can be used from the realtime
+ * thread.
+ */
+class DispatchCache
+{
+    public:
+        constexpr static int max_key = 128; //path + '\0' + arg types + '\0'
+        constexpr static int size    = 512; //must be a power of two
+        constexpr static int probes  = 4;
+        constexpr static int max_idx = 16;  //as rtosc::RtData::idx
+
+        struct Entry {
+            uint32_t           hash;
+            uint16_t           keylen;   //0 if the entry is unused
+            uint16_t           leaf_off; //offset of the leaf name in the path
+            const rtosc::Port *port;
+            void              *obj;
+            int                idx[max_idx];
+            char               key[max_key];
+        };
+
+        DispatchCache(void);
+
+        /**Entry for the message's path and argument types or nullptr*/
+        const Entry *find(const char *msg);
+        /**Remember that msg was handled by port with d.obj == obj and
+         * d.idx == idx
+         * @returns false if the port can not be cached (e.g. the port
+         *          name is a pattern or the path is too long)*/
+        bool insert(const char *msg, const rtosc::Port *port, void *obj,
+                    const int *idx);
+        /**Drop the entries of all paths starting with the first len
+         * characters of prefix*/
+        void invalidate(const char *prefix, int len);
+        void clear(void);
+
+        unsigned hits;
+        unsigned misses;
+    private:
+        static uint32_t makeKey(const char *msg, char *key, int &keylen);
+
+        Entry entries[size];
+};
+
+}
@@ -20,9 +20,11 @@
 #include "../Misc/Stereo.h"
 #include "../Misc/Util.h"
 #include "../Params/LFOParams.h"
+#include "../Params/PADnoteParameters.h"
 #include "../Effects/EffectMgr.h"
 #include "../DSP/FFTwrapper.h"
 #include "../Misc/Allocator.h"
+#include "../Misc/Denormal.h"
 #include "../Containers/ScratchString.h"
 #include "../Nio/Nio.h"
 #include "PresetExtractor.h"
@@ -38,6 +40,7 @@
 #include <algorithm>
 #include <cmath>
 #include <atomic>
+#include <chrono>
 #include <unistd.h>
 
 using namespace std;
@@ -517,9 +520,27 @@ static const Ports master_ports = {
             Master &M =  *(Master*)d.obj;
             M.ShutUp();
         }},
+    {"osc-stats:", rProp(internal) rDoc("Statistics of applying UI messages\n"
+            "Replies with the messages applied in the last cycle and the"
+            " maximum per cycle, the current and maximum number of cycles"
+            " which left messages queued, the time spent in the last cycle"
+            " and the maximum (in us), and the dispatch cache hits and"
+            " misses. The maxima and counters are reset afterwards."), 0,
+        [](const char *,RtData &d) {
+            Master *M =  (Master*)d.obj;
+            Master::OscStats &s = M->osc_stats;
+            d.reply(d.loc, "iiiiffii", s.events, s.max_events,
+                    s.backlog, s.max_backlog, s.drain_us, s.max_drain_us,
+                    M->dispatch_cache.hits, M->dispatch_cache.misses);
+            s.max_events   = 0;
+            s.max_backlog  = 0;
+            s.max_drain_us = 0;
+            M->dispatch_cache.hits   = 0;
+            M->dispatch_cache.misses = 0;}},
     {"freeze_state:", rProp(internal) rDoc("Disable OSC event handling\n"
             "This sets up a read-only mode from which it's safe for another"
-            " thread to save parameters"), 0,
+            " thread to save parameters. MIDI controllers received in this"
+            " mode are applied on /thaw_state"), 0,
         [](const char *,RtData &d) {
             Master *M =  (Master*)d.obj;
             std::atomic_thread_fence(std::memory_order_release);
@@ -529,7 +550,7 @@ static const Ports master_ports = {
             "See /freeze_state for more information"), 0,
         [](const char *,RtData &d) {
             Master *M =  (Master*)d.obj;
-            M->frozenState = false;}},
+            M->thawState();}},
     {"midi-learn/", rDoc("MIDI Learn Classic"), &rtosc::MidiMapperRT::ports,
         [](const char *msg, RtData &d) {
             Master *M =  (Master*)d.obj;
@@ -620,6 +641,8 @@ class DataObj:public rtosc::RtData
             obj      = obj_;
             bToU     = bToU_;
             forwarded = false;
+            leaf_port = nullptr;
+            leaf_obj  = nullptr;
         }
 
         virtual void replyArray(const char *path, const char *args, rtosc_arg_t *vals) override
@@ -644,6 +667,7 @@ class DataObj:public rtosc::RtData
             bToU->raw_write(msg);
         }
         virtual void broadcast(const char *path, const char *args, ...) override{
+            noteLeaf(path);
             va_list va;
             va_start(va,args);
             reply("/broadcast", "");
@@ -654,6 +678,7 @@ class DataObj:public rtosc::RtData
         }
         virtual void broadcast(const char *msg) override
         {
+            noteLeaf(msg);
             reply("/broadcast", "");
             reply(msg);
         }
@@ -667,7 +692,23 @@ class DataObj:public rtosc::RtData
             forwarded = true;
         }
         bool forwarded;
+
+        //Port which broadcast its own new value during the last dispatch,
+        //i.e. the handler of the message, with its object and the indices
+        //of the array ports above it (see DispatchCache)
+        const rtosc::Port *leaf_port;
+        void *leaf_obj;
+        int   leaf_idx[DispatchCache::max_idx];
     private:
+        void noteLeaf(const char *path)
+        {
+            if(port && !strcmp(path, loc)) {
+                leaf_port = port;
+                leaf_obj  = obj;
+                memcpy(leaf_idx, idx, sizeof(leaf_idx));
+            }
+        }
+
         rtosc::ThreadLink *bToU;
 };
 
@@ -770,11 +811,14 @@ Master::Master(const SYNTH_T &synth_, Config* config)
     microtonal(config->cfg.GzipCompression), bank(config),
     automate(16,4,8),
     frozenState(false), pendingMemory(false),
-    synth(synth_), gzip_compression(config->cfg.GzipCompression)
+    synth(synth_), gzip_compression(config->cfg.GzipCompression),
+    osc_budget(config->cfg.OscBudget)
 {
     SaveFullXml=(config->cfg.SaveFullXml==1);
     bToU = NULL;
     uToB = NULL;
+    frozen_ctl_count = 0;
+    memset(&osc_stats, 0, sizeof(osc_stats));
     
     // set default tempo
     time.tempo = 120;
@@ -881,7 +925,43 @@ bool Master::applyOscEvent(const char *msg, float *outl, float *outr,
         fprintf(stdout, "%c[%d;%d;%dm", 0x1B, 0, 7 + 30, 0 + 40);
     }
 
-    ports.dispatch(msg, d, true);
+    if(const DispatchCache::Entry *e = dispatch_cache.find(msg)) {
+        //call the known handler directly, as the port tree walk would,
+        //also with the indices of the array ports it passed (e.g. slot#)
+        int idx[DispatchCache::max_idx];
+        memcpy(idx, d.idx, sizeof(idx));
+        memcpy(d.idx, e->idx, sizeof(idx));
+        d.message = msg;
+        d.obj     = e->obj;
+        d.port    = e->port;
+        fast_strcpy(d.loc, msg, d.loc_size);
+        d.matches++;
+        e->port->cb(msg + e->leaf_off, d);
+        memcpy(d.idx, idx, sizeof(idx));
+        d.obj    = this;
+        d.loc[0] = 0;
+    } else {
+        const char *args  = rtosc_argument_string(msg);
+        const int matches = d.matches;
+        d.leaf_port = nullptr;
+        ports.dispatch(msg, d, true);
+
+        //Pointer arguments and ports marked "no cache" (like the effect
+        //type) replace objects, which entries below the parent of the
+        //path may point to. Other writes replace nothing.
+        bool replaces = strchr(args, 'b');
+        if(d.leaf_port) {
+            auto meta = d.leaf_port->meta();
+            replaces |= meta.find("no cache") != meta.end();
+        }
+
+        //Cache parameter writes that were handled by exactly one port
+        if(replaces)
+            dispatch_cache.invalidate(msg, strrchr(msg, '/') - msg + 1);
+        else if(*args && d.leaf_port && d.matches == matches + 1
+                && !d.forwarded)
+            dispatch_cache.insert(msg, d.leaf_port, d.leaf_obj, d.leaf_idx);
+    }
 
     if(!d.matches) {
         //workaround for requesting voice status
@@ -1003,8 +1083,11 @@ void Master::polyphonicAftertouch(char chan, note_t note, char velocity)
  */
 void Master::setController(char chan, int type, int par)
 {
-    if(frozenState)
+    if(frozenState) {
+        if(frozen_ctl_count < max_frozen_controllers)
+            frozen_ctl[frozen_ctl_count++] = {chan, type, par, 0.0f, false};
         return;
+    }
     automate.handleMidi(chan, type, par);
     midi.handleCC(type, par, chan, false);
     if((type == C_dataentryhi) || (type == C_dataentrylo)
@@ -1048,8 +1131,11 @@ void Master::setController(char chan, int type, int par)
  */
 void Master::setController(char chan, int type, note_t note, float value)
 {
-    if(frozenState)
+    if(frozenState) {
+        if(frozen_ctl_count < max_frozen_controllers)
+            frozen_ctl[frozen_ctl_count++] = {chan, type, note, value, true};
         return;
+    }
 
     /* Send the controller to all part assigned to the channel */
     for(int npart = 0; npart < NUM_MIDI_PARTS; ++npart)
@@ -1057,6 +1143,21 @@ void Master::setController(char chan, int type, note_t note, float value)
             part[npart]->SetController(type, note, value, keyshift);
 }
 
+void Master::thawState(void)
+{
+    frozenState = false;
+
+    //apply in arrival order, after the save has read the parameters
+    for(int i = 0; i < frozen_ctl_count; ++i) {
+        const FrozenController &c = frozen_ctl[i];
+        if(c.pernote)
+            setController(c.chan, c.type, (note_t)c.par, c.value);
+        else
+            setController(c.chan, c.type, c.par);
+    }
+    frozen_ctl_count = 0;
+}
+
 void Master::vuUpdate(const float *outl, const float *outr)
 {
     //Peak computation (for vumeters)
@@ -1220,10 +1321,21 @@ bool Master::runOSC(float *outl, float *outr, bool offline,
         DataObj d{loc_buf, 1024, this, bToU};
         memset(loc_buf, 0, sizeof(loc_buf));
 
-        int events = 0;
-        for(; uToB && uToB->hasNext() && events < 100; ++msg_id, ++events)
+        //Apply messages until osc_budget percent of the buffer period is
+        //used up. At least one message is applied per cycle and offline
+        //processing has no deadline.
+        typedef std::chrono::steady_clock clock;
+        const auto start  = clock::now();
+        const auto budget = std::chrono::duration<float>(
+                synth.dt() * osc_budget / 100.0f);
+
+        unsigned events = 0;
+        for(; uToB && uToB->hasNext(); ++msg_id)
         {
+            if(events && !offline && clock::now() - start >= budget)
+                break;
             const char *msg = uToB->read();
+            ++events;
             if(! applyOscEvent(msg, outl, outr, offline, true, d, msg_id,
                                master_from_mw) )
             {
@@ -1232,13 +1344,25 @@ bool Master::runOSC(float *outl, float *outr, bool offline,
             }
         }
 
+        osc_stats.events   = events;
+        osc_stats.drain_us = std::chrono::duration<float, std::micro>(
+                clock::now() - start).count();
+        osc_stats.max_events   = std::max(osc_stats.max_events, events);
+        osc_stats.max_drain_us = std::max(osc_stats.max_drain_us,
+                                          osc_stats.drain_us);
+        if(uToB && uToB->hasNext())
+            osc_stats.max_backlog = std::max(osc_stats.max_backlog,
+                                             ++osc_stats.backlog);
+        else
+            osc_stats.backlog = 0;
+
         if(automate.damaged) {
             d.broadcast("/damage", "s", "/automate/");
             automate.damaged = 0;
         }
 
         if(events>1 && false)
-            fprintf(stderr, "backend: %d events per cycle\n",events);
+            fprintf(stderr, "backend: %u events per cycle\n",events);
 
         run_osc_in_use.store(false);
         return true;
@@ -1249,8 +1373,12 @@ bool Master::runOSC(float *outl, float *outr, bool offline,
 /*
  * Master audio out (the final sound)
  */
-bool Master::AudioOut(float *outl, float *outr)
+bool Master::AudioOut(float *outl, float *outr,
+                      float *const *partl, float *const *partr)
 {
+    //Every driver and plugin renders through here
+    DenormalGuard denormalGuard;
+
     //Danger Limits
     if(memory->lowMemory(2,1024*1024))
         printf("QUITE LOW MEMORY IN THE RT POOL BE PREPARED FOR WEIRD BEHAVIOR!!\n");
@@ -1280,6 +1408,22 @@ bool Master::AudioOut(float *outl, float *outr)
     memset(outl, 0, synth.bufferbytes);
     memset(outr, 0, synth.bufferbytes);
 
+    //Let the parts render into the given buffers, restored at the end
+    float *ownpartl[NUM_MIDI_PARTS], *ownpartr[NUM_MIDI_PARTS];
+    if(partl && partr)
+        for(int npart = 0; npart < NUM_MIDI_PARTS; ++npart) {
+            ownpartl[npart] = part[npart]->partoutl;
+            ownpartr[npart] = part[npart]->partoutr;
+            part[npart]->partoutl = partl[npart];
+            part[npart]->partoutr = partr[npart];
+            //a silent part does not clear its buffers again, but these
+            //are new ones every cycle
+            if(!part[npart]->Penabled) {
+                memset(partl[npart], 0, synth.bufferbytes);
+                memset(partr[npart], 0, synth.bufferbytes);
+            }
+        }
+
     //Compute part samples and store them part[npart]->partoutl,partoutr
     //Note: We do this regardless if the part is enabled or not, to allow
     //the part to graciously shut down when disabled.
@@ -1451,6 +1595,11 @@ bool Master::AudioOut(float *outl, float *outr)
     //Update pulse
     last_ack = last_beat;
 
+    if(partl && partr)
+        for(int npart = 0; npart < NUM_MIDI_PARTS; ++npart) {
+            part[npart]->partoutl = ownpartl[npart];
+            part[npart]->partoutr = ownpartr[npart];
+        }
 
     return true;
 }
@@ -1574,8 +1723,12 @@ void Master::vuresetpeaks()
 
 void Master::applyparameters(void)
 {
+    //the PAD samples of all parts are computed together, so a session
+    //with many PAD instruments keeps all cores busy
+    std::vector<PADnoteParameters *> pars;
     for(int npart = 0; npart < NUM_MIDI_PARTS; ++npart)
-        part[npart]->applyparameters();
+        part[npart]->getPadParameters(pars);
+    PADnoteParameters::applyparameters(pars, []{return false;});
 }
 
 void Master::initialize_rt(void)
@@ -22,6 +22,7 @@
 #include <rtosc/savefile.h>
 
 #include "Time.h"
+#include "DispatchCache.h"
 #include "Bank.h"
 #include "Recorder.h"
 
@@ -123,8 +124,13 @@ class Master
         bool runOSC(float *outl, float *outr, bool offline=false,
                     Master* master_from_mw = nullptr);
 
-        /**Audio Output*/
-        bool AudioOut(float *outl, float *outr) REALTIME;
+        /**Audio Output
+         * @param partl,partr optional buffers per part, which the parts
+         *        render into instead of Part::partoutl/partoutr for this
+         *        buffer (e.g. the ports of a multi output driver)*/
+        bool AudioOut(float *outl, float *outr,
+                      float *const *partl = nullptr,
+                      float *const *partr = nullptr) REALTIME;
         /**Audio Output (for callback mode).
          * This allows the program to be controlled by an external program*/
         void GetAudioOutSamples(size_t nsamples,
@@ -205,12 +211,15 @@ class Master
         rtosc::MidiMapperRT midi;
 
         bool   frozenState;//read-only parameters for threadsafe actions
+        //Leave the read-only mode and apply the controllers received in it
+        void thawState(void);
         Allocator *memory;
         rtosc::ThreadLink *bToU;
         rtosc::ThreadLink *uToB;
         bool pendingMemory;
         const SYNTH_T &synth;
         const int& gzip_compression; //!< value from config
+        const int& osc_budget; //!< value from config, percent of a buffer
         bool SaveFullXml; // value from config
 
         //Heartbeat for identifying plugin offline modes
@@ -223,6 +232,20 @@ class Master
         constexpr static std::size_t dnd_buffer_size = 1024;
         char dnd_buffer[dnd_buffer_size] = {0};
 
+        //Statistics of applying UI messages in runOSC (see /osc-stats)
+        struct OscStats {
+            unsigned events;       //messages applied in the last cycle
+            unsigned max_events;   //most messages applied in one cycle
+            unsigned backlog;      //cycles in a row which left messages queued
+            unsigned max_backlog;  //longest backlog, i.e. UI to audio latency
+                                   //in buffers
+            float    drain_us;     //time spent applying in the last cycle
+            float    max_drain_us;
+        } osc_stats;
+
+        //Handlers of recently dispatched messages
+        DispatchCache dispatch_cache;
+
         //Return XML data as string. Must be freed.
         char* getXMLData();
         //Load OSC from OSC savefile
@@ -258,6 +281,19 @@ class Master
 
         Value_Smoothing_Filter smoothing;
 
+        //Controller events received while frozenState is set.
+        //They are applied in thawState() instead of being dropped.
+        struct FrozenController {
+            char   chan;
+            int    type;
+            int    par;     //value, or the note for per note controllers
+            float  value;   //only for per note controllers
+            bool   pernote;
+        };
+        constexpr static int max_frozen_controllers = 256;
+        FrozenController frozen_ctl[max_frozen_controllers];
+        int    frozen_ctl_count;
+
         Value_Smoothing_Filter smoothing_part_l[NUM_MIDI_PARTS];
         Value_Smoothing_Filter smoothing_part_r[NUM_MIDI_PARTS];
 };
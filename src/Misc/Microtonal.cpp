@@ -32,6 +32,8 @@ using namespace rtosc;
 namespace zyn {
 
 #define rObject Microtonal
+#undef rChangeCb
+#define rChangeCb obj->changed();
 
 /**
  * TODO
@@ -39,7 +41,7 @@ namespace zyn {
  * All the rt side needs is a function to map notes at various keyshifts to
  * frequencies, which does not require this many parameters...
  *
- * A good lookup table should be a good finalization of this
+ * The NoteTable does this mapping, but is still computed from all of them.
  */
 const rtosc::Ports Microtonal::ports = {
     rToggle(Pinvertupdown, rShort("inv."), rDefault(false),
@@ -155,6 +157,7 @@ const rtosc::Ports Microtonal::ports = {
 
             for(int i=0; i<self.octavesize; ++i)
                 self.octave[i] = other->octave[i];
+            self.changed();
             d.reply("/free", "sb", "Microtonal", b.len, b.data);
         }},
     {"paste_scl:b", rProp(internal) rDoc("Clone Input scl Object"), 0,
@@ -170,6 +173,7 @@ const rtosc::Ports Microtonal::ports = {
 
             for(int i=0; i<self.octavesize; ++i)
                 self.octave[i] = other->octave[i];
+            self.changed();
             d.reply("/free", "sb", "SclInfo", b.len, b.data);
         }},
     {"paste_kbm:b", rProp(internal) rDoc("Clone Input kbm Object"), 0,
@@ -189,14 +193,28 @@ const rtosc::Ports Microtonal::ports = {
 
             for(int i=0; i<128; ++i)
                 self.Pmapping[i] = other->Pmapping[i];
+            self.changed();
             d.reply("/free", "sb", "KbmInfo", b.len, b.data);
         }},
+    {"paste_table:b", rProp(internal) rDoc("Use a NoteTable built by buildTable()"), 0,
+        [](const char *msg, RtData &d)
+        {
+            rtosc_blob_t b = rtosc_argument(msg, 0).b;
+            assert(b.len == sizeof(void*));
+            Microtonal::NoteTable *table = *(Microtonal::NoteTable**)b.data;
+            Microtonal &self = *(Microtonal*)d.obj;
+            Microtonal::NoteTable *old = self.setTable(table);
+            if(old)
+                d.reply("/free", "sb", "NoteTable", sizeof(void*), &old);
+        }},
 #undef COPY
 };
+#undef rChangeCb
 
 
 Microtonal::Microtonal(const int &gzip_compression)
-    : gzip_compression(gzip_compression)
+    : gzip_compression(gzip_compression), generation(0), built(-1),
+      table(NULL)
 {
     defaults();
 }
@@ -238,10 +256,13 @@ void Microtonal::defaults()
              MICROTONAL_MAX_NAME_LEN,
              "Equal Temperament 12 notes per octave");
     Pglobalfinedetune = 64;
+    changed();
 }
 
 Microtonal::~Microtonal()
-{}
+{
+    delete table;
+}
 
 /*
  * Get the size of the octave
@@ -259,128 +280,190 @@ unsigned char Microtonal::getoctavesize() const
  */
 bool Microtonal::updatenotefreq_log2(float &note_log2_freq, int keyshift) const
 {
-    note_t note = roundf(12.0f * note_log2_freq);
+    //the table is only used while it belongs to the current tuning
+    const NoteTable *t = table;
+    if(t && (t->generation != generation || keyshift < -128 || keyshift > 127))
+        t = NULL;
+
     float freq_log2 = note_log2_freq;
 
+    if(Penabled == 0) { /* 12tET */
+        if(Pinvertupdown != 0)
+            freq_log2 = Pinvertupdowncenter * (2.0f / 12.0f) - freq_log2;
+        freq_log2 += (keyshift - PAnote) / 12.0f;
+    }
+    else { /* Microtonal */
+        const note_t note = roundf(12.0f * note_log2_freq);
+        if(t) {
+            if(!t->mapped[note])
+                return false;
+            freq_log2 = t->key_log2[note] + t->keyshift_log2[keyshift + 128];
+        }
+        else {
+            if(!keyfreq_log2(note, freq_log2))
+                return false;
+            freq_log2 += keyshiftfreq_log2(keyshift);
+        }
+    }
+
+    /* common part */
+    freq_log2 += t ? t->afreq_log2 : log2f(PAfreq);
+    /* global fine detune, -64.0f .. 63.0f cents */
+    freq_log2 += (Pglobalfinedetune - 64.0f) / 1200.0f;
+
+    /* update value */
+    note_log2_freq = freq_log2;
+    return true;
+}
+
+/*
+ * Logarithmic frequency of a key of the microtonal scale relative to the
+ * "A" note, without the keyshift. Returns false if the key is not mapped.
+ */
+bool Microtonal::keyfreq_log2(note_t note, float &freq_log2) const
+{
     // in this function will appears many times things like this:
     // var=(a+b*100)%b
     // I had written this way because if I use var=a%b gives unwanted results when a<0
     // This is the same with divisions.
 
-    if((Pinvertupdown != 0) && ((Pmappingenabled == 0) || (Penabled == 0))) {
+    if((Pinvertupdown != 0) && (Pmappingenabled == 0))
         note = (int) Pinvertupdowncenter * 2 - note;
-        freq_log2 = Pinvertupdowncenter * (2.0f / 12.0f) - freq_log2;
-    }
 
-    /* compute global fine detune, -64.0f .. 63.0f cents */
-    const float globalfinedetunerap_log2 = (Pglobalfinedetune - 64.0f) / 1200.0f;
-
-    if(Penabled == 0) { /* 12tET */
-        freq_log2 += (keyshift - PAnote) / 12.0f;
-    }
-    else { /* Microtonal */
-        const int scaleshift =
-            ((int)Pscaleshift - 64 + (int) octavesize * 100) % octavesize;
-
-        /* compute the keyshift */
-        float rap_keyshift_log2;
-        if(keyshift != 0) {
-            const int kskey = (keyshift + (int)octavesize * 100) % octavesize;
-            const int ksoct = (keyshift + (int)octavesize * 100) / octavesize - 100;
-
-            rap_keyshift_log2 =
-                ((kskey == 0) ? 0.0f : octave[kskey - 1].tuning_log2) +
-                (octave[octavesize - 1].tuning_log2 * ksoct);
+    const int scaleshift =
+        ((int)Pscaleshift - 64 + (int) octavesize * 100) % octavesize;
+
+    /* if the mapping is enabled */
+    if(Pmappingenabled) {
+        if((note < Pfirstkey) || (note > Plastkey))
+            return false;
+
+        /*
+         * Compute how many mapped keys are from middle note to reference note
+         * and find out the proportion between the freq. of middle note and "A" note
+         */
+        int tmp = PAnote - Pmiddlenote;
+        const bool minus = (tmp < 0);
+        if(minus)
+            tmp = -tmp;
+
+        int deltanote = 0;
+        for(int i = 0; i < tmp; ++i)
+            if(Pmapping[i % Pmapsize] >= 0)
+                deltanote++;
+
+        float rap_anote_middlenote_log2;
+        if(deltanote == 0) {
+            rap_anote_middlenote_log2 = 0.0f;
         }
         else {
-            rap_keyshift_log2 = 0.0f;
+            rap_anote_middlenote_log2 =
+                octave[(deltanote - 1) % octavesize].tuning_log2 +
+                octave[octavesize - 1].tuning_log2 * ((deltanote - 1) / octavesize);
+        }
+        if(minus)
+            rap_anote_middlenote_log2 = -rap_anote_middlenote_log2;
+
+        /* Convert from note (midi) to degree (note from the tuning) */
+        int degoct =
+            (note - (int)Pmiddlenote + (int) Pmapsize
+             * 200) / (int)Pmapsize - 200;
+        int degkey = (note - Pmiddlenote + (int)Pmapsize * 100) % Pmapsize;
+        degkey = Pmapping[degkey];
+
+        /* check if key is not mapped */
+        if(degkey < 0)
+            return false;
+
+        /*
+         * Invert the keyboard upside-down if it is asked for
+         * TODO: do the right way by using Pinvertupdowncenter
+         */
+        if(Pinvertupdown != 0) {
+            degkey = octavesize - degkey - 1;
+            degoct = -degoct;
         }
 
-        /* if the mapping is enabled */
-        if(Pmappingenabled) {
-            if((note < Pfirstkey) || (note > Plastkey))
-                goto failure;
-
-            /*
-             * Compute how many mapped keys are from middle note to reference note
-             * and find out the proportion between the freq. of middle note and "A" note
-             */
-            int tmp = PAnote - Pmiddlenote;
-            const bool minus = (tmp < 0);
-            if(minus)
-                tmp = -tmp;
-
-            int deltanote = 0;
-            for(int i = 0; i < tmp; ++i)
-                if(Pmapping[i % Pmapsize] >= 0)
-                    deltanote++;
-
-            float rap_anote_middlenote_log2;
-            if(deltanote == 0) {
-                rap_anote_middlenote_log2 = 0.0f;
-            }
-            else {
-                rap_anote_middlenote_log2 =
-                    octave[(deltanote - 1) % octavesize].tuning_log2 +
-                    octave[octavesize - 1].tuning_log2 * ((deltanote - 1) / octavesize);
-            }
-            if(minus)
-                rap_anote_middlenote_log2 = -rap_anote_middlenote_log2;
-
-            /* Convert from note (midi) to degree (note from the tuning) */
-            int degoct =
-                (note - (int)Pmiddlenote + (int) Pmapsize
-                 * 200) / (int)Pmapsize - 200;
-            int degkey = (note - Pmiddlenote + (int)Pmapsize * 100) % Pmapsize;
-            degkey = Pmapping[degkey];
-
-            /* check if key is not mapped */
-            if(degkey < 0)
-                goto failure;
-
-            /*
-             * Invert the keyboard upside-down if it is asked for
-             * TODO: do the right way by using Pinvertupdowncenter
-             */
-            if(Pinvertupdown != 0) {
-                degkey = octavesize - degkey - 1;
-                degoct = -degoct;
-            }
+        degkey  = degkey + scaleshift;
+        degoct += degkey / octavesize;
+        degkey %= octavesize;
+
+        /* compute the logrithmic frequency of the note */
+        freq_log2 =
+            ((degkey == 0) ? 0.0f : octave[degkey - 1].tuning_log2) +
+            (octave[octavesize - 1].tuning_log2 * degoct) -
+            rap_anote_middlenote_log2;
+    }
+    else {  /* if the mapping is disabled */
+        const int nt    = note - PAnote + scaleshift;
+        const int ntkey = (nt + (int)octavesize * 100) % octavesize;
+        const int ntoct = (nt - ntkey) / octavesize;
+
+        freq_log2 =
+            octave[(ntkey + octavesize - 1) % octavesize].tuning_log2 +
+            octave[octavesize - 1].tuning_log2 * (ntkey ? ntoct : (ntoct - 1));
+    }
+    if(scaleshift)
+        freq_log2 -= octave[scaleshift - 1].tuning_log2;
+    return true;
+}
+
+/*
+ * Logarithmic frequency of a keyshift in the microtonal scale
+ */
+float Microtonal::keyshiftfreq_log2(int keyshift) const
+{
+    if(keyshift == 0)
+        return 0.0f;
 
-            degkey  = degkey + scaleshift;
-            degoct += degkey / octavesize;
-            degkey %= octavesize;
+    const int kskey = (keyshift + (int)octavesize * 100) % octavesize;
+    const int ksoct = (keyshift + (int)octavesize * 100) / octavesize - 100;
 
-            /* compute the logrithmic frequency of the note */
-            freq_log2 =
-                ((degkey == 0) ? 0.0f : octave[degkey - 1].tuning_log2) +
-                (octave[octavesize - 1].tuning_log2 * degoct) -
-                rap_anote_middlenote_log2;
-        }
-        else {  /* if the mapping is disabled */
-            const int nt    = note - PAnote + scaleshift;
-            const int ntkey = (nt + (int)octavesize * 100) % octavesize;
-            const int ntoct = (nt - ntkey) / octavesize;
-
-            freq_log2 =
-                octave[(ntkey + octavesize - 1) % octavesize].tuning_log2 +
-                octave[octavesize - 1].tuning_log2 * (ntkey ? ntoct : (ntoct - 1));
-        }
-        if(scaleshift)
-            freq_log2 -= octave[scaleshift - 1].tuning_log2;
-        freq_log2 += rap_keyshift_log2;
+    return ((kskey == 0) ? 0.0f : octave[kskey - 1].tuning_log2) +
+           (octave[octavesize - 1].tuning_log2 * ksoct);
+}
+
+Microtonal::NoteTable *Microtonal::buildTable(void) const
+{
+    const unsigned current = generation;
+    if(current == built)
+        return NULL;
+    built = current;
+
+    NoteTable *t = new NoteTable;
+    t->generation = current;
+    //a tuning without degrees or mapped keys has no notes
+    const bool valid = octavesize && (Pmapsize || !Pmappingenabled);
+    for(int note = 0; note < 256; ++note) {
+        t->key_log2[note] = 0.0f;
+        t->mapped[note]   = valid && keyfreq_log2(note, t->key_log2[note]);
     }
+    for(int keyshift = -128; keyshift < 128; ++keyshift)
+        t->keyshift_log2[keyshift + 128] =
+            octavesize ? keyshiftfreq_log2(keyshift) : 0.0f;
+    t->afreq_log2 = log2f(PAfreq);
+    return t;
+}
 
-    /* common part */
-    freq_log2 += log2f(PAfreq);
-    freq_log2 += globalfinedetunerap_log2;
+bool Microtonal::tableOutdated(void) const
+{
+    return generation != built;
+}
 
-    /* update value */
-    note_log2_freq = freq_log2;
-    return true;
+Microtonal::NoteTable *Microtonal::setTable(NoteTable *table_)
+{
+    NoteTable *old = table;
+    table = table_;
+    return old;
+}
 
-failure:
-    return false;
+//generations are unique among all instances, so a table is never taken for
+//the one of another Microtonal
+static std::atomic<unsigned> generations(0);
+
+void Microtonal::changed(void)
+{
+    generation = ++generations;
 }
 
 /*
@@ -547,6 +630,7 @@ int Microtonal::texttotunings(const char *text)
         octave[i].x1     = tmpoctave[i].x1;
         octave[i].x2     = tmpoctave[i].x2;
     }
+    changed();
     return -1; //ok
 }
 
@@ -586,6 +670,7 @@ void Microtonal::texttomapping(const char *text)
     if(tx == 0)
         tx = 1;
     Pmapsize = tx;
+    changed();
 }
 
 /*
@@ -855,6 +940,7 @@ void Microtonal::getfromXML(XMLwrapper& xml)
         xml.exitbranch();
     }
     apply();
+    changed();
 }
 
 
@@ -14,6 +14,7 @@
 #ifndef MICROTONAL_H
 #define MICROTONAL_H
 
+#include <atomic>
 #include <cstdio>
 #include <stdint.h>
 #include "../globals.h"
@@ -76,6 +77,30 @@ class Microtonal
          */
         float getnotefreq(float note_log2_freq, int keyshift) const;
 
+        /**
+         * Logarithmic frequencies of all keys of the current tuning, so
+         * updatenotefreq_log2() does not have to walk through the scale and
+         * the mapping on every note.
+         */
+        struct NoteTable {
+            unsigned generation; //of the tuning the table was built from
+            bool  mapped[256];   //by note
+            float key_log2[256]; //by note, without keyshift and "A" freq
+            float keyshift_log2[256]; //by keyshift + 128
+            float afreq_log2;
+        };
+
+        /**Build the table of the current tuning (not realtime safe)
+         * @returns NULL if the last built table is still up to date*/
+        NoteTable *buildTable(void) const;
+        /**True if the tuning changed since the last buildTable()*/
+        bool tableOutdated(void) const;
+        /**Look up notes in table from now on, while it is up to date
+         * @returns the previous table, to be freed by the caller*/
+        NoteTable *setTable(NoteTable *table_);
+        /**Outdate the table, to be called after the tuning was changed*/
+        void changed(void);
+
         //Parameters
         /**if the keys are inversed (the pitch is lower to keys from the right direction)*/
         unsigned char Pinvertupdown;
@@ -160,7 +185,14 @@ class Microtonal
         static int linetotunings(struct OctaveTuning &tune, const char *line);
         void apply(void);
 
+        bool keyfreq_log2(note_t note, float &freq_log2) const;
+        float keyshiftfreq_log2(int keyshift) const;
+
         const int& gzip_compression;
+
+        std::atomic<unsigned> generation; //changes with every change of the tuning
+        mutable unsigned built; //generation of the last buildTable()
+        NoteTable *table;
 };
 
 }
@@ -50,6 +50,7 @@
 #include "../Params/ADnoteParameters.h"
 #include "../Params/SUBnoteParameters.h"
 #include "../Params/PADnoteParameters.h"
+#include "../Params/PADsampleStore.h"
 #include "../DSP/FFTwrapper.h"
 #include "../Synth/OscilGen.h"
 #include "../Nio/Nio.h"
@@ -202,6 +203,8 @@ void deallocate(const char *str, void *v)
         delete (SclInfo*)v;
     else if(!strcmp(str, "Microtonal"))
         delete (Microtonal*)v;
+    else if(!strcmp(str, "NoteTable"))
+        delete (Microtonal::NoteTable*)v;
     else if(!strcmp(str, "ADnoteParameters"))
         delete (ADnoteParameters*)v;
     else if(!strcmp(str, "SUBnoteParameters"))
@@ -223,7 +226,7 @@ void deallocate(const char *str, void *v)
     else if(!strcmp(str, "rtosc::AutomationMgr"))
         delete (rtosc::AutomationMgr*)v;
     else if(!strcmp(str, "PADsample"))
-        delete[] (float*)v;
+        PADsampleStore::release(v);
     else
         fprintf(stderr, "Unknown type '%s', leaking pointer %p!!\n", str, v);
 }
@@ -246,8 +249,9 @@ void preparePadSynth(string path, PADnoteParameters *p, rtosc::RtData &d)
                        {
                            //printf("sending info to '%s'\n",
                            //       (path+to_s(N)).c_str());
-                           d.chain((path+to_s(N)).c_str(), "ifb",
-                                   s.size, s.basefreq, sizeof(float*), &s.smp);
+                           d.chain((path+to_s(N)).c_str(), "ifbbf",
+                                   s.size, s.basefreq, sizeof(float*), &s.smp,
+                                   sizeof(short*), &s.smp16, s.scale);
                        }, []{return false;}, 1);
 #else
     std::mutex rtdata_mutex;
@@ -258,16 +262,20 @@ void preparePadSynth(string path, PADnoteParameters *p, rtosc::RtData &d)
                            //       (path+to_s(N)).c_str());
                            rtdata_mutex.lock();
                            // send non-realtime computed data to PADnoteParameters
-                           d.chain((path+to_s(N)).c_str(), "ifb",
-                                   s.size, s.basefreq, sizeof(float*), &s.smp);
+                           d.chain((path+to_s(N)).c_str(), "ifbbf",
+                                   s.size, s.basefreq, sizeof(float*), &s.smp,
+                                   sizeof(short*), &s.smp16, s.scale);
                            rtdata_mutex.unlock();
                        }, []{return false;});
 #endif
 
     //clear out unused samples
+    float *nosmp   = NULL;
+    short *nosmp16 = NULL;
     for(unsigned i = num; i < PAD_MAX_SAMPLES; ++i) {
-        d.chain((path+to_s(i)).c_str(), "ifb",
-                0, 440.0f, sizeof(float*), NULL);
+        d.chain((path+to_s(i)).c_str(), "ifbbf",
+                0, 440.0f, sizeof(float*), &nosmp,
+                sizeof(short*), &nosmp16, 1.0f);
     }
 }
 
@@ -545,6 +553,8 @@ namespace Nio
                     d.reply(d.loc, Nio::getAudioCompressor() ? "T" : "F");
                 else
                     Nio::setAudioCompressor(rtosc_argument(msg,0).T);}},
+        {"latency:", 0, 0, [](const char *, rtosc::RtData &d) {
+                d.reply(d.loc, "i", (int)Nio::getLatency());}},
     };
 }
 
@@ -590,16 +600,36 @@ public:
     void doReadOnlyOpPlugin(std::function<void()> read_only_fn);
     bool doReadOnlyOpNormal(std::function<void()> read_only_fn, bool canfail=false);
 
+    //Save an XML file, with the backend only being frozen while add_fn
+    //copies the parameters into the in-memory tree. Rendering, compressing
+    //and writing the file happen afterwards.
+    //Returns the result of XMLwrapper::saveXMLfile()
+    int saveXMLSnapshot(const char *filename, const char *branch,
+                        std::function<void(XMLwrapper&)> add_fn)
+    {
+        // filename may point into a ThreadLink buffer (see savePart)
+        const std::string fname = filename;
+        XMLwrapper xml;
+        doReadOnlyOp([&xml,branch,&add_fn](){
+                if(branch)
+                    xml.beginbranch(branch);
+                add_fn(xml);
+                if(branch)
+                    xml.endbranch();});
+        return xml.saveXMLfile(fname, master->gzip_compression);
+    }
+
     void savePart(int npart, const char *filename)
     {
         // Due to a possible bug in ThreadLink, filename may get trashed when
         // the read-only operation writes to the buffer again. Copy to string:
         std::string fname = filename;
         //printf("saving part(%d,'%s')\n", npart, filename);
-        doReadOnlyOp([this,fname,npart](){
-                int res = master->part[npart]->saveXML(fname.c_str());
-                (void)res;
-                /*printf("results: '%s' '%d'\n",fname.c_str(), res);*/});
+        int res = saveXMLSnapshot(fname.c_str(), "INSTRUMENT",
+                [this,npart](XMLwrapper &xml){
+                    master->part[npart]->add2XMLinstrument(xml);});
+        (void)res;
+        /*printf("results: '%s' '%d'\n",fname.c_str(), res);*/
     }
 
     void loadPendingBank(int par, Bank &bank)
@@ -716,6 +746,8 @@ public:
                     return -1;
                 }
             }
+            //computes the PAD samples of all parts in parallel and returns
+            //when all are done, the backend must not see m before that
             m->applyparameters();
         }
 
@@ -751,6 +783,7 @@ public:
             zyn::SYNTH_T* synth = new zyn::SYNTH_T;
             synth->buffersize = master->synth.buffersize;
             synth->samplerate = master->synth.samplerate;
+            synth->controlperiod = master->synth.controlperiod;
             synth->alias();
 
             zyn::Master master2(*synth, &config);
@@ -767,7 +800,10 @@ public:
             savefile = rtosc::save_to_file(getNonRtParamPorts(), this, "ZynAddSubFX", m_version);
             savefile += '\n';
 
-            doReadOnlyOp([this,filename,&dispatcher,&master2,&savefile,&res]()
+            // only the state is taken while the backend is frozen, comparing
+            // and writing happen afterwards
+            char *xml = NULL, *xml2 = NULL;
+            doReadOnlyOp([this,&dispatcher,&master2,&savefile,&res,&xml,&xml2]()
             {
                 savefile = master->saveOSC(savefile);
 #if 1
@@ -795,65 +831,67 @@ public:
 
                 dispatcher.updateMaster(old_master);
 #endif
-                if(res < 0)
+                if(res >= 0)
                 {
-                    std::cerr << "invalid savefile (or a backend error)!" << std::endl;
-                    std::cerr << "complete savefile:" << std::endl;
-                    std::cerr << savefile << std::endl;
-                    std::cerr << "first entry that could not be parsed:" << std::endl;
+                    xml  = master->getXMLData();
+                    xml2 = master2.getXMLData();
+                }
+            });
 
-                    for(int i = -res + 1; savefile[i]; ++i)
-                    if(savefile[i] == '\n')
-                    {
-                        savefile.resize(i);
-                        break;
-                    }
-                    std::cerr << (savefile.c_str() - res) << std::endl;
+            if(res < 0)
+            {
+                std::cerr << "invalid savefile (or a backend error)!" << std::endl;
+                std::cerr << "complete savefile:" << std::endl;
+                std::cerr << savefile << std::endl;
+                std::cerr << "first entry that could not be parsed:" << std::endl;
 
-                    res = -1;
-                }
-                else
+                for(int i = -res + 1; savefile[i]; ++i)
+                if(savefile[i] == '\n')
                 {
-                    char* xml = master->getXMLData(),
-                        * xml2 = master2.getXMLData();
-                    // TODO: below here can be moved out of read only op
+                    savefile.resize(i);
+                    break;
+                }
+                std::cerr << (savefile.c_str() - res) << std::endl;
 
-                    res = strcmp(xml, xml2) ? -1 : 0;
+                res = -1;
+            }
+            else
+            {
+                res = strcmp(xml, xml2) ? -1 : 0;
 
-                    if(res == 0)
+                if(res == 0)
+                {
+                    if(filename && *filename)
                     {
-                        if(filename && *filename)
-                        {
-                            std::ofstream ofs(filename);
-                            ofs << savefile;
-                        }
-                        else {
-                            std::cout << "The savefile content follows" << std::endl;
-                            std::cout << "---->8----" << std::endl;
-                            std::cout << savefile << std::endl;
-                            std::cout << "---->8----" << std::endl;
-                        }
+                        std::ofstream ofs(filename);
+                        ofs << savefile;
                     }
-                    else
-                    {
+                    else {
+                        std::cout << "The savefile content follows" << std::endl;
+                        std::cout << "---->8----" << std::endl;
                         std::cout << savefile << std::endl;
-                        std::cerr << "Can not write OSC savefile!! (see tmp1.txt and tmp2.txt)"
-                                  << std::endl;
-                        std::ofstream tmp1("tmp1.txt"), tmp2("tmp2.txt");
-                        tmp1 << xml;
-                        tmp2 << xml2;
-                        res = -1;
+                        std::cout << "---->8----" << std::endl;
                     }
-
-                    free(xml);
-                    free(xml2);
                 }
-            });
+                else
+                {
+                    std::cout << savefile << std::endl;
+                    std::cerr << "Can not write OSC savefile!! (see tmp1.txt and tmp2.txt)"
+                              << std::endl;
+                    std::ofstream tmp1("tmp1.txt"), tmp2("tmp2.txt");
+                    tmp1 << xml;
+                    tmp2 << xml2;
+                    res = -1;
+                }
+
+                free(xml);
+                free(xml2);
+            }
         }
         else // xml format
         {
-            doReadOnlyOp([this,filename,&res](){
-                             res = master->saveXML(filename);});
+            res = saveXMLSnapshot(filename, "MASTER",
+                    [this](XMLwrapper &xml){master->add2XML(xml);});
         }
         return res;
     }
@@ -871,9 +909,8 @@ public:
 
     void saveXsz(const char *filename, rtosc::RtData &d)
     {
-        int err = 0;
-        doReadOnlyOp([this,filename,&err](){
-                err = master->microtonal.saveXML(filename);});
+        int err = saveXMLSnapshot(filename, "MICROTONAL",
+                [this](XMLwrapper &xml){master->microtonal.add2XML(xml);});
         if(err)
             d.reply("/alert", "s", "Error: Could not save the xsz file.");
     }
@@ -900,8 +937,27 @@ public:
             d.chain("/microtonal/paste_kbm", "b", sizeof(void*), &kbm);
     }
 
+    //Rebuild the note table of a tuning which was changed by the backend.
+    //The tuning is only read while the backend is frozen (or not running).
+    void updateTuning(Master *m)
+    {
+        if(!m->microtonal.tableOutdated())
+            return;
+        Microtonal::NoteTable *table = NULL;
+        if(offline)
+            table = m->microtonal.buildTable();
+        else
+            doReadOnlyOp([m,&table](){table = m->microtonal.buildTable();});
+        if(table)
+            uToB->write("/microtonal/paste_table", "b", sizeof(void*), &table);
+    }
+
     void updateResources(Master *m)
     {
+        //m is not run by the backend yet, so its table is set directly
+        if(Microtonal::NoteTable *table = m->microtonal.buildTable())
+            delete m->microtonal.setTable(table);
+
         obj_store.clear();
         obj_store.extractMaster(m);
         for(int i=0; i<NUM_MIDI_PARTS; ++i)
@@ -935,6 +991,8 @@ public:
 
         autoSave.tick();
 
+        updateTuning(master);
+
         heartBeat(master);
 
         if(offline)
@@ -1536,9 +1594,16 @@ static rtosc::Ports middwareSnoopPortsWithoutNonRtParams = {
         const int part_id = rtosc_argument(msg, 0).i;
         const int slot    = rtosc_argument(msg, 1).i;
 
-        int err = 0;
-        impl.doReadOnlyOp([&impl,slot,part_id,&err](){
-                err = impl.master->bank.savetoslot(slot, impl.master->part[part_id]);});
+        //only copy the part while frozen, the bank writes the file
+        XMLwrapper xml;
+        std::string name;
+        impl.doReadOnlyOp([&impl,part_id,&xml,&name](){
+                Part *part = impl.master->part[part_id];
+                name = (char *) part->Pname;
+                xml.beginbranch("INSTRUMENT");
+                part->add2XMLinstrument(xml);
+                xml.endbranch();});
+        const int err = impl.master->bank.savetoslot(slot, name, xml);
         if(err) {
             d.reply("/alert", "s",
                     "Failed To Save To Bank Slot, please check file permissions");
@@ -1604,12 +1669,9 @@ static rtosc::Ports middwareSnoopPortsWithoutNonRtParams = {
         rEnd},
     {"save_xlz:s", 0, 0,
         rBegin;
-        impl.doReadOnlyOp([&]() {
-                const char *file = rtosc_argument(msg, 0).s;
-                XMLwrapper xml;
-                Master::saveAutomation(xml, impl.master->automate);
-                xml.saveXMLfile(file, impl.master->gzip_compression);
-                });
+        const char *file = rtosc_argument(msg, 0).s;
+        impl.saveXMLSnapshot(file, nullptr, [&impl](XMLwrapper &xml){
+                Master::saveAutomation(xml, impl.master->automate);});
         rEnd},
     {"load_xlz:s", 0, 0,
         rBegin;
@@ -1938,12 +2000,12 @@ MiddleWareImpl::MiddleWareImpl(MiddleWare *mw, SYNTH_T synth_,
     :parent(mw), config(config), ui(nullptr), synth(std::move(synth_)),
     presetsstore(*config), autoSave(-1, [this]() {
             auto master = this->master;
-            this->doReadOnlyOp([master](){
-                std::string home = getenv("HOME");
-                std::string save_file = home+"/.local/zynaddsubfx-"+to_s(getpid())+"-autosave.xmz";
-                printf("doing an autosave <%s>...\n", save_file.c_str());
-                int res = master->saveXML(save_file.c_str());
-                (void)res;});})
+            std::string home = getenv("HOME");
+            std::string save_file = home+"/.local/zynaddsubfx-"+to_s(getpid())+"-autosave.xmz";
+            printf("doing an autosave <%s>...\n", save_file.c_str());
+            int res = this->saveXMLSnapshot(save_file.c_str(), "MASTER",
+                    [master](XMLwrapper &xml){master->add2XML(xml);});
+            (void)res;})
 {
     bToU = new rtosc::ThreadLink(4096*2*16,1024/16);
     uToB = new rtosc::ThreadLink(4096*2*16,1024/16);
@@ -1967,6 +2029,8 @@ MiddleWareImpl::MiddleWareImpl(MiddleWare *mw, SYNTH_T synth_,
     idle = 0;
     idle_ptr = 0;
 
+    PADsampleStore::setCompact(config->cfg.CompactPADsamples);
+
     recreateMinimalMaster();
     osc    = GUI::genOscInterface(mw);
 
@@ -2031,15 +2095,20 @@ void zyn::MiddleWareImpl::recreateMinimalMaster()
  *      writes are done and assuming the freezing logic is sound, then it is
  *      impossible for any other parameter to change at this time
  *   3) Middleware performs saving operation
+ *      For XML saves (see saveXMLSnapshot()) and bank slots this only
+ *      copies the parameters into an in-memory tree, OSC saves also take
+ *      the XML of both masters they compare
  *   4) Middleware sends /thaw_state to backend
  *   5) Restore in order execution
+ *   6) Render, compress, compare and write what was copied
  *
  * Procedure Backend:
- *   1) Observe /freeze_state and disable all mutating events (MIDI CC)
+ *   1) Observe /freeze_state and defer all mutating events (MIDI CC)
  *   2) Run a memory release to ensure that all writes are complete
  *   3) Send /state_frozen to Middleware
  *   time...
- *   4) Observe /thaw_state and resume normal processing
+ *   4) Observe /thaw_state, apply the deferred events in order and resume
+ *      normal processing
  */
 
 void MiddleWareImpl::doReadOnlyOp(std::function<void()> read_only_fn)
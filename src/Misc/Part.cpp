@@ -280,6 +280,8 @@ Part::Part(Allocator &alloc, const SYNTH_T &synth_, const AbsTime &time_,
     partoutl(new float[synth_.buffersize]),
     partoutr(new float[synth_.buffersize]),
     ctl(synth_, &time_),
+    notesynth(synth_.noteSynth()),
+    modbank(notesynth, alloc),
     microtonal(microtonal_),
     fft(fft_),
     wm(wm_),
@@ -563,7 +565,7 @@ bool Part::NoteOnInternal(note_t note,
     // portamento, but it remains for Portamento.init to make the
     // final decision depending on the portamento enable, threshold and
     // other parameters.
-    Portamento portamento(ctl, synth, isRunningNote, oldfreq_log2, oldportamentofreq_log2, note_log2_freq);
+    Portamento portamento(ctl, notesynth, isRunningNote, oldfreq_log2, oldportamentofreq_log2, note_log2_freq);
     if(portamento.active) {
         // If we're doing legato and we already have a portamento structure,
         // reuse it.
@@ -639,8 +641,8 @@ bool Part::NoteOnInternal(note_t note,
         if(Pkitmode != 0 && !item.validNote(note))
             continue;
 
-        SynthParams pars{memory, ctl, synth, time, vel,
-            portamentoptr, note_log2_freq, false, prng()};
+        SynthParams pars{memory, ctl, notesynth, time, vel,
+            portamentoptr, note_log2_freq, false, prng(), &modbank};
         const int sendto = Pkitmode ? item.sendto() : 0;
 
         // Enforce voice limit, before we trigger new note
@@ -1032,24 +1034,38 @@ void Part::ComputePartSmps()
         memset(partfxinputr[nefx], 0, synth.bufferbytes);
     }
 
-    for(auto &d:notePool.activeDesc()) {
+    for(auto &d:notePool.activeDesc())
         d.age++;
-        for(auto &s:notePool.activeNotes(d)) {
-            float tmpoutr[synth.buffersize];
-            float tmpoutl[synth.buffersize];
-            auto &note = *s.note;
-            note.noteout(&tmpoutl[0], &tmpoutr[0]);
-
-            for(int i = 0; i < synth.buffersize; ++i) { //add the note to part(mix)
-                partfxinputl[d.sendto][i] += tmpoutl[i];
-                partfxinputr[d.sendto][i] += tmpoutr[i];
-            }
 
-            if(note.finished())
-                notePool.kill(s);
+    //the notes render the buffer in blocks, so that their envelopes and
+    //LFOs are updated every control period
+    const int blocksize = notesynth.buffersize;
+    for(int off = 0; off < synth.buffersize; off += blocksize) {
+        modbank.tick();
+
+        for(auto &d:notePool.activeDesc()) {
+            for(auto &s:notePool.activeNotes(d)) {
+                float tmpoutr[blocksize];
+                float tmpoutl[blocksize];
+                auto &note = *s.note;
+                if(note.finished()) //only the samples it delayed are left
+                    note.flushStartOffset(&tmpoutl[0], &tmpoutr[0]);
+                else {
+                    note.noteout(&tmpoutl[0], &tmpoutr[0]);
+                    note.applyStartOffset(&tmpoutl[0], &tmpoutr[0]);
+                }
+
+                for(int i = 0; i < blocksize; ++i) { //add the note to part(mix)
+                    partfxinputl[d.sendto][off + i] += tmpoutl[i];
+                    partfxinputr[d.sendto][off + i] += tmpoutr[i];
+                }
+
+                if(note.finished() && !note.hasDelayedSamples())
+                    notePool.kill(s);
+            }
+        if (d.portamentoRealtime)
+            d.portamentoRealtime->portamento.update();
         }
-    if (d.portamentoRealtime)
-        d.portamentoRealtime->portamento.update();
     }
 
     //Apply part's effects and mix them
@@ -1298,10 +1314,17 @@ void Part::applyparameters(void)
 }
 
 void Part::applyparameters(std::function<bool()> do_abort)
+{
+    std::vector<PADnoteParameters *> pars;
+    getPadParameters(pars);
+    PADnoteParameters::applyparameters(pars, do_abort);
+}
+
+void Part::getPadParameters(std::vector<PADnoteParameters *> &pars) const
 {
     for(int n = 0; n < NUM_KIT_ITEMS; ++n)
         if(kit[n].Ppadenabled && kit[n].padpars)
-            kit[n].padpars->applyparameters(do_abort);
+            pars.push_back(kit[n].padpars);
 }
 
 void Part::initialize_rt(void)
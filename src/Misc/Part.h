@@ -19,8 +19,10 @@
 #include "../globals.h"
 #include "../Params/Controller.h"
 #include "../Containers/NotePool.h"
+#include "../Synth/ModulatorBank.h"
 
 #include <functional>
+#include <vector>
 
 namespace zyn {
 
@@ -91,6 +93,8 @@ class Part
 
         void applyparameters(void) NONREALTIME;
         void applyparameters(std::function<bool()> do_abort) NONREALTIME;
+        /**Append the PAD parameters of all enabled kit items*/
+        void getPadParameters(std::vector<PADnoteParameters *> &pars) const;
 
         void initialize_rt(void) REALTIME;
         void kill_rt(void) REALTIME;
@@ -196,6 +200,10 @@ class Part
         bool killallnotes;
         bool silent; // An output buffer with zeros has been generated
 
+        //settings of the notes, which render each buffer in blocks of the
+        //control period, see SYNTH_T::notebuffersize()
+        const SYNTH_T notesynth;
+        ModulatorBank modbank; //envelopes and LFOs of the notes
         NotePool notePool;
 
         void limit_voices(int new_note);
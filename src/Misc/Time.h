@@ -20,16 +20,29 @@ class AbsTime
     public:
         AbsTime(const SYNTH_T &synth)
             :frames(0),
+            sample_offset(0),
             s(synth){};
         void operator++(){++frames;};
         void operator++(int){frames++;};
         int64_t time() const {return frames;};
         unsigned int tempo;
         float dt() const { return s.dt(); }
+        float controldt() const { return s.controldt(); }
+        float controlticks() const { return s.controlticks(); }
         float framesPerSec() const { return 1/s.dt();}
         int   samplesPerFrame() const {return s.buffersize;}
+
+        //Sample within the next frame at which the events that are being
+        //dispatched happen (e.g. timestamped MIDI), 0 outside of dispatch
+        void setSampleOffset(int offset)
+        {
+            sample_offset = offset < 0 ? 0 :
+                            offset >= s.buffersize ? s.buffersize - 1 : offset;
+        }
+        int sampleOffset() const {return sample_offset;}
     private:
         int64_t frames;
+        int     sample_offset;
         const SYNTH_T &s;
         
 };
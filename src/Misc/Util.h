@@ -14,6 +14,8 @@
 #ifndef UTIL_H
 #define UTIL_H
 
+#include <cmath>
+#include <cstring>
 #include <string>
 #include <sstream>
 #include <stdint.h>
@@ -52,6 +54,41 @@ extern float getdetune(unsigned char type,
                        unsigned short int coarsedetune,
                        unsigned short int finedetune);
 
+/**
+ * 2^x without branches, so the loops which use it vectorize: for the pitch
+ * offsets of the notes (e.g. the pitch bend) and in waveShapeSmps().
+ *
+ * The input range is [-126, 126], x is clamped to it first (a NaN gives
+ * 2^-126), as the integer part of x is added to the exponent bits of the
+ * result, which only holds normal floats there; for x < -127 the biased
+ * exponent (xi + 127) << 23 would even be an undefined shift. Within the
+ * range the relative error is < 2.4e-7, below the resolution of 24 bit
+ * audio, and x = 0 gives exactly 1.
+ */
+inline float fast_exp2f(float x)
+{
+    //a NaN is told by its bits, -ffast-math drops the float compares
+    int32_t bits;
+    memcpy(&bits, &x, sizeof(bits));
+    x = (bits & 0x7fffffff) > 0x7f800000 ? -126.0f : x;
+    x = x > -126.0f ? x : -126.0f;
+    x = x < 126.0f ? x : 126.0f;
+    //nearest integer via truncation, which (unlike floorf) vectorizes
+    //without SSE4.1
+    const float r  = x + 0.5f;
+    const int   ri = (int)r;
+    const int   xi = r < ri ? ri - 1 : ri;
+    const float f  = x - xi;
+    //Taylor series of 2^f on [-0.5, 0.5]
+    const float p = 1.0f + f * (0.69314718f + f * (0.24022651f + f * (0.05550411f
+                  + f * (0.00961813f + f * (0.00133336f + f * 0.00015404f)))));
+    memcpy(&bits, &p, sizeof(bits));
+    bits += xi * (1 << 23);
+    float out;
+    memcpy(&out, &bits, sizeof(out));
+    return out;
+}
+
 /**Try to set current thread to realtime priority program priority
  * \todo see if the right pid is being sent
  * \todo see if this is having desired effect, if not then look at
@@ -145,6 +182,8 @@ inline void sprng(prng_t p)
 #define INT32_MAX_FLOAT   0x7fffff80	/* the float mantissa is only 24-bit */
 #endif
 #define RND (prng() / (INT32_MAX_FLOAT * 1.0f))
+//the same from a generator of its own, e.g. of one thread
+#define RND_r(p) ((prng_r(p) & 0x7fffffff) / (INT32_MAX_FLOAT * 1.0f))
 
 //Linear Interpolation
 float interpolate(const float *data, size_t len, float pos);
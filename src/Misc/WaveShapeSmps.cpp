@@ -12,6 +12,7 @@
 */
 
 #include "WaveShapeSmps.h"
+#include "Util.h"
 #include <cmath>
 
 namespace zyn {
@@ -63,6 +64,39 @@ float polyblampres(float smp, float ws, float dMax)
     return res*dMax/2.0f;
 }
 
+//asin(sin(x)) is a triangle wave, which can be computed directly
+inline float ws_zigzag(float x)
+{
+    const int   k = ws_floor(x * 0.31830988618f + 0.5f);
+    const float r = x - k * 3.14159265f;
+    return (k & 1) ? -r : r;
+}
+
+//0.5 - 1/(e^x + 1) with x limited to [-10, 10]
+//which is 0.5 * tanh(x/2), near 0 its series is used, as the difference
+//of the exponential form loses the precision which tmpv amplifies later
+inline float ws_sigmoid(float x)
+{
+    x = x < -10.0f ? -10.0f : (x > 10.0f ? 10.0f : x);
+    const float y  = 0.5f * x;
+    const float y2 = y * y;
+    const float series = 0.5f * y * (1.0f + y2 * (-0.33333333f + y2 * (0.13333333f
+                       + y2 * (-0.05396825f + y2 * 0.02186949f))));
+    const float expform = 0.5f - 1.0f / (fast_exp2f(x * 1.44269504f) + 1.0f);
+    return fabsf(x) < 0.5f ? series : expform;
+}
+
+//x / (1 + |x|^p)^(1/p), for |x| > 1 as sign(x) / (1 + |x|^-p)^(1/p)
+//so the exponent of fast_exp2f stays in its range
+inline float ws_softlimit(float x, float p, float invp)
+{
+    const float ax = fabsf(x) + 1e-30f;
+    const float q  = p * ws_log2(ax);
+    const float g  = fast_exp2f(-invp * ws_log2(1.0f + fast_exp2f(-fabsf(q))));
+    const float sign = x < 0.0f ? -1.0f : 1.0f;
+    return q > 0.0f ? sign * g : x * g;
+}
+
 void waveShapeSmps(int n,
                    float *smps,
                    unsigned char type,
@@ -76,65 +110,70 @@ void waveShapeSmps(int n,
     float offs = (offset - 64.0f) / 64.0f;
     float tmpv;
 
+    //Anything that does not depend on the sample is computed before the
+    //loops and the loops avoid branches, so they can be vectorized
     switch(type) {
         case 1:
             ws = powf(10, ws * ws * 3.0f) - 1.0f + 0.001f; //Arctangent
-            for(i = 0; i < n; ++i) {
-                smps[i] += offs;
-                smps[i] = atanf(smps[i] * ws) / atanf(ws);
-                smps[i] -= offs;
-            }
+            tmpv = 1.0f / atanf(ws);
+            for(i = 0; i < n; ++i)
+                smps[i] = ws_atan((smps[i] + offs) * ws) * tmpv - offs;
             break;
         case 2:
             ws = ws * ws * 32.0f + 0.0001f; //Asymmetric
             if(ws < 1.0f)
-                tmpv = sinf(ws) + 0.1f;
+                tmpv = 1.0f / (sinf(ws) + 0.1f);
             else
-                tmpv = 1.1f;
+                tmpv = 1.0f / 1.1f;
             for(i = 0; i < n; ++i)
-                smps[i] = sinf(smps[i] * (0.1f + ws - ws * smps[i])) / tmpv;
-            ;
+                smps[i] = ws_sin(smps[i] * (0.1f + ws - ws * smps[i])) * tmpv;
             break;
         case 3:
             ws = ws * ws * ws * 20.0f + 0.0001f; //Pow
+            tmpv = ws < 1.0f ? 3.0f / ws : 3.0f;
             for(i = 0; i < n; ++i) {
-                smps[i] *= ws;
-                if(fabsf(smps[i]) < 1.0f) {
-                    smps[i] = (smps[i] - smps[i] * smps[i] * smps[i]) * 3.0f;
-                    if(ws < 1.0f)
-                        smps[i] /= ws;
-                }
-                else
-                    smps[i] = 0.0f;
+                const float tmp = smps[i] * ws;
+                smps[i] = fabsf(tmp) < 1.0f ? (tmp - tmp * tmp * tmp) * tmpv
+                                            : 0.0f;
             }
             break;
         case 4:
             ws = ws * ws * ws * 32.0f + 0.0001f; //Sine
             if(ws < 1.57f)
-                tmpv = sinf(ws);
+                tmpv = 1.0f / sinf(ws);
             else
                 tmpv = 1.0f;
             for(i = 0; i < n; ++i)
-                smps[i] = sinf(smps[i] * ws) / tmpv;
+                smps[i] = ws_sin(smps[i] * ws) * tmpv;
             break;
         case 5:
             ws = ws * ws + 0.000001f; //Quantisize
+            tmpv = 1.0f / ws;
             for(i = 0; i < n; ++i)
-                smps[i] = floor(smps[i] / ws + 0.5f) * ws;
+                smps[i] = floorf(smps[i] * tmpv + 0.5f) * ws;
             break;
         case 6:
             ws = ws * ws * ws * 32 + 0.0001f; //Zigzag
             if(ws < 1.0f)
-                tmpv = sinf(ws);
+                tmpv = 1.0f / sinf(ws);
             else
                 tmpv = 1.0f;
             for(i = 0; i < n; ++i)
-                smps[i] = asinf(sinf(smps[i] * ws)) / tmpv;
+                smps[i] = ws_zigzag(smps[i] * ws) * tmpv;
             break;
         case 7:
+        {
             ws = powf(2.0f, -ws * ws * 8.0f); //Limiter
             par = par/4;
             if (par > ws - 0.01) par = ws - 0.01;
+            // the polyblamp-limited offset f(offs) is the same for all samples
+            const float reso = polyblampres(offs, ws, par);
+            float limoffs;
+            if (offs>=0)
+                limoffs = ( offs >= ws ? ws-reso : offs-reso );
+            else
+                limoffs = ( offs <= -ws ? -ws+reso : offs+reso );
+            tmpv = 1.0f / ws;
             for(i = 0; i < n; ++i) {
                 // add the offset: x = smps[i] + offs
                 smps[i] += offs;
@@ -145,33 +184,20 @@ void waveShapeSmps(int n,
                 else
                     smps[i] = ( smps[i] < -ws ? -ws+res : smps[i]+res );
                 // and subtract the polyblamp-limited offset again: smps[i] = y - f(offs)
-                res = polyblampres(offs, ws, par);
-                if (offs>=0)
-                    smps[i] -= ( offs >= ws ? ws-res : offs-res );
-                else
-                    smps[i] -= ( offs <= -ws ? -ws+res : offs+res );
                 // divide through the drive factor: prevents limited signals to get low
-                smps[i] /= ws;
-
+                smps[i] = (smps[i] - limoffs) * tmpv;
             }
             break;
+        }
         case 8:
             ws = powf(2.0f, -ws * ws * 8.0f); //Upper Limiter
-            for(i = 0; i < n; ++i) {
-                float tmp = smps[i];
-                if(tmp > ws)
-                    smps[i] = ws;
-                smps[i] *= 2.0f;
-            }
+            for(i = 0; i < n; ++i)
+                smps[i] = (smps[i] > ws ? ws : smps[i]) * 2.0f;
             break;
         case 9:
             ws = powf(2.0f, -ws * ws * 8.0f); //Lower Limiter
-            for(i = 0; i < n; ++i) {
-                float tmp = smps[i];
-                if(tmp < -ws)
-                    smps[i] = -ws;
-                smps[i] *= 2.0f;
-            }
+            for(i = 0; i < n; ++i)
+                smps[i] = (smps[i] < -ws ? -ws : smps[i]) * 2.0f;
             break;
         case 10:
             ws = (powf(2.0f, ws * 6.0f) - 1.0f) / powf(2.0f, 6.0f); //Inverse Limiter
@@ -188,112 +214,88 @@ void waveShapeSmps(int n,
             break;
         case 11:
             ws = powf(5, ws * ws * 1.0f) - 1.0f; //Clip
+            tmpv = (ws + 0.5f) * 0.9999f;
             for(i = 0; i < n; ++i)
-                smps[i] = smps[i]
-                          * (ws + 0.5f) * 0.9999f - floor(
-                    0.5f + smps[i] * (ws + 0.5f) * 0.9999f);
+                smps[i] = smps[i] * tmpv - floorf(0.5f + smps[i] * tmpv);
             break;
         case 12:
             ws = ws * ws * ws * 30 + 0.001f; //Asym2
             if(ws < 0.3f)
-                tmpv = ws;
+                tmpv = 1.0f / ws;
             else
                 tmpv = 1.0f;
             for(i = 0; i < n; ++i) {
-                float tmp = smps[i] * ws;
-                if((tmp > -2.0f) && (tmp < 1.0f))
-                    smps[i] = tmp * (1.0f - tmp) * (tmp + 2.0f) / tmpv;
-                else
-                    smps[i] = 0.0f;
+                const float tmp = smps[i] * ws;
+                smps[i] = ((tmp > -2.0f) && (tmp < 1.0f))
+                          ? tmp * (1.0f - tmp) * (tmp + 2.0f) * tmpv : 0.0f;
             }
             break;
         case 13:
             ws = ws * ws * ws * 32.0f + 0.0001f; //Pow2
             if(ws < 1.0f)
-                tmpv = ws * (1 + ws) / 2.0f;
+                tmpv = 2.0f / (ws * (1 + ws));
             else
                 tmpv = 1.0f;
             for(i = 0; i < n; ++i) {
-                float tmp = smps[i] * ws;
-                if((tmp > -1.0f) && (tmp < 1.618034f))
-                    smps[i] = tmp * (1.0f - tmp) / tmpv;
-                else
-                if(tmp > 0.0f)
-                    smps[i] = -1.0f;
-                else
-                    smps[i] = -2.0f;
+                const float tmp = smps[i] * ws;
+                const float out = tmp > 0.0f ? -1.0f : -2.0f;
+                smps[i] = ((tmp > -1.0f) && (tmp < 1.618034f))
+                          ? tmp * (1.0f - tmp) * tmpv : out;
             }
             break;
         case 14:
+        {
             ws = powf(ws, 5.0f) * 80.0f + 0.0001f; //sigmoid
             if(ws > 10.0f)
-                tmpv = 0.5f;
+                tmpv = 2.0f;
             else
-                tmpv = 0.5f - 1.0f / (expf(ws) + 1.0f);
-            for(i = 0; i < n; ++i) {
-                smps[i] += offs; //add offset
-                // calculate sigmoid function
-                float tmp = smps[i] * ws;
-                if(tmp < -10.0f)
-                    tmp = -10.0f;
-                else
-                if(tmp > 10.0f)
-                    tmp = 10.0f;
-                tmp     = 0.5f - 1.0f / (expf(tmp) + 1.0f);
-                // calculate the same for offset value
-                float tmpo = offs * ws;
-                if(tmpo < -10.0f)
-                    tmpo = -10.0f;
-                else
-                if(tmpo > 10.0f)
-                    tmpo = 10.0f;
-                tmpo     = 0.5f - 1.0f / (expf(tmpo) + 1.0f);
-
-                smps[i] = tmp / tmpv;
-                smps[i] -= tmpo / tmpv; // subtract offset
-            }
+                tmpv = 1.0f / ws_sigmoid(ws);
+            // the sigmoid of the offset value is the same for all samples
+            const float tmpo = ws_sigmoid(offs * ws) * tmpv;
+            for(i = 0; i < n; ++i)
+                smps[i] = ws_sigmoid((smps[i] + offs) * ws) * tmpv - tmpo;
             break;
+        }
         case 15: // tanh soft limiter
+        {
             // f(x) = x / ((1+|x|^n)^(1/n)) // tanh approximation for n=2.5
             // Formula from: Yeh, Abel, Smith (2007): SIMPLIFIED, PHYSICALLY-INFORMED MODELS OF DISTORTION AND OVERDRIVE GUITAR EFFECTS PEDALS
             par = (20.0f) * par * par + (0.1f) * par + 1.0f;  //Pfunpar=32 -> n=2.5
             ws = ws * ws * 35.0f + 1.0f;
-            for(i = 0; i < n; ++i) {
-                smps[i] *= ws;// multiply signal to drive it in the saturation of the function
-                smps[i] += offs; // add dc offset
-                smps[i] = smps[i] / powf(1+powf(fabsf(smps[i]), par), 1/par);
-                smps[i] -= offs / powf(1+powf(fabsf(offs), par), 1/par);
-            }
+            const float invpar = 1.0f / par;
+            // subtract dc offset with the function applied
+            tmpv = offs / powf(1+powf(fabsf(offs), par), invpar);
+            for(i = 0; i < n; ++i)
+                // multiply signal to drive it in the saturation of the function
+                smps[i] = ws_softlimit(smps[i] * ws + offs, par, invpar) - tmpv;
             break;
+        }
         case 16: //cubic distortion
             // f(x) = 1.5 * (x-(x^3/3))
             // Formula from: https://ccrma.stanford.edu/~jos/pasp/Soft_Clipping.html
             // modified with factor 1.5 to go through [1,1] and [-1,-1]
             ws = ws * ws * ws * 20.0f + 0.168f; // plain cubic at drive=44
+            //offset with distortion function applied
+            tmpv = 1.5f * (offs - (offs*offs*offs / 3.0f));
             for(i = 0; i < n; ++i) {
-                smps[i] *= ws; // multiply signal to drive it in the saturation of the function
-                smps[i] += offs; // add dc offset
-                if(fabsf(smps[i]) < 1.0f)
-                    smps[i] = 1.5 * (smps[i] - (smps[i]*smps[i]*smps[i] / 3.0) );
-                else
-                    smps[i] = (smps[i] > 0 ? 1.0f : -1.0f);
-                //subtract offset with distortion function applied
-                smps[i] -= 1.5 * (offs - (offs*offs*offs / 3.0));
+                // multiply signal to drive it in the saturation of the function
+                const float tmp = smps[i] * ws + offs; // add dc offset
+                const float lim = tmp > 0 ? 1.0f : -1.0f;
+                smps[i] = (fabsf(tmp) < 1.0f
+                           ? 1.5f * (tmp - (tmp*tmp*tmp / 3.0f)) : lim) - tmpv;
             }
             break;
         case 17: //square distortion
         // f(x) = x*(2-abs(x))
         // Formula of cubic changed to square but still going through [1,1] and [-1,-1]
             ws = ws * ws * ws * 20.0f + 0.168f; // plain square at drive=44
+            //offset with distortion function applied
+            tmpv = offs*(2-fabsf(offs));
             for(i = 0; i < n; ++i) {
-                smps[i] *= ws; // multiply signal to drive it in the saturation of the function
-                smps[i] += offs; // add dc offset
-                if(fabsf(smps[i]) < 1.0f)
-                    smps[i] = smps[i]*(2-fabsf(smps[i]));
-                else
-                    smps[i] = (smps[i] > 0 ? 1.0f : -1.0f);
-                //subtract offset with distortion function applied
-                smps[i] -= offs*(2-fabsf(offs));
+                // multiply signal to drive it in the saturation of the function
+                const float tmp = smps[i] * ws + offs; // add dc offset
+                const float lim = tmp > 0 ? 1.0f : -1.0f;
+                smps[i] = (fabsf(tmp) < 1.0f ? tmp*(2-fabsf(tmp)) : lim) - tmpv;
             }
             break;
     }
@@ -13,6 +13,9 @@
 #ifndef WAVESHAPESMPS_H
 #define WAVESHAPESMPS_H
 
+#include <cmath>
+#include <stdint.h>
+
 namespace zyn {
 
 //Waveshaping(called by Distortion effect and waveshape from OscilGen)
@@ -27,6 +30,73 @@ void waveShapeSmps(int n,
 float polyblampres(float smp,
                    float ws,
                    float dMax);
+
+/*
+ * Approximations used inside the per sample loops of waveShapeSmps(),
+ * together with fast_exp2f() from Util.h. They are branch free, so the
+ * loops vectorize, and were checked against the double precision libm
+ * results over the ranges the shapes use:
+ *   ws_log2: absolute error < 1.5e-7 on [0.25, 4]
+ *            (otherwise within the rounding of the integer exponent)
+ *   ws_sin:  absolute error < 1.7e-7 for |x| < 200
+ *   ws_atan: absolute error < 1.8e-7
+ * This is below the resolution of 24 bit audio.
+ */
+
+//floor() via truncation, which (unlike floorf) vectorizes without SSE4.1
+//x is limited to +-2^30 first, a NaN gives -2^30; it is told by its bits,
+//as -ffast-math drops the float compares which would catch it
+inline int ws_floor(float x)
+{
+    union { float f; int32_t i; } u = {x};
+    x = (u.i & 0x7fffffff) > 0x7f800000 ? -1073741824.0f : x;
+    x = x > -1073741824.0f ? x : -1073741824.0f;
+    x = x < 1073741824.0f ? x : 1073741824.0f;
+    const int i = (int)x;
+    return x < i ? i - 1 : i;
+}
+
+inline float ws_log2(float x)
+{
+    union { float f; int32_t i; } u = {x};
+    float e = (float)(((u.i >> 23) & 0xff) - 127);
+    u.i = (u.i & 0x007fffff) | 0x3f800000; // mantissa in [1, 2)
+    const bool  big = u.f > 1.41421356f;
+    const float m = big ? u.f * 0.5f : u.f; // mantissa in [sqrt(.5), sqrt(2)]
+    e = big ? e + 1.0f : e;
+    // log2(m) = 2/ln(2) * atanh((m-1)/(m+1))
+    const float s  = (m - 1.0f) / (m + 1.0f);
+    const float s2 = s * s;
+    const float p  = s * (2.88539008f + s2 * (0.96179669f + s2 * (0.57707802f
+                   + s2 * (0.41219858f + s2 * 0.32059890f))));
+    return e + p;
+}
+
+inline float ws_sin(float x)
+{
+    //reduce to [-pi/2, pi/2] with sin(x + k*pi) = (-1)^k * sin(x), in
+    //double, as -ffast-math would merge pi split into two floats again
+    const int   k = ws_floor(x * 0.31830988618f + 0.5f);
+    const float r = (float)(x - k * 3.14159265358979324);
+    const float r2 = r * r;
+    const float s  = r * (1.0f + r2 * (-0.16666657f + r2 * (8.3330255e-3f
+                   + r2 * (-1.9807414e-4f + r2 * 2.6018870e-6f))));
+    return (k & 1) ? -s : s;
+}
+
+inline float ws_atan(float x)
+{
+    //reduce to [0, 1] with atan(x) = pi/2 - atan(1/x)
+    const float ax  = fabsf(x);
+    const bool  inv = ax > 1.0f;
+    const float z   = inv ? 1.0f / ax : ax;
+    const float z2  = z * z;
+    float p = z * (0.99999934f + z2 * (-0.33329856f + z2 * (0.19946536f
+            + z2 * (-0.13908534f + z2 * (0.09642004f + z2 * (-0.05590988f
+            + z2 * (0.02186124f - z2 * 0.00405404f)))))));
+    p = inv ? 1.57079633f - p : p;
+    return x < 0.0f ? -p : p;
+}
 }
 
 #endif
@@ -21,18 +21,556 @@
 #include <zlib.h>
 #include <iostream>
 #include <sstream>
+#include <unordered_map>
+#include <deque>
 
 #include "globals.h"
 #include "Util.h"
 
+#ifdef USE_MXML
+#include <mxml.h>
+#ifndef MXML_MAJOR_VERSION
+#define MXML_MAJOR_VERSION 1
+#endif
+#endif
+
 using namespace std;
 
 namespace zyn {
 
-int  xml_k   = 0;
 bool verbose = false;
 
-const char *XMLwrapper_whitespace_callback(mxml_node_t *node, int where)
+/*
+ * Element tree
+ *
+ * All elements of a tree are owned by one XmlDocument and are freed
+ * together with it. Text is kept for leaf elements like <string>, the
+ * whitespace between child elements is dropped by the parser.
+ */
+class XmlElement
+{
+    public:
+        XmlElement(const string &name_)
+            :name(name_), hastext(false), parent(NULL)
+        {}
+
+        const char *attr(const char *name_) const
+        {
+            for(auto &a:attrs)
+                if(a.name == name_)
+                    return a.value.c_str();
+            return NULL;
+        }
+
+        void append(XmlElement *child)
+        {
+            child->parent = this;
+            children.push_back(child);
+            index.clear();
+        }
+
+        /**First child called name_, having the attribute attr_ with the
+         * given value if attr_ is set (like mxmlFindElement() with
+         * MXML_DESCEND_FIRST)*/
+        XmlElement *find(const char *name_, const char *attr_ = NULL,
+                         const char *value = NULL) const;
+
+        string name;
+        vector<XmlAttr> attrs;
+        string text;
+        bool   hastext;
+        XmlElement *parent;
+        vector<XmlElement *> children;
+
+    private:
+        //children are looked up in an open addressing hash table with up
+        //to three keys per child: its name, name + "name" attribute and
+        //name + "id" attribute, where the first child with a key wins
+        struct Slot {
+            uint32_t    hash;
+            int         kind;
+            XmlElement *elm;
+        };
+
+        void buildindex(void) const;
+        void insert(XmlElement *elm, int kind, const char *value) const;
+
+        mutable vector<Slot> index; //built on the first lookup
+};
+
+class XmlDocument
+{
+    public:
+        XmlElement *create(const string &name)
+        {
+            elements.emplace_back(name);
+            return &elements.back();
+        }
+
+    private:
+        deque<XmlElement> elements;
+};
+
+#define XML_INDEX_MIN 8  //smaller branches are searched linearly
+#define XML_WRAP      72 //line length at which attributes are wrapped
+
+enum {
+    KEY_NAME,
+    KEY_NAME_ATTR,
+    KEY_ID_ATTR
+};
+
+static const char *keyattr[] = {NULL, "name", "id"};
+
+//FNV-1a
+static uint32_t keyhash(const char *name, int kind, const char *value)
+{
+    uint32_t hash = 2166136261u;
+    for(; *name; ++name)
+        hash = (hash ^ (uint8_t)*name) * 16777619u;
+    hash = (hash ^ (uint32_t)kind) * 16777619u;
+    if(value)
+        for(; *value; ++value)
+            hash = (hash ^ (uint8_t)*value) * 16777619u;
+    return hash;
+}
+
+static bool matches(const XmlElement *elm, const char *name,
+                    const char *attr, const char *value)
+{
+    if(elm->name != name)
+        return false;
+    if(attr == NULL)
+        return true;
+    const char *val = elm->attr(attr);
+    return val && (value == NULL || !strcmp(val, value));
+}
+
+XmlElement *XmlElement::find(const char *name_, const char *attr_,
+                             const char *value) const
+{
+    int kind = -1;
+    if(attr_ == NULL)
+        kind = KEY_NAME;
+    else if(value && !strcmp(attr_, "name"))
+        kind = KEY_NAME_ATTR;
+    else if(value && !strcmp(attr_, "id"))
+        kind = KEY_ID_ATTR;
+
+    if(kind < 0 || children.size() <= XML_INDEX_MIN) {
+        for(XmlElement *child:children)
+            if(matches(child, name_, attr_, value))
+                return child;
+        return NULL;
+    }
+
+    if(index.empty())
+        buildindex();
+    const uint32_t hash = keyhash(name_, kind, value);
+    const uint32_t mask = index.size() - 1;
+    for(uint32_t i = hash & mask; index[i].elm; i = (i + 1) & mask)
+        if(index[i].hash == hash && index[i].kind == kind
+           && matches(index[i].elm, name_, attr_, value))
+            return index[i].elm;
+    return NULL;
+}
+
+void XmlElement::buildindex(void) const
+{
+    //keep the table at most half full
+    size_t size = 16;
+    while(size < 6 * children.size())
+        size *= 2;
+    index.assign(size, Slot{0, 0, NULL});
+
+    for(XmlElement *child:children)
+        for(int kind = KEY_NAME; kind <= KEY_ID_ATTR; ++kind) {
+            const char *value = kind == KEY_NAME ? NULL
+                                : child->attr(keyattr[kind]);
+            if(kind == KEY_NAME || value)
+                insert(child, kind, value);
+        }
+}
+
+void XmlElement::insert(XmlElement *elm, int kind, const char *value) const
+{
+    const uint32_t hash = keyhash(elm->name.c_str(), kind, value);
+    const uint32_t mask = index.size() - 1;
+    uint32_t i = hash & mask;
+    for(; index[i].elm; i = (i + 1) & mask)
+        if(index[i].hash == hash && index[i].kind == kind
+           && matches(index[i].elm, elm->name.c_str(), keyattr[kind], value))
+            return; //an earlier sibling has the same key
+    index[i] = Slot{hash, kind, elm};
+}
+
+static XmlElement *findchild(const XmlElement *parent, const char *name,
+                             const char *attr = NULL,
+                             const char *value = NULL)
+{
+    return parent ? parent->find(name, attr, value) : NULL;
+}
+
+//document header, the data is added as its next child
+static XmlElement *createheader(XmlDocument &doc)
+{
+    XmlElement *tree = doc.create("?xml version=\"1.0f\" encoding=\"UTF-8\"?");
+    tree->append(doc.create("!DOCTYPE ZynAddSubFX-data"));
+    return tree;
+}
+
+//drop the whitespace between the children of a loaded element
+static void closetext(XmlElement *elm)
+{
+    if(!elm->children.empty()) {
+        bool blank = true;
+        for(char c:elm->text)
+            blank &= isspace(c) != 0;
+        if(blank)
+            elm->text.clear();
+    }
+    elm->hastext = !elm->text.empty();
+}
+
+#ifndef USE_MXML
+/*
+ * XML text output
+ *
+ * Writes the same layout as mxml did with the old whitespace callback:
+ * every element starts on a new line, closing tags too except for
+ * <string>, and attributes are wrapped at XML_WRAP columns. Processing
+ * instructions and declarations have no closing tag.
+ */
+class XmlWriter
+{
+    public:
+        XmlWriter(void)
+            :col(0)
+        {}
+
+        void element(const XmlElement *elm)
+        {
+            const bool special = elm->name[0] == '?' || elm->name[0] == '!';
+
+            data += "\n<";
+            data += elm->name;
+            col   = elm->name.size() + 1;
+            for(auto &a:elm->attrs) {
+                const int width = a.name.size() + a.value.size() + 3;
+                if(col + width > XML_WRAP) {
+                    data += '\n';
+                    col   = 0;
+                }
+                else {
+                    data += ' ';
+                    col++;
+                }
+                data += a.name;
+                data += "=\"";
+                escaped(a.value);
+                data += '"';
+                col  += width;
+            }
+
+            if(elm->hastext || !elm->children.empty()) {
+                data += '>';
+                col++;
+                if(elm->hastext) {
+                    escaped(elm->text);
+                    col += elm->text.size();
+                }
+                for(const XmlElement *child:elm->children)
+                    element(child);
+                if(!special) {
+                    if(elm->name != "string") {
+                        data += '\n';
+                        col   = 0;
+                    }
+                    data += "</";
+                    data += elm->name;
+                    data += '>';
+                    col  += elm->name.size() + 3;
+                }
+            }
+            else if(special) {
+                data += '>';
+                col++;
+            }
+            else {
+                data += " />";
+                col  += 3;
+            }
+        }
+
+        string data;
+        int    col;
+
+    private:
+        void escaped(const string &s)
+        {
+            for(char c:s)
+                switch(c) {
+                    case '&': data += "&amp;";  break;
+                    case '<': data += "&lt;";   break;
+                    case '>': data += "&gt;";   break;
+                    case '"': data += "&quot;"; break;
+                    default:  data += c;
+                }
+        }
+};
+
+/*
+ * XML text input
+ *
+ * Parses the text in a single pass and appends each element to its parent
+ * as soon as its attributes are read, without building any intermediate
+ * tree. Comments are skipped, CDATA sections become text. Processing
+ * instructions and declarations become childless elements named after their
+ * whole content (e.g. "!DOCTYPE ZynAddSubFX-data"), and a leading <?xml?>
+ * holds the following top level elements, so a loaded tree has the same
+ * shape as one made by the XMLwrapper constructor.
+ */
+class XmlParser
+{
+    public:
+        XmlParser(XmlDocument &doc_, const char *data)
+            :doc(doc_), pos(data)
+        {}
+
+        //@returns the topmost element or NULL for malformed data
+        XmlElement *parse(void)
+        {
+            XmlElement *tree = NULL, *parent = NULL;
+
+            while(isspace(*pos))
+                ++pos;
+            while(*pos) {
+                if(*pos != '<') {
+                    const char *start = pos;
+                    while(*pos && *pos != '<')
+                        ++pos;
+                    if(parent)
+                        decode(start, pos, parent->text);
+                    continue;
+                }
+
+                ++pos;
+                if(!strncmp(pos, "!--", 3)) {
+                    const char *end = strstr(pos + 3, "-->");
+                    if(end == NULL)
+                        return NULL;
+                    pos = end + 3;
+                }
+                else if(!strncmp(pos, "![CDATA[", 8)) {
+                    const char *end = strstr(pos + 8, "]]>");
+                    if(end == NULL || parent == NULL)
+                        return NULL;
+                    parent->text.append(pos + 8, end);
+                    pos = end + 3;
+                }
+                else if(*pos == '?' || *pos == '!') {
+                    const char *end = strchr(pos, '>');
+                    if(end == NULL)
+                        return NULL;
+                    XmlElement *elm = doc.create(string(pos, end));
+                    pos = end + 1;
+                    if(parent)
+                        parent->append(elm);
+                    else if(tree == NULL)
+                        tree = elm;
+                    if(parent == NULL && elm->name[0] == '?')
+                        parent = elm;
+                }
+                else if(*pos == '/') {
+                    const char *start = ++pos;
+                    while(*pos && *pos != '>' && !isspace(*pos))
+                        ++pos;
+                    if(parent == NULL
+                       || parent->name.compare(0, string::npos, start,
+                                               pos - start))
+                        return NULL; //mismatched close tag
+                    while(isspace(*pos))
+                        ++pos;
+                    if(*pos++ != '>')
+                        return NULL;
+                    closetext(parent);
+                    parent = parent->parent;
+                    if(parent == NULL)
+                        break;
+                }
+                else {
+                    bool        leaf;
+                    XmlElement *elm = element(leaf);
+                    if(elm == NULL)
+                        return NULL;
+                    if(parent)
+                        parent->append(elm);
+                    else if(tree == NULL)
+                        tree = elm;
+                    else
+                        break; //only one top level element
+                    if(!leaf)
+                        parent = elm;
+                }
+            }
+
+            //only the <?xml?> header may be left open
+            if(parent && parent->name[0] != '?')
+                return NULL;
+            return tree;
+        }
+
+    private:
+        //open tag after its '<', including its attributes
+        XmlElement *element(bool &leaf)
+        {
+            const char *start = pos;
+            while(*pos && !isspace(*pos) && *pos != '/' && *pos != '>')
+                ++pos;
+            if(pos == start)
+                return NULL;
+            XmlElement *elm = doc.create(string(start, pos));
+
+            while(true) {
+                while(isspace(*pos))
+                    ++pos;
+                if(*pos == '>') {
+                    ++pos;
+                    leaf = false;
+                    return elm;
+                }
+                if(pos[0] == '/' && pos[1] == '>') {
+                    pos += 2;
+                    leaf = true;
+                    return elm;
+                }
+
+                start = pos;
+                while(*pos && !isspace(*pos) && *pos != '='
+                      && *pos != '/' && *pos != '>')
+                    ++pos;
+                if(pos == start)
+                    return NULL;
+                elm->attrs.push_back(XmlAttr{string(start, pos), ""});
+
+                while(isspace(*pos))
+                    ++pos;
+                if(*pos != '=')
+                    continue;
+                ++pos;
+                while(isspace(*pos))
+                    ++pos;
+                if(*pos == '"' || *pos == '\'') {
+                    const char *end = strchr(pos + 1, *pos);
+                    if(end == NULL)
+                        return NULL;
+                    decode(pos + 1, end, elm->attrs.back().value);
+                    pos = end + 1;
+                }
+                else {
+                    start = pos;
+                    while(*pos && !isspace(*pos) && *pos != '>')
+                        ++pos;
+                    decode(start, pos, elm->attrs.back().value);
+                }
+            }
+        }
+
+        //append text with its entities replaced
+        static void decode(const char *begin, const char *end, string &dest)
+        {
+            while(begin < end) {
+                const char *amp = (const char *)memchr(begin, '&', end - begin);
+                if(amp == NULL) {
+                    dest.append(begin, end);
+                    return;
+                }
+                dest.append(begin, amp);
+                begin = amp + 1;
+
+                const char *semi = (const char *)memchr(amp, ';', end - amp);
+                if(semi == NULL) {
+                    dest += '&';
+                    continue;
+                }
+                const string entity(amp + 1, semi);
+                if(entity == "amp")
+                    dest += '&';
+                else if(entity == "lt")
+                    dest += '<';
+                else if(entity == "gt")
+                    dest += '>';
+                else if(entity == "quot")
+                    dest += '"';
+                else if(entity == "apos")
+                    dest += '\'';
+                else if(entity.size() > 1 && entity[0] == '#') {
+                    const bool    hex = entity[1] == 'x' || entity[1] == 'X';
+                    unsigned long cp  = strtoul(entity.c_str() + 1 + hex,
+                                                NULL, hex ? 16 : 10);
+                    utf8(cp, dest);
+                }
+                else {
+                    dest += '&';
+                    continue;
+                }
+                begin = semi + 1;
+            }
+        }
+
+        static void utf8(unsigned long cp, string &dest)
+        {
+            if(cp < 0x80)
+                dest += (char)cp;
+            else if(cp < 0x800) {
+                dest += (char)(0xc0 | (cp >> 6));
+                dest += (char)(0x80 | (cp & 0x3f));
+            }
+            else if(cp < 0x10000) {
+                dest += (char)(0xe0 | (cp >> 12));
+                dest += (char)(0x80 | ((cp >> 6) & 0x3f));
+                dest += (char)(0x80 | (cp & 0x3f));
+            }
+            else {
+                dest += (char)(0xf0 | ((cp >> 18) & 0x07));
+                dest += (char)(0x80 | ((cp >> 12) & 0x3f));
+                dest += (char)(0x80 | ((cp >> 6) & 0x3f));
+                dest += (char)(0x80 | (cp & 0x3f));
+            }
+        }
+
+        XmlDocument &doc;
+        const char  *pos;
+};
+
+//@returns malloc()ed text of the tree
+static char *emit(const XmlElement *tree)
+{
+    XmlWriter writer;
+    writer.element(tree);
+    if(writer.col > 0)
+        writer.data += '\n';
+
+    char *xmldata = (char *)malloc(writer.data.size() + 1);
+    if(xmldata)
+        memcpy(xmldata, writer.data.c_str(), writer.data.size() + 1);
+    return xmldata;
+}
+
+//@returns the topmost element or NULL for malformed data
+static XmlElement *load(XmlDocument &doc, const char *data)
+{
+    return XmlParser(doc, data).parse();
+}
+#else
+/*
+ * XML text through mxml
+ *
+ * The element tree is copied into an mxml DOM for writing and loaded mxml
+ * DOMs are copied into an element tree, so everything apart from the text
+ * format is shared with the built-in parser.
+ */
+static const char *whitespace_callback(mxml_node_t *node, int where)
 {
     const char *name = mxmlGetElement(node);
 
@@ -42,66 +580,100 @@ const char *XMLwrapper_whitespace_callback(mxml_node_t *node, int where)
         return NULL;
 
     if((where == MXML_WS_BEFORE_OPEN) || (where == MXML_WS_BEFORE_CLOSE))
-        /*	const char *tmp=node->value.element.name;
-            if (tmp!=NULL) {
-                if ((strstr(tmp,"par")!=tmp)&&(strstr(tmp,"string")!=tmp)) {
-                printf("%s ",tmp);
-                if (where==MXML_WS_BEFORE_OPEN) xml_k++;
-                if (where==MXML_WS_BEFORE_CLOSE) xml_k--;
-                if (xml_k>=STACKSIZE) xml_k=STACKSIZE-1;
-                if (xml_k<0) xml_k=0;
-                printf("%d\n",xml_k);
-                printf("\n");
-                };
-
-            };
-            int i=0;
-            for (i=1;i<xml_k;i++) tabs[i]='\t';
-            tabs[0]='\n';tabs[i+1]='\0';
-            if (where==MXML_WS_BEFORE_OPEN) return(tabs);
-                else return("\n");
-        */
         return "\n";
-    ;
 
-    return 0;
+    return NULL;
 }
 
-//temporary const overload of mxmlFindElement
-const mxml_node_t *mxmlFindElement(const mxml_node_t *node,
-                                   const mxml_node_t *top,
-                                   const char *name,
-                                   const char *attr,
-                                   const char *value,
-                                   int descend)
+static mxml_node_t *tomxml(mxml_node_t *parent, const XmlElement *elm)
 {
-    return const_cast<const mxml_node_t *>(mxmlFindElement(
-                                               const_cast<mxml_node_t *>(node),
-                                               const_cast<mxml_node_t *>(top),
-                                               name, attr, value, descend));
+    mxml_node_t *res = mxmlNewElement(parent, elm->name.c_str());
+    for(auto &a:elm->attrs)
+        mxmlElementSetAttr(res, a.name.c_str(), a.value.c_str());
+    if(elm->hastext)
+        mxmlNewOpaque(res, elm->text.c_str());
+    for(const XmlElement *child:elm->children)
+        tomxml(res, child);
+    return res;
 }
 
-//temporary const overload of mxmlElementGetAttr
-const char *mxmlElementGetAttr(const mxml_node_t *node, const char *name)
+static XmlElement *frommxml(XmlDocument &doc, mxml_node_t *elm)
 {
-    return mxmlElementGetAttr(const_cast<mxml_node_t *>(node), name);
+    XmlElement *res = doc.create(mxmlGetElement(elm));
+#if MXML_MAJOR_VERSION == 3
+    const int count = mxmlElementGetAttrCount(elm);
+    for(int i = 0; i < count; ++i) {
+        const char *name;
+        const char *value = mxmlElementGetAttrByIndex(elm, i, &name);
+        res->attrs.push_back(XmlAttr{name, value ? value : ""});
+    }
+#else
+    for(int i = 0; i < elm->value.element.num_attrs; ++i) {
+        const char *value = elm->value.element.attrs[i].value;
+        res->attrs.push_back(XmlAttr{elm->value.element.attrs[i].name,
+                                     value ? value : ""});
+    }
+#endif
+
+    mxml_node_t *child = mxmlGetFirstChild(elm);
+    for(; child; child = mxmlGetNextSibling(child)) {
+        const char *text = NULL;
+        switch(mxmlGetType(child)) {
+            case MXML_ELEMENT:
+                res->append(frommxml(doc, child));
+                break;
+            case MXML_OPAQUE:
+                text = mxmlGetOpaque(child);
+                break;
+            case MXML_TEXT:
+                text = mxmlGetText(child, NULL);
+                break;
+            default:
+                break;
+        }
+        if(text)
+            res->text += text;
+    }
+    closetext(res);
+    return res;
+}
+
+static const char *trimLeadingWhite(const char *c)
+{
+    while(isspace(*c))
+        ++c;
+    return c;
 }
 
+//@returns malloc()ed text of the tree
+static char *emit(const XmlElement *tree)
+{
+    mxml_node_t *dom = tomxml(MXML_NO_PARENT, tree);
+    char *xmldata = mxmlSaveAllocString(dom, whitespace_callback);
+    mxmlDelete(dom);
+    return xmldata;
+}
+
+//@returns the topmost element or NULL for malformed data
+static XmlElement *load(XmlDocument &doc, const char *data)
+{
+    mxml_node_t *dom = mxmlLoadString(NULL, trimLeadingWhite(data),
+                                      MXML_OPAQUE_CALLBACK);
+    if(dom == NULL)
+        return NULL;
+    XmlElement *tree = frommxml(doc, dom);
+    mxmlDelete(dom);
+    return tree;
+}
+#endif
+
 XMLwrapper::XMLwrapper()
 {
     minimal = true;
     SaveFullXml=false;
 
-    node = tree = mxmlNewElement(MXML_NO_PARENT,
-                                 "?xml version=\"1.0f\" encoding=\"UTF-8\"?");
-    /*  for mxml 2.1f (and older)
-        tree=mxmlNewElement(MXML_NO_PARENT,"?xml");
-        mxmlElementSetAttr(tree,"version","1.0f");
-        mxmlElementSetAttr(tree,"encoding","UTF-8");
-    */
-
-    mxml_node_t *doctype = mxmlNewElement(tree, "!DOCTYPE");
-    mxmlElementSetAttr(doctype, "ZynAddSubFX-data", NULL);
+    doc  = new XmlDocument;
+    node = tree = createheader(*doc);
 
     node = root = addparams("ZynAddSubFX-data", 4,
                             "version-major", stringFrom<int>(
@@ -131,24 +703,25 @@ XMLwrapper::XMLwrapper()
 void
 XMLwrapper::cleanup(void)
 {
-    if(tree)
-        mxmlDelete(tree);
+    delete doc;
+    doc = new XmlDocument;
 
     /* make sure freed memory is not referenced */
     tree = 0;
     node = 0;
     root = 0;
+    info = 0;
 }
 
 XMLwrapper::~XMLwrapper()
 {
-    cleanup();
+    delete doc;
 }
 
 void XMLwrapper::setPadSynth(bool enabled)
 {
     /**@bug this might create multiple nodes when only one is needed*/
-    mxml_node_t *oldnode = node;
+    XmlElement *oldnode = node;
     node = info;
     //Info storing
     addparbool("PADsynth_used", enabled);
@@ -159,23 +732,14 @@ bool XMLwrapper::hasPadSynth() const
 {
     /**Right now this has a copied implementation of setparbool, so this should
      * be reworked as XMLwrapper evolves*/
-    mxml_node_t *tmp = mxmlFindElement(tree,
-                                       tree,
-                                       "INFORMATION",
-                                       NULL,
-                                       NULL,
-                                       MXML_DESCEND);
-
-    mxml_node_t *parameter = mxmlFindElement(tmp,
-                                             tmp,
-                                             "par_bool",
-                                             "name",
-                                             "PADsynth_used",
-                                             MXML_DESCEND_FIRST);
+    const XmlElement *tmp = findchild(root, "INFORMATION");
+
+    const XmlElement *parameter = findchild(tmp, "par_bool",
+                                            "name", "PADsynth_used");
     if(parameter == NULL) //no information available
         return false;
 
-    const char *strval = mxmlElementGetAttr(parameter, "value");
+    const char *strval = parameter->attr("value");
     if(strval == NULL) //no information available
         return false;
 
@@ -202,11 +766,10 @@ int XMLwrapper::saveXMLfile(const string &filename, int compression) const
 
 char *XMLwrapper::getXMLdata() const
 {
-    xml_k = 0;
-
-    char *xmldata = mxmlSaveAllocString(tree, XMLwrapper_whitespace_callback);
+    if(tree == NULL)
+        return NULL;
 
-    return xmldata;
+    return emit(tree);
 }
 
 
@@ -241,6 +804,203 @@ int XMLwrapper::dosavefile(const char *filename,
     return 0;
 }
 
+/*
+ * Binary format (version 1)
+ *
+ *   "ZYNB" <format version byte>
+ *   <string count> { <length> <bytes> }...
+ *   <ZynAddSubFX-data element>
+ *
+ * element: BINARY_ELEMENT <name> <attribute count> { <name> <value> }...
+ *          { <element> | <text> }... BINARY_END
+ * text:    BINARY_TEXT <value>
+ *
+ * Numbers are unsigned LEB128 varints, names and values are indices into
+ * the string table. Each distinct string is stored once, which keeps the
+ * uncompressed file small as most names and values repeat.
+ */
+#define BINARY_MAGIC     "ZYNB"
+#define BINARY_VERSION   1
+#define BINARY_MAXDEPTH  64
+
+enum {
+    BINARY_END     = 0,
+    BINARY_ELEMENT = 1,
+    BINARY_TEXT    = 2
+};
+
+class BinaryWriter
+{
+    public:
+        void element(const XmlElement *elm)
+        {
+            num(BINARY_ELEMENT);
+            str(elm->name);
+            num(elm->attrs.size());
+            for(auto &a:elm->attrs) {
+                str(a.name);
+                str(a.value);
+            }
+            if(elm->hastext) {
+                num(BINARY_TEXT);
+                str(elm->text);
+            }
+            for(const XmlElement *child:elm->children)
+                element(child);
+            num(BINARY_END);
+        }
+
+        string finish(void) const
+        {
+            string res = BINARY_MAGIC;
+            res += (char)BINARY_VERSION;
+            num(res, strings.size());
+            for(const string *s:strings) {
+                num(res, s->size());
+                res += *s;
+            }
+            return res + nodes;
+        }
+
+    private:
+        static void num(string &dest, uint32_t val)
+        {
+            for(; val >= 0x80; val >>= 7)
+                dest += (char)(0x80 | (val & 0x7f));
+            dest += (char)val;
+        }
+        void num(uint32_t val) { num(nodes, val); }
+
+        void str(const string &s)
+        {
+            auto res = ids.emplace(s, (uint32_t)strings.size());
+            if(res.second)
+                strings.push_back(&res.first->first);
+            num(res.first->second);
+        }
+
+        string nodes;
+        unordered_map<string, uint32_t> ids;
+        vector<const string *> strings; //in order of the ids
+};
+
+class BinaryReader
+{
+    public:
+        BinaryReader(const string &data)
+            :pos((const uint8_t *)data.data()),
+             end((const uint8_t *)data.data() + data.size())
+        {}
+
+        bool header(void)
+        {
+            uint32_t count;
+            if(end - pos < 5 || memcmp(pos, BINARY_MAGIC, 4)
+               || pos[4] != BINARY_VERSION)
+                return false;
+            pos += 5;
+            if(!num(count) || count > (uint32_t)(end - pos))
+                return false;
+            strings.reserve(count);
+            while(count--) {
+                uint32_t len;
+                if(!num(len) || len > (uint32_t)(end - pos))
+                    return false;
+                strings.emplace_back((const char *)pos, len);
+                pos += len;
+            }
+            return true;
+        }
+
+        //element (after its BINARY_ELEMENT tag) as child of parent
+        XmlElement *element(XmlDocument &doc, XmlElement *parent, int depth)
+        {
+            const char *name;
+            uint32_t    count;
+            if(depth > BINARY_MAXDEPTH || !str(name) || !num(count))
+                return NULL;
+            XmlElement *elm = doc.create(name);
+            parent->append(elm);
+            while(count--) {
+                const char *attr, *value;
+                if(!str(attr) || !str(value))
+                    return NULL;
+                elm->attrs.push_back(XmlAttr{attr, value});
+            }
+            while(true) {
+                uint32_t    tag;
+                const char *value;
+                if(!num(tag))
+                    return NULL;
+                if(tag == BINARY_END) {
+                    elm->hastext = !elm->text.empty();
+                    return elm;
+                }
+                else if(tag == BINARY_ELEMENT) {
+                    if(!element(doc, elm, depth + 1))
+                        return NULL;
+                }
+                else if(tag == BINARY_TEXT && str(value))
+                    elm->text += value;
+                else
+                    return NULL;
+            }
+        }
+
+        bool num(uint32_t &val)
+        {
+            val = 0;
+            for(int shift = 0; pos < end && shift < 32; shift += 7) {
+                const uint8_t byte = *pos++;
+                val |= (uint32_t)(byte & 0x7f) << shift;
+                if(!(byte & 0x80))
+                    return true;
+            }
+            return false;
+        }
+
+    private:
+        bool str(const char *&s)
+        {
+            uint32_t id;
+            if(!num(id) || id >= strings.size())
+                return false;
+            s = strings[id].c_str();
+            return true;
+        }
+
+        const uint8_t *pos;
+        const uint8_t *end;
+        vector<string> strings;
+};
+
+int XMLwrapper::saveBinaryfile(const string &filename) const
+{
+    if(root == NULL)
+        return -2;
+
+    BinaryWriter writer;
+    writer.element(root);
+    const string data = writer.finish();
+
+    FILE *file = fopen(filename.c_str(), "wb");
+    if(file == NULL)
+        return -1;
+    const bool ok = fwrite(data.data(), 1, data.size(), file) == data.size();
+    return (fclose(file) == 0 && ok) ? 0 : -1;
+}
+
+bool XMLwrapper::loadbinary(const string &data)
+{
+    BinaryReader reader(data);
+    uint32_t     tag;
+    if(!reader.header() || !reader.num(tag) || tag != BINARY_ELEMENT)
+        return false;
+
+    tree = createheader(*doc);
+    return reader.element(*doc, tree, 0) != NULL;
+}
+
 
 
 void XMLwrapper::addpar(const string &name, int val)
@@ -269,9 +1029,9 @@ void XMLwrapper::addparbool(const string &name, int val)
 
 void XMLwrapper::addparstr(const string &name, const string &val)
 {
-    mxml_node_t *element = mxmlNewElement(node, "string");
-    mxmlElementSetAttr(element, "name", name.c_str());
-    mxmlNewText(element, 0, val.c_str());
+    XmlElement *element = addparams("string", 1, "name", name.c_str());
+    element->text    = val;
+    element->hastext = true;
 }
 
 
@@ -292,19 +1052,10 @@ void XMLwrapper::beginbranch(const string &name, int id)
 void XMLwrapper::endbranch()
 {
     if(verbose)
-        cout << "endbranch()" << node << "-" << mxmlGetElement(node)
+        cout << "endbranch()" << node << "-" << node->name
              << " To "
-             << mxmlGetParent(node) << "-" << mxmlGetElement(mxmlGetParent(node)) << endl;
-    node = mxmlGetParent(node);
-}
-
-
-//workaround for memory leak
-const char *trimLeadingWhite(const char *c)
-{
-    while(isspace(*c))
-        ++c;
-    return c;
+             << node->parent << "-" << node->parent->name << endl;
+    node = node ? node->parent : NULL;
 }
 
 /* LOAD XML members */
@@ -313,33 +1064,20 @@ int XMLwrapper::loadXMLfile(const string &filename)
 {
     cleanup();
 
-    const char *xmldata = doloadfile(filename);
-    if(xmldata == NULL)
+    string data;
+    if(!doloadfile(filename, data))
         return -1;  //the file could not be loaded or uncompressed
 
-    root = tree = mxmlLoadString(NULL, trimLeadingWhite(
-                                     xmldata), MXML_OPAQUE_CALLBACK);
-
-    delete[] xmldata;
-
-    if(tree == NULL)
+    if(!data.compare(0, 4, BINARY_MAGIC)) {
+        if(!loadbinary(data))
+            return -2;  //this is not valid binary data
+    }
+    else if(!parse(data.c_str()))
         return -2;  //this is not XML
 
-    node = root = mxmlFindElement(tree,
-                                  tree,
-                                  "ZynAddSubFX-data",
-                                  NULL,
-                                  NULL,
-                                  MXML_DESCEND);
-    if(root == NULL)
+    if(!fetchroot())
         return -3;  //the XML doesn't embbed zynaddsubfx data
 
-    //fetch version information
-    _fileversion.set_major(stringTo<int>(mxmlElementGetAttr(root, "version-major")));
-    _fileversion.set_minor(stringTo<int>(mxmlElementGetAttr(root, "version-minor")));
-    _fileversion.set_revision(
-        stringTo<int>(mxmlElementGetAttr(root, "version-revision")));
-
     if(verbose)
         cout << "loadXMLfile() version: " << _fileversion << endl;
 
@@ -347,34 +1085,24 @@ int XMLwrapper::loadXMLfile(const string &filename)
 }
 
 
-char *XMLwrapper::doloadfile(const string &filename) const
+bool XMLwrapper::doloadfile(const string &filename, string &data) const
 {
-    char  *xmldata = NULL;
-    gzFile gzfile  = gzopen(filename.c_str(), "rb");
-
-    if(gzfile != NULL) { //The possibly compressed file opened
-        stringstream strBuf;             //reading stream
-        const int    bufSize = 500;      //fetch size
-        char fetchBuf[bufSize + 1];      //fetch buffer
-        int  read = 0;                   //chars read in last fetch
-
-        fetchBuf[bufSize] = 0; //force null termination
-
-        while(bufSize == (read = gzread(gzfile, fetchBuf, bufSize)))
-            strBuf << fetchBuf;
+    gzFile gzfile = gzopen(filename.c_str(), "rb");
+    if(gzfile == NULL)
+        return false;
 
-        fetchBuf[read] = 0; //Truncate last partial read
-        strBuf << fetchBuf;
+    //The possibly compressed file opened
+    const int bufSize = 64 * 1024; //fetch size
+    char *fetchBuf    = new char[bufSize];
+    int   read        = 0;         //chars read in last fetch
 
-        gzclose(gzfile);
+    data.clear();
+    while((read = gzread(gzfile, fetchBuf, bufSize)) > 0)
+        data.append(fetchBuf, read);
 
-        //Place data in output format
-        string tmp = strBuf.str();
-        xmldata = new char[tmp.size() + 1];
-        strncpy(xmldata, tmp.c_str(), tmp.size() + 1);
-    }
-
-    return xmldata;
+    delete[] fetchBuf;
+    gzclose(gzfile);
+    return read == 0;
 }
 
 bool XMLwrapper::putXMLdata(const char *xmldata)
@@ -384,25 +1112,34 @@ bool XMLwrapper::putXMLdata(const char *xmldata)
     if(xmldata == NULL)
         return false;
 
-    root = tree = mxmlLoadString(NULL, trimLeadingWhite(
-                                     xmldata), MXML_OPAQUE_CALLBACK);
-    if(tree == NULL)
+    if(!parse(xmldata))
         return false;
 
-    node = root = mxmlFindElement(tree,
-                                  tree,
-                                  "ZynAddSubFX-data",
-                                  NULL,
-                                  NULL,
-                                  MXML_DESCEND);
+    return fetchroot();
+}
+
+bool XMLwrapper::parse(const char *data)
+{
+    tree = load(*doc, data);
+    return tree != NULL;
+}
+
+bool XMLwrapper::fetchroot(void)
+{
+    //the data is either the tree itself or follows the document header
+    root = tree;
+    if(root->name != "ZynAddSubFX-data")
+        root = findchild(tree, "ZynAddSubFX-data");
+    node = root;
     if(root == NULL)
         return false;
+    info = findchild(root, "INFORMATION");
 
     //fetch version information
-    _fileversion.set_major(stringTo<int>(mxmlElementGetAttr(root, "version-major")));
-    _fileversion.set_minor(stringTo<int>(mxmlElementGetAttr(root, "version-minor")));
+    _fileversion.set_major(stringTo<int>(root->attr("version-major")));
+    _fileversion.set_minor(stringTo<int>(root->attr("version-minor")));
     _fileversion.set_revision(
-        stringTo<int>(mxmlElementGetAttr(root, "version-revision")));
+        stringTo<int>(root->attr("version-revision")));
 
     return true;
 }
@@ -413,9 +1150,7 @@ int XMLwrapper::enterbranch(const string &name)
 {
     if(verbose)
         cout << "enterbranch() " << name << endl;
-    mxml_node_t *tmp = mxmlFindElement(node, node,
-                                       name.c_str(), NULL, NULL,
-                                       MXML_DESCEND_FIRST);
+    XmlElement *tmp = findchild(node, name.c_str());
     if(tmp == NULL)
         return 0;
 
@@ -427,9 +1162,8 @@ int XMLwrapper::enterbranch(const string &name, int id)
 {
     if(verbose)
         cout << "enterbranch(" << id << ") " << name << endl;
-    mxml_node_t *tmp = mxmlFindElement(node, node,
-                                       name.c_str(), "id", stringFrom<int>(
-                                           id).c_str(), MXML_DESCEND_FIRST);
+    XmlElement *tmp = findchild(node, name.c_str(),
+                                "id", stringFrom<int>(id).c_str());
     if(tmp == NULL)
         return 0;
 
@@ -441,16 +1175,16 @@ int XMLwrapper::enterbranch(const string &name, int id)
 void XMLwrapper::exitbranch()
 {
     if(verbose)
-        cout << "exitbranch()" << node << "-" << mxmlGetElement(node)
+        cout << "exitbranch()" << node << "-" << node->name
              << " To "
-             << mxmlGetParent(node) << "-" << mxmlGetElement(mxmlGetParent(node)) << endl;
-    node = mxmlGetParent(node);
+             << node->parent << "-" << node->parent->name << endl;
+    node = node ? node->parent : NULL;
 }
 
 
 int XMLwrapper::getbranchid(int min, int max) const
 {
-    int id = stringTo<int>(mxmlElementGetAttr(node, "id"));
+    int id = stringTo<int>(node ? node->attr("id") : NULL);
     if((min == 0) && (max == 0))
         return id;
 
@@ -466,17 +1200,12 @@ int XMLwrapper::getbranchid(int min, int max) const
 int XMLwrapper::getpar(const string &name, int defaultpar, int min,
                        int max) const
 {
-    const mxml_node_t *tmp = mxmlFindElement(node,
-                                             node,
-                                             "par",
-                                             "name",
-                                             name.c_str(),
-                                             MXML_DESCEND_FIRST);
+    const XmlElement *tmp = findchild(node, "par", "name", name.c_str());
 
     if(tmp == NULL)
         return defaultpar;
 
-    const char *strval = mxmlElementGetAttr(tmp, "value");
+    const char *strval = tmp->attr("value");
     if(strval == NULL)
         return defaultpar;
 
@@ -497,17 +1226,12 @@ int XMLwrapper::getpar127(const string &name, int defaultpar) const
 
 int XMLwrapper::getparbool(const string &name, int defaultpar) const
 {
-    const mxml_node_t *tmp = mxmlFindElement(node,
-                                             node,
-                                             "par_bool",
-                                             "name",
-                                             name.c_str(),
-                                             MXML_DESCEND_FIRST);
+    const XmlElement *tmp = findchild(node, "par_bool", "name", name.c_str());
 
     if(tmp == NULL)
         return defaultpar;
 
-    const char *strval = mxmlElementGetAttr(tmp, "value");
+    const char *strval = tmp->attr("value");
     if(strval == NULL)
         return defaultpar;
 
@@ -520,82 +1244,44 @@ int XMLwrapper::getparbool(const string &name, int defaultpar) const
 void XMLwrapper::getparstr(const string &name, char *par, int maxstrlen) const
 {
     ZERO(par, maxstrlen);
-    mxml_node_t *tmp = mxmlFindElement(node,
-                                       node,
-                                       "string",
-                                       "name",
-                                        name.c_str(),
-                                        MXML_DESCEND_FIRST);
+    const XmlElement *tmp = findchild(node, "string", "name", name.c_str());
 
-    if(tmp == NULL)
-        return;
-    if(mxmlGetFirstChild(tmp) == NULL)
-        return;
-    if(mxmlGetType(mxmlGetFirstChild(tmp)) == MXML_OPAQUE) {
-        snprintf(par, maxstrlen, "%s", mxmlGetOpaque(mxmlGetFirstChild(tmp)));
+    if((tmp == NULL) || !tmp->hastext)
         return;
-    }
-    if((mxmlGetType(mxmlGetFirstChild(tmp)) == MXML_TEXT)
-       && (mxmlGetFirstChild(tmp) != NULL)) {
-        snprintf(par, maxstrlen, "%s", mxmlGetText(mxmlGetFirstChild(tmp),NULL));
-        return;
-    }
+    snprintf(par, maxstrlen, "%s", tmp->text.c_str());
 }
 
 string XMLwrapper::getparstr(const string &name,
                              const std::string &defaultpar) const
 {
-    mxml_node_t *tmp = mxmlFindElement(node,
-                                       node,
-                                       "string",
-                                       "name",
-                                       name.c_str(),
-                                       MXML_DESCEND_FIRST);
+    const XmlElement *tmp = findchild(node, "string", "name", name.c_str());
 
-    if((tmp == NULL) || (mxmlGetFirstChild(tmp) == NULL))
+    if((tmp == NULL) || !tmp->hastext)
         return defaultpar;
 
-    if(mxmlGetType(mxmlGetFirstChild(tmp)) == MXML_OPAQUE
-       && (mxmlGetOpaque(mxmlGetFirstChild(tmp)) != NULL))
-        return mxmlGetOpaque(mxmlGetFirstChild(tmp));
-
-    if(mxmlGetType(mxmlGetFirstChild(tmp)) == MXML_TEXT
-       && (mxmlGetText(mxmlGetFirstChild(tmp),NULL) != NULL))
-        return mxmlGetText(mxmlGetFirstChild(tmp),NULL);
-
-    return defaultpar;
+    return tmp->text;
 }
 
 bool XMLwrapper::hasparreal(const char *name) const
 {
-    const mxml_node_t *tmp = mxmlFindElement(node,
-                                             node,
-                                             "par_real",
-                                             "name",
-                                             name,
-                                             MXML_DESCEND_FIRST);
+    const XmlElement *tmp = findchild(node, "par_real", "name", name);
     return tmp != nullptr;
 }
 
 float XMLwrapper::getparreal(const char *name, float defaultpar) const
 {
-    const mxml_node_t *tmp = mxmlFindElement(node,
-                                             node,
-                                             "par_real",
-                                             "name",
-                                             name,
-                                             MXML_DESCEND_FIRST);
+    const XmlElement *tmp = findchild(node, "par_real", "name", name);
     if(tmp == NULL)
         return defaultpar;
 
-    const char *strval = mxmlElementGetAttr(tmp, "exact_value");
+    const char *strval = tmp->attr("exact_value");
     if (strval != NULL) {
         union { float out; uint32_t in; } convert;
         sscanf(strval+2, "%x", &convert.in);
         return convert.out;
     }
 
-    strval = mxmlElementGetAttr(tmp, "value");
+    strval = tmp->attr("value");
     if(strval == NULL)
         return defaultpar;
 
@@ -620,12 +1306,12 @@ float XMLwrapper::getparreal(const char *name,
 
 /** Private members **/
 
-mxml_node_t *XMLwrapper::addparams(const char *name, unsigned int params,
-                                   ...) const
+XmlElement *XMLwrapper::addparams(const char *name, unsigned int params,
+                                  ...) const
 {
     /**@todo make this function send out a good error message if something goes
      * wrong**/
-    mxml_node_t *element = mxmlNewElement(node, name);
+    XmlElement *element = doc->create(name);
 
     if(params) {
         va_list variableList;
@@ -639,10 +1325,12 @@ mxml_node_t *XMLwrapper::addparams(const char *name, unsigned int params,
             if(verbose)
                 cout << "addparams()[" << params << "]=" << name << " "
                      << ParamName << "=\"" << ParamValue << "\"" << endl;
-            mxmlElementSetAttr(element, ParamName, ParamValue);
+            element->attrs.push_back(XmlAttr{ParamName, ParamValue});
         }
         va_end(variableList);
     }
+    if(node)
+        node->append(element);
     return element;
 }
 
@@ -673,39 +1361,21 @@ bool XmlNode::has(std::string name_)
 
 void XMLwrapper::add(const XmlNode &node_)
 {
-    mxml_node_t *element = mxmlNewElement(node, node_.name.c_str());
-    for(auto attr:node_.attrs)
-        mxmlElementSetAttr(element, attr.name.c_str(),
-                attr.value.c_str());
+    XmlElement *element = doc->create(node_.name);
+    element->attrs = node_.attrs;
+    if(node)
+        node->append(element);
 }
 
 std::vector<XmlNode> XMLwrapper::getBranch(void) const
 {
     std::vector<XmlNode> res;
-    mxml_node_t *current = mxmlGetFirstChild(node);
-    while(current) {
-        if(mxmlGetType(current) == MXML_ELEMENT) {
-#if MXML_MAJOR_VERSION == 3
-            XmlNode n(mxmlGetElement(current));
-            int count = mxmlElementGetAttrCount(current);
-            const char *name;
-            const char *attrib;
-            for(int i = 0; i < count; ++i) {
-                attrib = mxmlElementGetAttrByIndex(current, i, &name);
-                if(name)
-                    n[name] = attrib;
-            }
-#else
-            auto elm = current->value.element;
-            XmlNode n(elm.name);
-            for(int i = 0; i < elm.num_attrs; ++i) {
-                auto &attr = elm.attrs[i];
-                n[attr.name] = attr.value;
-            }
-#endif
-            res.push_back(n);
-        }
-        current = mxmlWalkNext(current, node, MXML_NO_DESCEND);
+    if(node == NULL)
+        return res;
+    for(const XmlElement *current:node->children) {
+        XmlNode n(current->name);
+        n.attrs = current->attrs;
+        res.push_back(n);
     }
     return res;
 }
@@ -13,7 +13,6 @@
   of the License, or (at your option) any later version.
 */
 
-#include <mxml.h>
 #include <string>
 #include <vector>
 #include "zyn-version.h"
@@ -21,12 +20,11 @@
 #ifndef XML_WRAPPER_H
 #define XML_WRAPPER_H
 
-#ifndef MXML_MAJOR_VERSION
-#define MXML_MAJOR_VERSION 1
-#endif
-
 namespace zyn {
 
+class XmlElement;
+class XmlDocument;
+
 class XmlAttr
 {
     public:
@@ -46,7 +44,18 @@ class XmlNode
         bool has(std::string);
 };
 
-/**Mxml wrapper*/
+/**
+ * Reads and writes the XML files of ZynAddSubFX.
+ *
+ * Documents are kept in an own element tree. Loading parses the text in one
+ * pass straight into that tree, and each element indexes its children by
+ * name and by their "name" and "id" attributes on the first lookup, so
+ * getpar() and enterbranch() do not depend on the number of siblings.
+ *
+ * With USE_MXML (cmake -DMxmlEnable=ON), the text is read and written by
+ * mxml instead of the built-in parser, the tree and the binary format are
+ * the same in both builds.
+ */
 class XMLwrapper
 {
     public:
@@ -59,6 +68,9 @@ class XMLwrapper
         /**Destructor*/
         ~XMLwrapper();
 
+        XMLwrapper(const XMLwrapper&) = delete;
+        XMLwrapper& operator=(const XMLwrapper&) = delete;
+
         /**
          * Saves the XML to a file.
          * @param filename the name of the destination file.
@@ -66,6 +78,15 @@ class XMLwrapper
          */
         int saveXMLfile(const std::string &filename, int compression) const;
 
+        /**
+         * Saves the tree to a file in the binary format.
+         * The file holds the same tree as the XML file, but is read by
+         * loadXMLfile() without text parsing or decompression.
+         * @param filename the name of the destination file.
+         * @returns 0 if ok or -1 if the file cannot be saved.
+         */
+        int saveBinaryfile(const std::string &filename) const;
+
         /**
          * Return XML tree as a string.
          * Note: The string must be freed with free() to deallocate
@@ -125,6 +146,8 @@ class XMLwrapper
 
         /**
          * Loads file into XMLwrapper.
+         * Accepts XML (gzip compressed or not) and the binary format
+         * written by saveBinaryfile().
          * @param filename file to be loaded
          * @returns 0 if ok or -1 if the file cannot be loaded
          */
@@ -261,27 +284,47 @@ class XMLwrapper
                        int compression,
                        const char *xmldata) const;
 
+        /**
+         * Parse XML text into a new tree.
+         * @return false if the data is not well formed
+         */
+        bool parse(const char *data);
+
         /**
          * Loads specified file and returns data.
          *
          * Will load a gzipped file or an uncompressed file.
          * @param filename the file
-         * @return The decompressed data
+         * @param data The decompressed data
+         * @return false if the file could not be read
+         */
+        bool doloadfile(const std::string &filename, std::string &data) const;
+
+        /**
+         * Build the tree from data in the binary format.
+         * @return false if the data is not valid
+         */
+        bool loadbinary(const std::string &data);
+
+        /**
+         * Find the root node of a loaded tree and fetch the file version.
+         * @return false if there is no ZynAddSubFX-data node
          */
-        char *doloadfile(const std::string &filename) const;
+        bool fetchroot(void);
 
         /**
          * Cleanup XML tree before loading new one.
          */
         void cleanup(void);
 
-        mxml_node_t *tree; /**<all xml data*/
-        mxml_node_t *root; /**<xml data used by zynaddsubfx*/
-        mxml_node_t *node; /**<current subtree in parsing or writing */
-        mxml_node_t *info; /**<Node used to store the information about the data*/
+        XmlDocument *doc;  /**<storage of all elements*/
+        XmlElement  *tree; /**<all xml data*/
+        XmlElement  *root; /**<xml data used by zynaddsubfx*/
+        XmlElement  *node; /**<current subtree in parsing or writing */
+        XmlElement  *info; /**<Node used to store the information about the data*/
 
         /**
-         * Create mxml_node_t with specified name and parameters
+         * Create an element with specified name and parameters
          *
          * Results should look like:
          * <name optionalParam1="value1" optionalParam2="value2" ...>
@@ -291,8 +334,8 @@ class XMLwrapper
          * @param ... const char * pairs that are in the format attribute_name,
          * attribute_value
          */
-        mxml_node_t *addparams(const char *name, unsigned int params,
-                               ...) const;
+        XmlElement *addparams(const char *name, unsigned int params,
+                              ...) const;
 public:
         version_type _fileversion;
 };
@@ -13,12 +13,14 @@
 
 #include <stdlib.h>
 #include <iostream>
+#include <algorithm>
 #include <cmath>
 #include <poll.h>
 
 #include "../Misc/Util.h"
 #include "../Misc/Config.h"
 #include "InMgr.h"
+#include "OutMgr.h"
 #include "AlsaEngine.h"
 #include "Compressor.h"
 #include "Nio.h"
@@ -32,7 +34,8 @@ namespace zyn {
 AlsaEngine::AlsaEngine(const SYNTH_T &synth)
     :AudioOut(synth)
 {
-    audio.buffer = new short[synth.buffersize * 2];
+    audio.buffer = NULL;
+    audio.access = ACCESS_RW;
     name = "ALSA";
     audio.handle = NULL;
     audio.peaks[0] = 0;
@@ -286,25 +289,69 @@ void AlsaEngine::stopMidi()
         snd_seq_close(handle);
 }
 
-short *AlsaEngine::interleave(const Stereo<float *> &smps)
+void AlsaEngine::interleave(const Stereo<float *> &smps, short *out, int frames)
 {
-    /**\todo TODO fix repeated allocation*/
-    short *shortInterleaved = audio.buffer;
-    memset(shortInterleaved, 0, bufferSize * 2 * sizeof(short));
     int    idx = 0; //possible off by one error here
     double scaled;
-    for(int frame = 0; frame < bufferSize; ++frame) { // with a nod to libsamplerate ...
+    for(int frame = 0; frame < frames; ++frame) { // with a nod to libsamplerate ...
         float l = smps.l[frame];
         float r = smps.r[frame];
         if(isOutputCompressionEnabled)
             stereoCompressor(synth.samplerate, audio.peaks[0], l, r);
 
         scaled = l * (8.0f * 0x10000000);
-        shortInterleaved[idx++] = (short int)(lrint(scaled) >> 16);
+        out[idx++] = (short int)(lrint(scaled) >> 16);
         scaled = r * (8.0f * 0x10000000);
-        shortInterleaved[idx++] = (short int)(lrint(scaled) >> 16);
+        out[idx++] = (short int)(lrint(scaled) >> 16);
     }
-    return shortInterleaved;
+}
+
+//address of a channel at a frame of the mmapped ring
+static inline char *areaAddr(const snd_pcm_channel_area_t &area,
+                             snd_pcm_uframes_t offset)
+{
+    return (char *)area.addr + (area.first + offset * area.step) / 8;
+}
+
+//Convert frames of smps, starting at from, into the device ring at offset
+void AlsaEngine::storeMmap(const snd_pcm_channel_area_t *areas,
+                           snd_pcm_uframes_t offset,
+                           const Stereo<float *> &smps, int from, int frames)
+{
+    char *dl = areaAddr(areas[0], offset), *dr = areaAddr(areas[1], offset);
+    const int stepl = areas[0].step / 8, stepr = areas[1].step / 8;
+    for(int frame = from; frame < from + frames; ++frame) {
+        float l = smps.l[frame];
+        float r = smps.r[frame];
+        if(isOutputCompressionEnabled)
+            stereoCompressor(synth.samplerate, audio.peaks[0], l, r);
+
+        if(audio.access == ACCESS_MMAP_FLOAT) {
+            *(float *)dl = l;
+            *(float *)dr = r;
+        } else {
+            *(short *)dl = (short int)(lrint(l * (8.0f * 0x10000000)) >> 16);
+            *(short *)dr = (short int)(lrint(r * (8.0f * 0x10000000)) >> 16);
+        }
+        dl += stepl;
+        dr += stepr;
+    }
+}
+
+/*
+ * Configuration through the environment:
+ *  ALSA_DEVICE   the pcm device, hw:0 by default
+ *  ALSA_PERIOD   frames per period, the synth buffer size by default (a
+ *                multiple of it adds no latency, see OutMgr::getLatency()),
+ *                at most OUTMGR_MAX_PERIOD
+ *  ALSA_PERIODS  periods in the ring of the device, 2 by default
+ *  ALSA_MMAP     0 to write with snd_pcm_writei() instead of mmapping the
+ *                ring of the device
+ */
+static int envInt(const char *name, int def)
+{
+    const char *val = getenv(name);
+    return (val && atoi(val) > 0) ? atoi(val) : def;
 }
 
 bool AlsaEngine::openAudio()
@@ -330,60 +377,88 @@ bool AlsaEngine::openAudio()
     }
 
     /* Allocate a hardware parameters object. */
+    snd_pcm_hw_params_t *any;
+    snd_pcm_hw_params_alloca(&any);
     snd_pcm_hw_params_alloca(&audio.params);
 
     /* Fill it in with default values. */
-    snd_pcm_hw_params_any(audio.handle, audio.params);
+    snd_pcm_hw_params_any(audio.handle, any);
 
     /* Set the desired hardware parameters. */
 
-    /* Interleaved mode */
-    snd_pcm_hw_params_set_access(audio.handle, audio.params,
-                                 SND_PCM_ACCESS_RW_INTERLEAVED);
-
-    /* Signed 16-bit little-endian format */
-    snd_pcm_hw_params_set_format(audio.handle, audio.params,
-                                 SND_PCM_FORMAT_S16_LE);
-
-    /* Two channels (stereo) */
-    snd_pcm_hw_params_set_channels(audio.handle, audio.params, 2);
+    /* The first access mode and format the device supports, in stereo */
+    const char *mmap = getenv("ALSA_MMAP");
+    static const struct {
+        access_t           access;
+        snd_pcm_access_t   alsa;
+        snd_pcm_format_t   format;
+    } modes[] = {
+        {ACCESS_MMAP_FLOAT, SND_PCM_ACCESS_MMAP_NONINTERLEAVED, SND_PCM_FORMAT_FLOAT},
+        {ACCESS_MMAP_S16,   SND_PCM_ACCESS_MMAP_INTERLEAVED,    SND_PCM_FORMAT_S16_LE},
+        {ACCESS_RW,         SND_PCM_ACCESS_RW_INTERLEAVED,      SND_PCM_FORMAT_S16_LE},
+    };
+    for(auto mode:modes) {
+        if(mode.access != ACCESS_RW && mmap && !atoi(mmap))
+            continue;
+        snd_pcm_hw_params_copy(audio.params, any);
+        audio.access = mode.access;
+        if(snd_pcm_hw_params_set_access(audio.handle, audio.params, mode.alsa) >= 0
+           && snd_pcm_hw_params_set_format(audio.handle, audio.params, mode.format) >= 0
+           && snd_pcm_hw_params_set_channels(audio.handle, audio.params, 2) >= 0)
+            break;
+    }
 
     audio.sampleRate = synth.samplerate;
     snd_pcm_hw_params_set_rate_near(audio.handle, audio.params,
                                     &audio.sampleRate, NULL);
 
-    audio.frames = 512;
+    //OutMgr::tick() serves periods up to OUTMGR_MAX_PERIOD
+    snd_pcm_uframes_t maxframes = OUTMGR_MAX_PERIOD;
+    snd_pcm_hw_params_set_period_size_max(audio.handle, audio.params,
+                                          &maxframes, NULL);
+    audio.frames = std::min(envInt("ALSA_PERIOD", synth.buffersize),
+                            OUTMGR_MAX_PERIOD);
     snd_pcm_hw_params_set_period_size_near(audio.handle,
                                            audio.params, &audio.frames, NULL);
 
-    audio.periods = 4;
+    /* The resulting latency is given by                 */
+    /* latency = periodsize * periods / rate             */
+    audio.periods = envInt("ALSA_PERIODS", 2);
     snd_pcm_hw_params_set_periods_near(audio.handle,
                                        audio.params, &audio.periods, NULL);
 
-    /* Set buffer size (in frames). The resulting latency is given by */
-    /* latency = periodsize * periods / (rate * bytes_per_frame)      */
-    snd_pcm_uframes_t alsa_buffersize = synth.buffersize;
-    rc = snd_pcm_hw_params_set_buffer_size_near(audio.handle,
-                                               audio.params,
-                                               &alsa_buffersize);
-
-    /* At this place, ALSA's and zyn's buffer sizes may differ. */
-    /* This should not be a problem.                            */
-    if((int)alsa_buffersize != synth.buffersize)
-     cerr << "ALSA buffer size: " << alsa_buffersize << endl;
-
     /* Write the parameters to the driver */
     rc = snd_pcm_hw_params(audio.handle, audio.params);
     if(rc < 0) {
         fprintf(stderr,
                 "unable to set hw parameters: %s\n",
                 snd_strerror(rc));
+        snd_pcm_close(audio.handle);
+        audio.handle = NULL;
         return false;
     }
 
-    //snd_pcm_hw_params_get_period_size(audio.params, &audio.frames, NULL);
-    //snd_pcm_hw_params_get_period_time(audio.params, &val, NULL);
+    /* At this place, ALSA's and zyn's buffer sizes may differ. */
+    /* This should not be a problem.                            */
+    snd_pcm_hw_params_get_period_size(audio.params, &audio.frames, NULL);
+    snd_pcm_hw_params_get_periods(audio.params, &audio.periods, NULL);
+    if(audio.frames > OUTMGR_MAX_PERIOD) {
+        fprintf(stderr,
+                "ALSA period size %lu is above the maximum of %d\n",
+                (unsigned long)audio.frames, OUTMGR_MAX_PERIOD);
+        snd_pcm_close(audio.handle);
+        audio.handle = NULL;
+        return false;
+    }
+    if((int)audio.frames != synth.buffersize)
+        cerr << "ALSA period size: " << audio.frames << endl;
+    cerr << "ALSA latency: " << audio.frames * audio.periods * 1000.0f
+                                / audio.sampleRate << " ms"
+         << (audio.access == ACCESS_RW ? "" : " (mmap)") << endl;
+    setBufferSize(audio.frames);
 
+    delete[] audio.buffer;
+    audio.buffer = new short[audio.frames * 2];
 
     pthread_attr_t attr;
     pthread_attr_init(&attr);
@@ -406,26 +481,99 @@ void AlsaEngine::stopAudio()
              << endl;
 }
 
+//Count underruns and get the device going again
+void AlsaEngine::recover(snd_pcm_t *handle, int err)
+{
+    if(err == -EPIPE || err == -ESTRPIPE)
+        xrun(); //reported by Nio::idle()
+    err = snd_pcm_recover(handle, err, 1);
+    if(err < 0)
+        throw "Could not recover ALSA connection";
+}
+
 void *AlsaEngine::processAudio()
 {
+    if(audio.access != ACCESS_RW)
+        return processAudioMmap();
+
     while(audio.handle) {
-        audio.buffer = interleave(getNext());
+        interleave(getNext(), audio.buffer, bufferSize);
         snd_pcm_t *handle = audio.handle;
-        int rc = snd_pcm_writei(handle, audio.buffer, synth.buffersize);
-        if(rc == -EPIPE) {
-            /* EPIPE means underrun */
-            cerr << "underrun occurred" << endl;
-            snd_pcm_prepare(handle);
+        int rc = snd_pcm_writei(handle, audio.buffer, bufferSize);
+        if(rc < 0)
+            recover(handle, rc);
+    }
+    return NULL;
+}
+
+/*
+ * Fill the ring of the device a period at a time, once it is full (at the
+ * start and after an xrun) start playing it.
+ */
+void *AlsaEngine::processAudioMmap()
+{
+    while(audio.handle) {
+        snd_pcm_t *handle = audio.handle;
+        const snd_pcm_sframes_t avail = snd_pcm_avail_update(handle);
+        if(avail < 0) {
+            recover(handle, avail);
+            continue;
         }
-        else
-        if(rc < 0) {
-            cerr << "AlsaEngine: Recovering connection..." << endl;
-            rc = snd_pcm_recover(handle, rc, 0);
+
+        if(avail < bufferSize) {
+            int rc;
+            if(snd_pcm_state(handle) == SND_PCM_STATE_PREPARED)
+                rc = snd_pcm_start(handle);
+            else
+                rc = snd_pcm_wait(handle, 1000);
             if(rc < 0)
-             throw "Could not recover ALSA connection";
+                recover(handle, rc);
+            continue;
         }
+
+        writePeriodMmap(handle);
     }
     return NULL;
 }
 
+void AlsaEngine::writePeriodMmap(snd_pcm_t *handle)
+{
+    Stereo<float *> smps(NULL, NULL);
+    int done = 0;
+    while(done < bufferSize) {
+        const snd_pcm_channel_area_t *areas;
+        snd_pcm_uframes_t offset, frames = bufferSize - done;
+        int rc = snd_pcm_mmap_begin(handle, &areas, &offset, &frames);
+        if(rc < 0) {
+            recover(handle, rc);
+            return;
+        }
+
+        float *l = (float *)areaAddr(areas[0], offset),
+              *r = (float *)areaAddr(areas[1], offset);
+        if(!done && (int)frames == bufferSize
+           && audio.access == ACCESS_MMAP_FLOAT
+           && areas[0].step == 32 && areas[1].step == 32
+           && renderDirect(l, r)) {
+            //the whole period was rendered into the ring
+            if(isOutputCompressionEnabled)
+                for(int frame = 0; frame < bufferSize; ++frame)
+                    stereoCompressor(synth.samplerate, audio.peaks[0],
+                                     l[frame], r[frame]);
+        } else {
+            if(!smps.l)
+                smps = getNext();
+            storeMmap(areas, offset, smps, done, frames);
+        }
+
+        const snd_pcm_sframes_t committed =
+            snd_pcm_mmap_commit(handle, offset, frames);
+        if(committed < 0 || (snd_pcm_uframes_t)committed != frames) {
+            recover(handle, committed < 0 ? committed : -EPIPE);
+            return;
+        }
+        done += frames;
+    }
+}
+
 }
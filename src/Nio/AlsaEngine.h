@@ -52,7 +52,11 @@ class AlsaEngine:public AudioOut, MidiIn
         bool openAudio();
         void stopAudio();
 
-        short *interleave(const Stereo<float *> &smps);
+        void interleave(const Stereo<float *> &smps, short *out, int frames);
+        void storeMmap(const snd_pcm_channel_area_t *areas,
+                       snd_pcm_uframes_t offset, const Stereo<float *> &smps,
+                       int from, int frames);
+        void recover(snd_pcm_t *handle, int err);
 
         struct {
             std::string device;
@@ -62,18 +66,28 @@ class AlsaEngine:public AudioOut, MidiIn
             pthread_t pThread;
         } midi;
 
+        //how the samples get into the ring of the device
+        enum access_t {
+            ACCESS_MMAP_FLOAT, //float per channel, rendered in place
+            ACCESS_MMAP_S16,   //interleaved 16 bit, converted in place
+            ACCESS_RW          //interleaved 16 bit, written from a buffer
+        };
+
         struct {
             snd_pcm_t *handle;
             snd_pcm_hw_params_t *params;
             unsigned int      sampleRate;
             snd_pcm_uframes_t frames;
             unsigned int      periods;
+            access_t  access;
             short    *buffer;
             pthread_t pThread;
             float peaks[1];
         } audio;
 
         void *processAudio();
+        void *processAudioMmap();
+        void writePeriodMmap(snd_pcm_t *handle);
 };
 
 }
@@ -24,7 +24,8 @@ using namespace std;
 namespace zyn {
 
 AudioOut::AudioOut(const SYNTH_T &synth_)
-    :synth(synth_), samplerate(synth.samplerate), bufferSize(synth.buffersize)
+    :synth(synth_), samplerate(synth.samplerate), bufferSize(synth.buffersize),
+      xruns(0)
 {}
 
 AudioOut::~AudioOut()
@@ -50,4 +51,10 @@ const Stereo<float *> AudioOut::getNext()
     return OutMgr::getInstance().tick(bufferSize);
 }
 
+bool AudioOut::renderDirect(float *l, float *r,
+                            float *const *partl, float *const *partr)
+{
+    return OutMgr::getInstance().tickDirect(bufferSize, l, r, partl, partr);
+}
+
 }
@@ -14,6 +14,7 @@
 #ifndef AUDIO_OUT_H
 #define AUDIO_OUT_H
 
+#include <atomic>
 #include "../Misc/Stereo.h"
 #include "../globals.h"
 #include "Engine.h"
@@ -44,14 +45,31 @@ class AudioOut:public virtual Engine
         
         bool isOutputCompressionEnabled = 0;
 
+        /**Under- and overruns of the device since the driver was created*/
+        unsigned getXruns() const {return xruns.load(std::memory_order_relaxed);}
+
     protected:
+        /**Count an xrun, from any thread of the driver
+         * (reported by Nio::idle())*/
+        void xrun() {xruns.fetch_add(1, std::memory_order_relaxed);}
+
         /**Get the next sample for output.
          * (has nsamples sampled at a rate of samplerate)*/
         const Stereo<float *> getNext();
 
+        /**Render the next bufferSize samples straight into l and r (and the
+         * outputs per part, if given), see OutMgr::tickDirect().
+         * @return false if getNext() has to be used instead*/
+        bool renderDirect(float *l, float *r,
+                          float *const *partl = NULL,
+                          float *const *partr = NULL);
+
         const SYNTH_T &synth;
         int samplerate;
         int bufferSize;
+
+    private:
+        std::atomic<unsigned> xruns;
         
 };
 
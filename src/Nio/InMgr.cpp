@@ -16,6 +16,7 @@
 #include "../Misc/Part.h"
 #include "../Misc/MiddleWare.h"
 #include <rtosc/thread-link.h>
+#include <cstring>
 #include <iostream>
 using namespace std;
 
@@ -72,10 +73,9 @@ InMgr &InMgr::getInstance()
 }
 
 InMgr::InMgr()
-    :queue(256), master(NULL)
+    :queue(256, 16384), npending(0), reported(0), master(NULL)
 {
     current = NULL;
-    work.init(PTHREAD_PROCESS_PRIVATE, 0);
 }
 
 InMgr::~InMgr()
@@ -85,26 +85,41 @@ InMgr::~InMgr()
 
 void InMgr::putEvent(MidiEvent ev)
 {
-    if(queue.push(ev)) //check for error
-        cerr << "ERROR: MIDI ringbuffer is FULL" << endl;
-    else
-        work.post();
+    //a full queue drops the event, it is reported by idle()
+    queue.push(ev);
 }
 
 void InMgr::flush(unsigned frameStart, unsigned frameStop)
 {
-    MidiEvent ev;
-    while(!work.trywait()) {
-        queue.peak(ev);
-        if(ev.time < (int)frameStart || ev.time > (int)frameStop) {
-            //Back out of transaction
-            work.post();
+    //take the next batch and merge it into the events which are still
+    //pending, keeping events of the same time in the order they came
+    const unsigned sorted = npending;
+    npending += queue.read(pending + npending, MIDI_BATCH - npending);
+    for(unsigned i = sorted; i < npending; ++i) {
+        const MidiEvent ev = pending[i];
+        unsigned j = i;
+        for(; j > 0 && pending[j - 1].time > ev.time; --j)
+            pending[j] = pending[j - 1];
+        pending[j] = ev;
+    }
+
+    unsigned done = 0;
+    for(; done < npending; ++done) {
+        const MidiEvent &ev = pending[done];
+        if(ev.time >= (int)frameStop) {
             //printf("%d vs [%d..%d]\n",ev.time, frameStart, frameStop);
             break;
         }
-        queue.pop(ev);
         //cout << ev << endl;
 
+        //Let notes start on the sample of the event within the next buffer
+        //(late events start at its beginning)
+        int offset = 0;
+        if(ev.time > (int)frameStart)
+            offset = (ev.time - frameStart) * master->synth.buffersize
+                     / (frameStop - frameStart);
+        master->time.setSampleOffset(offset);
+
         switch(ev.type) {
             case M_NOTE:
                 master->noteOn(ev.channel, ev.num, ev.value);
@@ -145,12 +160,34 @@ void InMgr::flush(unsigned frameStart, unsigned frameStop)
                 break;
         }
     }
+    master->time.setSampleOffset(0);
+
+    //keep the events of later buffers
+    npending -= done;
+    memmove(pending, pending + done, npending * sizeof(MidiEvent));
 }
 
 bool InMgr::empty(void) const
 {
-    int semvalue = work.getvalue();
-    return semvalue <= 0;
+    return npending == 0 && queue.empty();
+}
+
+void InMgr::idle(void)
+{
+    const unsigned drops = queue.dropped();
+    if(drops != reported) {
+        cerr << "ERROR: MIDI queue was FULL, " << drops - reported
+             << " events dropped" << endl;
+        reported = drops;
+    }
+    if(queue.grow())
+        cerr << "INFO: MIDI queue grown to " << queue.capacity()
+             << " events" << endl;
+}
+
+unsigned InMgr::dropped(void) const
+{
+    return queue.dropped();
 }
 
 bool InMgr::setSource(string name)
@@ -13,8 +13,7 @@
 #define INMGR_H
 
 #include <string>
-#include "ZynSema.h"
-#include "SafeQueue.h"
+#include "MpscQueue.h"
 
 namespace zyn {
 
@@ -37,6 +36,9 @@ struct MidiEvent {
     float log2_freq;   //type=5,6 for logarithmic representation of note/parameter
 };
 
+//events taken from the queue at once, see InMgr::flush()
+#define MIDI_BATCH 256
+
 //super simple class to manage the inputs
 class InMgr
 {
@@ -44,13 +46,26 @@ class InMgr
         static InMgr &getInstance();
         ~InMgr();
 
+        /**Queue an event, from any driver thread*/
         void putEvent(MidiEvent ev);
 
-        /**Flush the Midi Queue*/
+        /**Flush the Midi Queue
+         *
+         * Dispatches the events before frameStop, which are rendered in the
+         * next buffer covering the driver frames [frameStart, frameStop).
+         * The queued events are taken in batches and dispatched in the order
+         * of their time, events of several drivers may arrive out of order.*/
         void flush(unsigned frameStart, unsigned frameStop);
 
         bool empty() const;
 
+        /**Non realtime housekeeping: grows the queue when it ran full and
+         * reports the events which were dropped meanwhile*/
+        void idle(void);
+
+        /**Events dropped as the queue was full*/
+        unsigned dropped(void) const;
+
         bool setSource(std::string name);
 
         std::string getSource() const;
@@ -61,8 +76,11 @@ class InMgr
     private:
         InMgr();
         class MidiIn *getIn(std::string name);
-        SafeQueue<MidiEvent> queue;
-        mutable ZynSema work;
+        MpscQueue<MidiEvent> queue;
+        //events taken from the queue, sorted by time (realtime thread)
+        MidiEvent pending[MIDI_BATCH];
+        unsigned  npending;
+        unsigned  reported; //drops reported by idle()
         class MidiIn * current;
 
         /**the link to the rest of zyn*/
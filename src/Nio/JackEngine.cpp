@@ -341,11 +341,14 @@ bool JackEngine::processAudio(jack_nframes_t nframes)
         }
     }
 
-    Stereo<float *> smp = getNext();
+    //Render into the port buffers if possible, else copy
+    if(!renderDirect(audio.portBuffs[0], audio.portBuffs[1])) {
+        Stereo<float *> smp = getNext();
 
-    //Assumes size of smp.l == nframes
-    memcpy(audio.portBuffs[0], smp.l, bufferSize * sizeof(float));
-    memcpy(audio.portBuffs[1], smp.r, bufferSize * sizeof(float));
+        //Assumes size of smp.l == nframes
+        memcpy(audio.portBuffs[0], smp.l, bufferSize * sizeof(float));
+        memcpy(audio.portBuffs[1], smp.r, bufferSize * sizeof(float));
+    }
 
     //Make sure the audio output doesn't overflow
     if(isOutputCompressionEnabled)
@@ -359,9 +362,9 @@ bool JackEngine::processAudio(jack_nframes_t nframes)
     return true;
 }
 
-int JackEngine::_xrunCallback(void *)
+int JackEngine::_xrunCallback(void *arg)
 {
-    cerr << "Jack reports xrun" << endl;
+    static_cast<JackEngine *>(arg)->xrun(); //reported by Nio::idle()
     return 0;
 }
 
@@ -122,6 +122,8 @@ bool JackMultiEngine::Start(void)
         errx(1, "jack must have the same buffer size zyn=%d jack=%d",synth.buffersize, jack_get_buffer_size(impl->client));
 
     jack_set_process_callback(impl->client, _processCallback, this);
+    if(jack_set_xrun_callback(impl->client, _xrunCallback, this))
+        warnx("failed at setting the jack xrun callback");
 
     //run
     if(jack_activate(impl->client))
@@ -135,6 +137,12 @@ int JackMultiEngine::_processCallback(jack_nframes_t nframes, void *arg)
     return static_cast<JackMultiEngine *>(arg)->processAudio(nframes);
 }
 
+int JackMultiEngine::_xrunCallback(void *arg)
+{
+    static_cast<JackMultiEngine *>(arg)->xrun(); //reported by Nio::idle()
+    return 0;
+}
+
 int JackMultiEngine::processAudio(jack_nframes_t nframes)
 {
     //Gather all buffers
@@ -150,10 +158,20 @@ int JackMultiEngine::processAudio(jack_nframes_t nframes)
         assert(buffers[i]);
     }
 
-    //Get the wet samples from OutMgr
-    Stereo<float *> smp = getNext();
-    memcpy(buffers[0], smp.l, synth.bufferbytes);
-    memcpy(buffers[1], smp.r, synth.bufferbytes);
+    //Let the master and the parts render into the ports
+    float *partl[NUM_MIDI_PARTS], *partr[NUM_MIDI_PARTS];
+    for(int i = 0; i < NUM_MIDI_PARTS; ++i) {
+        partl[i] = buffers[2*i + 2];
+        partr[i] = buffers[2*i + 3];
+    }
+    const bool direct = renderDirect(buffers[0], buffers[1], partl, partr);
+
+    if(!direct) {
+        //Get the wet samples from OutMgr
+        Stereo<float *> smp = getNext();
+        memcpy(buffers[0], smp.l, synth.bufferbytes);
+        memcpy(buffers[1], smp.r, synth.bufferbytes);
+    }
 
     const int maxFrames = (synth.bufferbytes / sizeof(float));
 
@@ -171,8 +189,10 @@ int JackMultiEngine::processAudio(jack_nframes_t nframes)
     for(int i = 0; i < NUM_MIDI_PARTS; ++i) {
         float &p = impl->peaks[i + 1];
 
-        memcpy(buffers[2*i + 2], master.part[i]->partoutl, synth.bufferbytes);
-        memcpy(buffers[2*i + 3], master.part[i]->partoutr, synth.bufferbytes);
+        if(!direct) {
+            memcpy(buffers[2*i + 2], master.part[i]->partoutl, synth.bufferbytes);
+            memcpy(buffers[2*i + 3], master.part[i]->partoutr, synth.bufferbytes);
+        }
 
         //Make sure the audio output doesn't overflow
         if(isOutputCompressionEnabled)
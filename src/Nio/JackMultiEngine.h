@@ -31,6 +31,7 @@ class JackMultiEngine:public AudioOut
 
     private:
         static int _processCallback(unsigned nframes, void *arg);
+        static int _xrunCallback(void *arg);
         int processAudio(unsigned nframes);
 
         struct jack_multi *impl;
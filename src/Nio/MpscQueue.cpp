@@ -0,0 +1,180 @@
+/*
+  ZynAddSubFX - a software synthesizer
+
+  MpscQueue.cpp - Lock free multiple producer single consumer queue
+
+  This program is free software; you can redistribute it and/or
+  modify it under the terms of the GNU General Public License
+  as published by the Free Software Foundation; either version 2
+  of the License, or (at your option) any later version.
+*/
+
+namespace zyn {
+
+static inline size_t mpscRingSize(size_t n)
+{
+    size_t size = 2;
+    while(size < n)
+        size *= 2;
+    return size;
+}
+
+template<class T>
+MpscQueue<T>::Ring::Ring(size_t size_)
+    :size(mpscRingSize(size_)), writePtr(0), readPtr(0), next(NULL)
+{
+    seq    = new std::atomic<size_t>[size];
+    buffer = new T[size];
+    for(size_t i = 0; i < size; ++i)
+        seq[i].store(i, std::memory_order_relaxed);
+}
+
+template<class T>
+MpscQueue<T>::Ring::~Ring()
+{
+    delete [] seq;
+    delete [] buffer;
+}
+
+template<class T>
+bool MpscQueue<T>::Ring::push(const T &in)
+{
+    const size_t mask = size - 1;
+    size_t w = writePtr.load(std::memory_order_relaxed);
+    for(;;) {
+        const size_t s = seq[w & mask].load(std::memory_order_acquire);
+        const ptrdiff_t diff = (ptrdiff_t)(s - w);
+        if(diff == 0) {
+            //the cell is free, try to claim it
+            if(writePtr.compare_exchange_weak(w, w + 1,
+                                              std::memory_order_relaxed))
+                break;
+        } else if(diff < 0) //the cell was not read yet a round ago
+            return false;
+        else //another writer took the cell
+            w = writePtr.load(std::memory_order_relaxed);
+    }
+    buffer[w & mask] = in;
+    seq[w & mask].store(w + 1, std::memory_order_release);
+    return true;
+}
+
+template<class T>
+bool MpscQueue<T>::Ring::pop(T &out)
+{
+    const size_t mask = size - 1;
+    const size_t r    = readPtr;
+    if(seq[r & mask].load(std::memory_order_acquire) != r + 1)
+        return false;
+    out = buffer[r & mask];
+    seq[r & mask].store(r + size, std::memory_order_release);
+    readPtr = r + 1;
+    return true;
+}
+
+template<class T>
+bool MpscQueue<T>::Ring::empty() const
+{
+    const size_t r = readPtr;
+    return seq[r & (size - 1)].load(std::memory_order_acquire) != r + 1;
+}
+
+template<class T>
+MpscQueue<T>::MpscQueue(size_t size, size_t maxsize)
+    :writers(0), drops(0), crowded(false), maxSize(mpscRingSize(maxsize))
+{
+    rRing = oldest = new Ring(size);
+    wRing.store(rRing);
+    reading.store(rRing);
+}
+
+template<class T>
+MpscQueue<T>::~MpscQueue()
+{
+    while(oldest) {
+        Ring *next = oldest->next.load();
+        delete oldest;
+        oldest = next;
+    }
+}
+
+template<class T>
+int MpscQueue<T>::push(const T &in)
+{
+    //announce the writer before looking up the ring, so the reader does
+    //not leave a ring which is still written to (see pop())
+    writers.fetch_add(1);
+    const bool ok = wRing.load()->push(in);
+    writers.fetch_sub(1);
+
+    if(ok)
+        return 0;
+    drops.fetch_add(1, std::memory_order_relaxed);
+    crowded.store(true, std::memory_order_relaxed);
+    return -1;
+}
+
+template<class T>
+int MpscQueue<T>::pop(T &out)
+{
+    for(;;) {
+        if(rRing->pop(out))
+            return 0;
+
+        //move on to the next ring once no writer can use this one any more
+        Ring *next = rRing->next.load(std::memory_order_acquire);
+        if(!next || wRing.load() == rRing || writers.load() != 0)
+            return -1;
+        if(rRing->pop(out))
+            return 0;
+        rRing = next;
+        reading.store(next, std::memory_order_release);
+    }
+}
+
+template<class T>
+size_t MpscQueue<T>::read(T *out, size_t n)
+{
+    size_t i = 0;
+    while(i < n && !pop(out[i]))
+        ++i;
+    if(2 * i > rRing->size)
+        crowded.store(true, std::memory_order_relaxed);
+    return i;
+}
+
+template<class T>
+bool MpscQueue<T>::empty() const
+{
+    return rRing->empty() && !rRing->next.load(std::memory_order_acquire);
+}
+
+template<class T>
+bool MpscQueue<T>::grow()
+{
+    //free what the reader has left behind
+    Ring *current = reading.load(std::memory_order_acquire);
+    while(oldest != current) {
+        Ring *next = oldest->next.load();
+        delete oldest;
+        oldest = next;
+    }
+
+    Ring *w = wRing.load();
+    if(!crowded.exchange(false, std::memory_order_relaxed)
+       || w->size >= maxSize)
+        return false;
+
+    Ring *ring = new Ring(w->size * 2);
+    w->next.store(ring, std::memory_order_release);
+    wRing.store(ring);
+    return true;
+}
+
+template<class T>
+size_t MpscQueue<T>::capacity() const
+{
+    return wRing.load()->size;
+}
+
+}
@@ -0,0 +1,100 @@
+/*
+  ZynAddSubFX - a software synthesizer
+
+  MpscQueue.h - Lock free multiple producer single consumer queue
+
+  This program is free software; you can redistribute it and/or
+  modify it under the terms of the GNU General Public License
+  as published by the Free Software Foundation; either version 2
+  of the License, or (at your option) any later version.
+*/
+
+#ifndef MPSCQUEUE_H
+#define MPSCQUEUE_H
+#include <atomic>
+#include <cstddef>
+
+namespace zyn {
+
+/**
+ * Lock free queue for any number of writers and one reader, e.g. the MIDI
+ * drivers and the realtime thread.
+ *
+ * The elements are kept in a ring buffer with a sequence number per cell,
+ * so writers only have to agree on the next cell with a compare and swap
+ * and never wait for each other or for the reader.
+ *
+ * A full queue drops the element and counts it. The capacity is grown by
+ * grow(), which allocates and must not be called from the realtime thread:
+ * a larger ring is appended, the writers move on to it and the reader moves
+ * on once it has read the older ring empty.
+ */
+template<class T>
+class MpscQueue
+{
+    public:
+        /**@param size initial capacity, rounded up to a power of two
+         * @param maxsize capacity up to which grow() enlarges the queue*/
+        MpscQueue(size_t size, size_t maxsize);
+        ~MpscQueue();
+
+        /**Any thread
+         * Returns 0 for normal
+         * Returns -1 if the queue is full*/
+        int push(const T &in);
+
+        /**Reader thread
+         * Returns 0 for normal
+         * Returns -1 if the queue is empty*/
+        int pop(T &out);
+
+        /**Reader thread, reads up to n elements
+         * @returns the number of elements read*/
+        size_t read(T *out, size_t n);
+
+        /**Reader thread*/
+        bool empty() const;
+
+        /**Non realtime thread, at most one at a time
+         *
+         * Frees the rings the reader is done with and enlarges the queue if
+         * elements were dropped or a read found it more than half full.
+         * @returns true if the queue was enlarged*/
+        bool grow();
+
+        /**Current capacity*/
+        size_t capacity() const;
+
+        /**Elements dropped by push() since the queue was created*/
+        unsigned dropped() const {return drops.load();}
+
+    private:
+        struct Ring {
+            Ring(size_t size);
+            ~Ring();
+            bool push(const T &in);
+            bool pop(T &out);
+            bool empty() const;
+
+            const size_t size;
+            std::atomic<size_t> *seq; //position the cell is ready for
+            T *buffer;
+            std::atomic<size_t> writePtr;
+            size_t readPtr; //reader only
+            std::atomic<Ring *> next; //ring appended by grow()
+        };
+
+        std::atomic<Ring *> wRing;   //ring of the writers
+        Ring *rRing;                 //ring of the reader
+        std::atomic<Ring *> reading; //rRing, for grow()
+        Ring *oldest;                //first ring not freed yet, for grow()
+        std::atomic<int> writers;    //writers within push()
+        std::atomic<unsigned> drops;
+        std::atomic<bool> crowded;   //grow at the next chance
+        const size_t maxSize;
+};
+
+}
+
+#include "MpscQueue.cpp"
+#endif
@@ -82,6 +82,14 @@ void Nio::setDefaultSink(string name)
     defaultSink = name;
 }
 
+void Nio::idle(void)
+{
+    if(in)
+        in->idle();
+    if(out)
+        out->idle();
+}
+
 bool Nio::setSource(string name)
 {
     return in->setSource(name);
@@ -134,7 +142,8 @@ string Nio::getSink()
 
 #if JACK
 #include <jack/jack.h>
-void Nio::preferredSampleRate(unsigned &rate)
+//a client of the running jack server, or NULL
+static jack_client_t *jackQueryClient(void)
 {
 #if __linux__
     //avoid checking in with jack if it's off
@@ -146,21 +155,42 @@ void Nio::preferredSampleRate(unsigned &rate)
     pclose(ps);
 
     if(!strstr(buffer, "jack"))
-        return;
+        return NULL;
 #endif
 
-    jack_client_t *client = jack_client_open("temp-client",
-                                             JackNoStartServer, 0);
+    return jack_client_open("temp-client", JackNoStartServer, 0);
+}
+
+void Nio::preferredSampleRate(unsigned &rate)
+{
+    jack_client_t *client = jackQueryClient();
     if(client) {
         rate = jack_get_sample_rate(client);
         jack_client_close(client);
     }
 }
+
+void Nio::preferredBufferSize(int &size)
+{
+    jack_client_t *client = jackQueryClient();
+    if(client) {
+        size = jack_get_buffer_size(client);
+        jack_client_close(client);
+    }
+}
 #else
 void Nio::preferredSampleRate(unsigned &)
 {}
+
+void Nio::preferredBufferSize(int &)
+{}
 #endif
 
+unsigned Nio::getLatency(void)
+{
+    return out ? out->getLatency() : 0;
+}
+
 void Nio::masterSwap(Master *master)
 {
     in->setMaster(master);
@@ -45,8 +45,16 @@ namespace Nio
     std::string getSource(void);
     std::string getSink(void);
 
+    //Non realtime housekeeping, to be called regularly from the main loop
+    void idle(void);
+
     //Get the preferred sample rate from jack (if running)
     void preferredSampleRate(unsigned &rate);
+    //Get the period of jack (if running) as buffer size
+    void preferredBufferSize(int &size);
+
+    //Samples the output buffering currently adds to the driver latency
+    unsigned getLatency(void);
 
     //Complete Master Swaps to ONLY BE CALLED FROM RT CONTEXT
     void masterSwap(Master *master);
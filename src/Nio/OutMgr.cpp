@@ -32,13 +32,19 @@ OutMgr &OutMgr::getInstance(const SYNTH_T *synth)
 
 OutMgr::OutMgr(const SYNTH_T *synth_)
     :wave(new WavEngine(*synth_)),
-      priBuf(new float[4096],
-             new float[4096]), priBuffCurrent(priBuf),
-      master(NULL), stales(0), synth(*synth_)
+      ringSize((OUTMGR_MAX_PERIOD / synth_->buffersize + OUTMGR_MAX_RATIO + 2)
+               * synth_->buffersize),
+      ring(new float[ringSize], new float[ringSize]), wPos(0), rPos(0),
+      period(new float[ringSize], new float[ringSize]),
+      master(NULL), xrunOut(NULL), xruns(0), stales(0), latency(0),
+      synth(*synth_)
 {
     assert(synth_);
     currentOut = NULL;
 
+    memset(ring.l, 0, ringSize * sizeof(float));
+    memset(ring.r, 0, ringSize * sizeof(float));
+
     //init samples
     outr = new float[synth.buffersize];
     outl = new float[synth.buffersize];
@@ -49,37 +55,94 @@ OutMgr::OutMgr(const SYNTH_T *synth_)
 OutMgr::~OutMgr()
 {
     delete wave;
-    delete [] priBuf.l;
-    delete [] priBuf.r;
+    delete [] ring.l;
+    delete [] ring.r;
+    delete [] period.l;
+    delete [] period.r;
     delete [] outr;
     delete [] outl;
 }
 
 /* Sequence of a tick
- * 1) Lets remove old/stale samples
- * 2) Apply appliciable midi events
- * 3) Lets see if we need to generate samples
- * 4) Lets generate some
- * 5) Goto 2 if more are needed
- * 6) Lets return those samples to the primary and secondary outputs
- * 7) Lets wait for another tick
+ * 1) Release the samples of the last tick, the driver is done with them
+ * 2) Apply applicable midi events
+ * 3) Render a synth buffer into the ring
+ * 4) Goto 2 if more samples are needed for the period
+ * 5) Return the period, straight from the ring unless it wraps around
+ * 6) What was rendered beyond the period is the added latency
  */
 const Stereo<float *> OutMgr::tick(unsigned int frameSize)
 {
+    assert(frameSize <= OUTMGR_MAX_PERIOD);
+    //the drivers limit their period, but a longer one must not overwrite
+    //samples which were not read yet
+    if(frameSize > OUTMGR_MAX_PERIOD)
+        frameSize = OUTMGR_MAX_PERIOD;
     InMgr &midi = InMgr::getInstance();
     //SysEv->execute();
-    removeStaleSmps();
-    int i=0;
-    while(frameSize > storedSmps()) {
-        if(!midi.empty()) {
-            midi.flush(i*synth.buffersize, (i+1)*synth.buffersize);
-        }
-        master->AudioOut(outl, outr);
-        addSmps(outl, outr);
-        i++;
+    rPos.fetch_add(stales, std::memory_order_release);
+    stales = 0;
+    while(frameSize > buffered()) {
+        //the next buffer covers these frames of the current period
+        const unsigned start = buffered();
+        if(!midi.empty())
+            midi.flush(start, start + smpsPerBuffer());
+        render();
+    }
+
+    const size_t pos = rPos.load(std::memory_order_relaxed) % ringSize;
+    Stereo<float *> out(ring.l + pos, ring.r + pos);
+    if(pos + frameSize > ringSize) {
+        const size_t first = ringSize - pos;
+        memcpy(period.l, out.l, first * sizeof(float));
+        memcpy(period.r, out.r, first * sizeof(float));
+        memcpy(period.l + first, ring.l, (frameSize - first) * sizeof(float));
+        memcpy(period.r + first, ring.r, (frameSize - first) * sizeof(float));
+        out = period;
     }
+
     stales = frameSize;
-    return priBuf;
+    latency.store(buffered() - frameSize, std::memory_order_relaxed);
+    return out;
+}
+
+bool OutMgr::tickDirect(unsigned int frameSize, float *l, float *r,
+                        float *const *partl, float *const *partr)
+{
+    rPos.fetch_add(stales, std::memory_order_release);
+    stales = 0;
+    if(buffered() || frameSize % synth.buffersize
+       || currentOut->getSampleRate() != (int)synth.samplerate)
+        return false;
+
+    InMgr &midi = InMgr::getInstance();
+    float *pl[NUM_MIDI_PARTS], *pr[NUM_MIDI_PARTS];
+    for(unsigned start = 0; start < frameSize; start += synth.buffersize) {
+        if(partl && partr)
+            for(int i = 0; i < NUM_MIDI_PARTS; ++i) {
+                pl[i] = partl[i] + start;
+                pr[i] = partr[i] + start;
+            }
+        if(!midi.empty())
+            midi.flush(start, start + synth.buffersize);
+        if(!master->AudioOut(l + start, r + start,
+                             partl ? pl : NULL, partr ? pr : NULL)) {
+            //no master right now (e.g. it is being swapped), the rest of
+            //the period is silence
+            const size_t bytes = (frameSize - start) * sizeof(float);
+            memset(l + start, 0, bytes);
+            memset(r + start, 0, bytes);
+            if(partl && partr)
+                for(int i = 0; i < NUM_MIDI_PARTS; ++i) {
+                    memset(partl[i] + start, 0, bytes);
+                    memset(partr[i] + start, 0, bytes);
+                }
+            break;
+        }
+        wave->push(Stereo<float *>(l + start, r + start), synth.buffersize);
+    }
+    latency.store(0, std::memory_order_relaxed);
+    return true;
 }
 
 AudioOut *OutMgr::getOut(string name)
@@ -135,6 +198,19 @@ bool OutMgr::getAudioCompressor(void)
     return currentOut->isOutputCompressionEnabled;
 }
 
+void OutMgr::idle()
+{
+    AudioOut *out = currentOut;
+    if(!out)
+        return;
+    const unsigned int x = out->getXruns();
+    if(out == xrunOut && x != xruns)
+        cerr << "WARNING: " << out->name << " reports " << x - xruns
+             << " xrun(s)" << endl;
+    xrunOut = out;
+    xruns   = x;
+}
+
 void OutMgr::setMaster(Master *master_)
 {
     master=master_;
@@ -162,53 +238,59 @@ static size_t resample(float *dest,
     return out_elms;
 }
 
-void OutMgr::addSmps(float *l, float *r)
+size_t OutMgr::smpsPerBuffer() const
 {
-    //allow wave file to syphon off stream
-    wave->push(Stereo<float *>(l, r), synth.buffersize);
+    const float s_out = currentOut->getSampleRate(),
+                s_sys = synth.samplerate;
+    if(s_out != s_sys) //as in resample()
+        return (size_t)synth.buffersize * s_out / s_sys;
+    return synth.buffersize;
+}
 
+void OutMgr::render()
+{
+    const size_t w   = wPos.load(std::memory_order_relaxed);
+    const size_t pos = w % ringSize;
     const int s_out = currentOut->getSampleRate(),
               s_sys = synth.samplerate;
 
-    if(s_out != s_sys) { //we need to resample
-        const size_t steps = resample(priBuffCurrent.l,
-                                      l,
-                                      s_sys,
-                                      s_out,
-                                      synth.buffersize);
-        resample(priBuffCurrent.r, r, s_sys, s_out, synth.buffersize);
-
-        priBuffCurrent.l += steps;
-        priBuffCurrent.r += steps;
-    }
-    else { //just copy the samples
-        memcpy(priBuffCurrent.l, l, synth.bufferbytes);
-        memcpy(priBuffCurrent.r, r, synth.bufferbytes);
-        priBuffCurrent.l += synth.buffersize;
-        priBuffCurrent.r += synth.buffersize;
-    }
-}
-
-void OutMgr::removeStaleSmps()
-{
-    if(!stales)
+    //whole synth buffers never wrap around the ring, render in place
+    if(s_out == s_sys && pos + synth.buffersize <= ringSize) {
+        master->AudioOut(ring.l + pos, ring.r + pos);
+        //allow wave file to syphon off stream
+        wave->push(Stereo<float *>(ring.l + pos, ring.r + pos),
+                   synth.buffersize);
+        wPos.store(w + synth.buffersize, std::memory_order_release);
         return;
+    }
 
-    const int leftover = storedSmps() - stales;
-
-    assert(leftover > -1);
+    master->AudioOut(outl, outr);
+    wave->push(Stereo<float *>(outl, outr), synth.buffersize);
 
-    //leftover samples [seen at very low latencies]
-    if(leftover) {
-        memmove(priBuf.l, priBuffCurrent.l - leftover, leftover * sizeof(float));
-        memmove(priBuf.r, priBuffCurrent.r - leftover, leftover * sizeof(float));
-        priBuffCurrent.l = priBuf.l + leftover;
-        priBuffCurrent.r = priBuf.r + leftover;
+    size_t steps = synth.buffersize;
+    const float *l = outl, *r = outr;
+    if(s_out != s_sys) { //we need to resample (period is free until tick() returns)
+        steps = resample(period.l, outl, s_sys, s_out, synth.buffersize);
+        resample(period.r, outr, s_sys, s_out, synth.buffersize);
+        l = period.l;
+        r = period.r;
     }
-    else
-        priBuffCurrent = priBuf;
+    //above OUTMGR_MAX_RATIO the end of the buffer is dropped instead of
+    //overwriting unread samples
+    steps = std::min(steps, ringSize - buffered());
+
+    const size_t first = std::min(steps, ringSize - pos);
+    memcpy(ring.l + pos, l, first * sizeof(float));
+    memcpy(ring.r + pos, r, first * sizeof(float));
+    memcpy(ring.l, l + first, (steps - first) * sizeof(float));
+    memcpy(ring.r, r + first, (steps - first) * sizeof(float));
+    wPos.store(w + steps, std::memory_order_release);
+}
 
-    stales = 0;
+unsigned int OutMgr::buffered() const
+{
+    return wPos.load(std::memory_order_acquire)
+           - rPos.load(std::memory_order_acquire);
 }
 
 }
@@ -14,10 +14,16 @@
 
 #include "../Misc/Stereo.h"
 #include "../globals.h"
+#include <atomic>
 #include <list>
 #include <string>
 #include <semaphore.h>
 
+//longest driver period OutMgr::tick() can serve
+#define OUTMGR_MAX_PERIOD 8192
+//highest ratio of the driver to the synth sample rate the ring is sized for
+#define OUTMGR_MAX_RATIO 16
+
 namespace zyn {
 
 class AudioOut;
@@ -28,9 +34,24 @@ class OutMgr
         static OutMgr &getInstance(const SYNTH_T *synth=NULL);
         ~OutMgr();
 
-        /**Execute a tick*/
+        /**Execute a tick
+         *
+         * Renders synth buffers until frameSize samples are available and
+         * returns them. They stay valid until the next tick.
+         * @param frameSize at most OUTMGR_MAX_PERIOD*/
         const Stereo<float *> tick(unsigned int frameSize) REALTIME;
 
+        /**Execute a tick, rendering straight into the buffers of the driver
+         *
+         * Only possible when the driver runs at the sample rate of the synth,
+         * frameSize is a multiple of the synth buffer size and no samples are
+         * left over from an earlier tick().
+         * @param partl,partr optional outputs per part, see Master::AudioOut
+         * @return false if nothing was rendered and tick() has to be used*/
+        bool tickDirect(unsigned int frameSize, float *l, float *r,
+                        float *const *partl = NULL,
+                        float *const *partr = NULL) REALTIME;
+
         /**Request a new set of samples
          * @param n number of requested samples (defaults to 1)
          * @return -1 for locking issues 0 for valid request*/
@@ -60,25 +81,49 @@ class OutMgr
 
         void setMaster(class Master *master_);
         void applyOscEventRt(const char *msg);
+
+        /**Latency added by the buffering in samples of the driver: the
+         * samples rendered ahead of the last period, which the driver only
+         * gets with the next one. 0 when the driver period is a multiple of
+         * the synth buffer size, see the --pin-buffer-size option.*/
+        unsigned int getLatency() const {return latency.load(std::memory_order_relaxed);}
+
+        /**Non realtime housekeeping: reports the xruns of the driver*/
+        void idle();
     private:
         OutMgr(const SYNTH_T *synth);
-        void addSmps(float *l, float *r);
-        unsigned int  storedSmps() const {return priBuffCurrent.l - priBuf.l; }
-        void removeStaleSmps();
+        /**Render one synth buffer into the ring*/
+        void render();
+        /**Output samples produced by one synth buffer*/
+        size_t smpsPerBuffer() const;
+        /**Samples in the ring which were not handed to the driver yet*/
+        unsigned int buffered() const;
 
         AudioOut *currentOut; /**<The current output driver*/
 
         sem_t requested;
 
-        /**Buffer*/
-        Stereo<float *> priBuf;          //buffer for primary drivers
-        Stereo<float *> priBuffCurrent; //current array accessor
-
+        /**Single producer single consumer ring buffer between the synthesis
+         * and the driver. It is written in synth buffers and read in driver
+         * periods, wPos and rPos count the samples since the start.*/
+        const size_t ringSize; //a multiple of the synth buffer size, room
+                               //for a period and a resampled buffer
+        Stereo<float *> ring;
+        std::atomic<size_t> wPos;
+        std::atomic<size_t> rPos;
+        Stereo<float *> period; //copy of a period wrapping around the ring
+
+        //synth buffer before resampling
         float *outl;
         float *outr;
         class Master *master;
 
-        int stales;
+        //xruns of the driver reported by idle()
+        AudioOut *xrunOut;
+        unsigned int xruns;
+
+        int stales; //samples handed to the driver by the last tick
+        std::atomic<unsigned int> latency;
         const SYNTH_T &synth;
 };
 
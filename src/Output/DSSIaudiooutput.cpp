@@ -623,6 +623,7 @@ DSSIaudiooutput::DSSIaudiooutput(unsigned long sampleRate) : dssi_control{dssi_c
 {
     zyn::SYNTH_T synth;
     synth.samplerate = sampleRate;
+    synth.controlperiod = config.cfg.ControlPeriod;
 
     this->sampleRate  = sampleRate;
     this->banksInited = false;
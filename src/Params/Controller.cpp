@@ -196,7 +196,8 @@ void Controller::setpitchwheel()
         cents *= pitchwheel.bendrange_down;
     else
         cents *= pitchwheel.bendrange;
-    pitchwheel.relfreq = powf(2, cents / 1200.0f);
+    pitchwheel.relfreq_log2 = cents / 1200.0f;
+    pitchwheel.relfreq = powf(2, pitchwheel.relfreq_log2);
     //fprintf(stderr,"%ld %ld -> %.3f\n",pitchwheel.bendrange,pitchwheel.data,pitchwheel.relfreq);fflush(stderr);
 }
 
@@ -72,6 +72,7 @@ class Controller
             short int bendrange; //bendrange is in cents
             short int bendrange_down;
             float     relfreq; //the relative frequency (default is 1.0f)
+            float     relfreq_log2; //log2 of relfreq, for bend adjustments
         } pitchwheel;
 
         struct { //Expression
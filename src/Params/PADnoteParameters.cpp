@@ -13,6 +13,7 @@
 #include <limits>
 #include <cmath>
 #include "PADnoteParameters.h"
+#include "PADsampleStore.h"
 #include "FilterParams.h"
 #include "EnvelopeParams.h"
 #include "LFOParams.h"
@@ -20,8 +21,10 @@
 #include "../Synth/OscilGen.h"
 #include "../Misc/WavFile.h"
 #include "../Misc/Time.h"
+#include "../Misc/Denormal.h"
 #include <cstdio>
 #include <thread>
+#include <atomic>
 
 #include <rtosc/ports.h>
 #include <rtosc/port-sugar.h>
@@ -84,21 +87,27 @@ static const rtosc::Ports realtime_ports =
             rOptions(L35cents, L10cents, E100cents, E1200cents),
             rDefault(L10cents), "Magnitude of Detune"),
 
-    {"sample#64:ifb", rProp(internal) rDoc("Nothing to see here"), 0,
+    {"sample#64:ifbbf", rProp(internal) rDoc("Nothing to see here"), 0,
         [](const char *m, rtosc::RtData &d)
         {
             // MiddleWare calls this to send the generated sample buffers to us
             assert(rtosc_argument(m,2).b.len == sizeof(void*));
+            assert(rtosc_argument(m,3).b.len == sizeof(void*));
             PADnoteParameters *p = (PADnoteParameters*)d.obj;
             const char *mm = m;
             while(!isdigit(*mm))++mm;
             int n = atoi(mm);
-            float *oldsmp = p->sample[n].smp;
+            float *oldsmp   = p->sample[n].smp;
+            short *oldsmp16 = p->sample[n].smp16;
             p->sample[n].size     = rtosc_argument(m,0).i;
             p->sample[n].basefreq = rtosc_argument(m,1).f;
             p->sample[n].smp      = *(float**)rtosc_argument(m,2).b.data;
+            p->sample[n].smp16    = *(short**)rtosc_argument(m,3).b.data;
+            p->sample[n].scale    = rtosc_argument(m,4).f;
             if (oldsmp)
                 d.reply("/free", "sb", "PADsample", sizeof(void*), &oldsmp);
+            if (oldsmp16)
+                d.reply("/free", "sb", "PADsample", sizeof(void*), &oldsmp16);
         }},
     //weird stuff for PCoarseDetune
     {"detunevalue:", rMap(unit,cents) rDoc("Get detune value"), NULL,
@@ -346,8 +355,11 @@ PADnoteParameters::PADnoteParameters(const SYNTH_T &synth_, FFTwrapper *fft_,
     FilterEnvelope->init(ad_global_filter);
     FilterLfo = new LFOParams(ad_global_filter, time_);
 
-    for(int i = 0; i < PAD_MAX_SAMPLES; ++i)
-        sample[i].smp = NULL;
+    for(int i = 0; i < PAD_MAX_SAMPLES; ++i) {
+        sample[i].smp   = NULL;
+        sample[i].smp16 = NULL;
+        sample[i].scale = 1.0f;
+    }
 
     defaults();
 }
@@ -438,8 +450,11 @@ void PADnoteParameters::deletesample(int n)
     if((n < 0) || (n >= PAD_MAX_SAMPLES))
         return;
 
-    delete[] sample[n].smp;
-    sample[n].smp = NULL;
+    PADsampleStore::release(sample[n].smp);
+    PADsampleStore::release(sample[n].smp16);
+    sample[n].smp   = NULL;
+    sample[n].smp16 = NULL;
+    sample[n].scale = 1.0f;
     sample[n].size     = 0;
     sample[n].basefreq = 440.0f;
 }
@@ -719,19 +734,12 @@ static float Pbwscale_translate(char Pbwscale)
 void PADnoteParameters::generatespectrum_bandwidthMode(float *spectrum,
                                                        int size,
                                                        float basefreq,
+                                                       const float *harmonics,
                                                        const float *profile,
                                                        int profilesize,
                                                        float bwadjust) const
 {
-    float harmonics[synth.oscilsize];
     memset(spectrum, 0, sizeof(float) * size);
-    memset(harmonics, 0, sizeof(float) * synth.oscilsize);
-
-    //get the harmonic structure from the oscillator (I am using the frequency amplitudes, only)
-    oscilgen->get(harmonics, basefreq, false);
-
-    //normalize
-    normalize_max(harmonics, synth.oscilsize / 2);
 
     //Constants across harmonics
     const float power = Pbwscale_translate(Pbwscale);
@@ -796,17 +804,10 @@ void PADnoteParameters::generatespectrum_bandwidthMode(float *spectrum,
  */
 void PADnoteParameters::generatespectrum_otherModes(float *spectrum,
                                                     int size,
-                                                    float basefreq) const
+                                                    float basefreq,
+                                                    const float *harmonics) const
 {
-    float harmonics[synth.oscilsize];
-    memset(spectrum,  0, sizeof(float) * size);
-    memset(harmonics, 0, sizeof(float) * synth.oscilsize);
-
-    //get the harmonic structure from the oscillator (I am using the frequency amplitudes, only)
-    oscilgen->get(harmonics, basefreq, false);
-
-    //normalize
-    normalize_max(harmonics, synth.oscilsize / 2);
+    memset(spectrum, 0, sizeof(float) * size);
 
     for(int nh = 1; nh < synth.oscilsize / 2; ++nh) { //for each harmonic
         const float realfreq = getNhr(nh) * basefreq;
@@ -854,22 +855,69 @@ void PADnoteParameters::applyparameters()
 }
 
 void PADnoteParameters::applyparameters(std::function<bool()> do_abort,
-                                        unsigned max_threads)
+                                        unsigned max_threads,
+                                        prng_t *rnd)
 {
     if(do_abort())
         return;
     unsigned num = sampleGenerator([this]
                        (unsigned N, PADnoteParameters::Sample&& smp) {
-                           delete[] sample[N].smp;
+                           PADsampleStore::release(sample[N].smp);
+                           PADsampleStore::release(sample[N].smp16);
                            sample[N] = std::move(smp);
                        },
-                       do_abort, max_threads);
+                       do_abort, max_threads, rnd);
 
     //Delete remaining unused samples
     for(unsigned i = num; i < PAD_MAX_SAMPLES; ++i)
         deletesample(i);
 }
 
+/*
+ * The instances are handed out to a pool of workers. The hardware threads
+ * are split between the workers, as sampleGenerator() spreads the samples
+ * of one instance over threads as well. The random phases of each instance
+ * come from its own generator, seeded before the workers start, so that
+ * the result does not depend on the order in which the workers run.
+ */
+void PADnoteParameters::applyparameters(
+    const std::vector<PADnoteParameters *> &pars,
+    std::function<bool()> do_abort)
+{
+#ifdef WIN32
+    //C++11 threads are broken on mingw cross compilation, see below
+    for(PADnoteParameters *p:pars)
+        p->applyparameters(do_abort);
+#else
+    if(pars.size() <= 1) {
+        for(PADnoteParameters *p:pars)
+            p->applyparameters(do_abort);
+        return;
+    }
+
+    const unsigned cores    = std::max(1u, std::thread::hardware_concurrency());
+    const unsigned nworkers = std::min<unsigned>(cores, pars.size());
+    const unsigned nthreads = std::max(1u, cores / nworkers);
+
+    std::vector<prng_t> rnds(pars.size());
+    for(prng_t &rnd:rnds)
+        rnd = prng();
+
+    std::atomic<unsigned> next(0);
+    auto worker = [&pars, &rnds, &next, &do_abort, nthreads]() {
+        for(unsigned i = next++; i < pars.size(); i = next++)
+            pars[i]->applyparameters(do_abort, nthreads, &rnds[i]);
+    };
+
+    std::vector<std::thread> workers;
+    for(unsigned i = 1; i < nworkers; ++i)
+        workers.emplace_back(worker);
+    worker();
+    for(std::thread &t:workers)
+        t.join();
+#endif
+}
+
 //Requires
 // - Pquality.samplesize
 // - Pquality.basenote
@@ -878,10 +926,13 @@ void PADnoteParameters::applyparameters(std::function<bool()> do_abort,
 // - spectrum at various frequencies (oodles of data)
 int PADnoteParameters::sampleGenerator(PADnoteParameters::callback cb,
         std::function<bool()> do_abort,
-        unsigned max_threads)
+        unsigned max_threads,
+        prng_t *rnd)
 {
     if(!max_threads)
         max_threads = std::numeric_limits<unsigned>::max();
+    if(!rnd)
+        rnd = &prng_state;
 
     const int samplesize   = (((int) 1) << (Pquality.samplesize + 14));
     const int spectrumsize = samplesize / 2;
@@ -919,17 +970,35 @@ int PADnoteParameters::sampleGenerator(PADnoteParameters::callback cb,
     // a workaround to allow using the IDE
     float * const adj_ptr = adj;
 
+    //the harmonic structure of the oscillator (only the frequency amplitudes
+    //are used) is computed here, as the threads must not share the OscilGen
+    if(oscilgen->needPrepare())
+        oscilgen->prepare();
+    const int nharmonics = synth.oscilsize / 2;
+    float *harmonics = new float[samplemax * nharmonics];
+    memset(harmonics, 0, sizeof(float) * samplemax * nharmonics);
+    for(int nsample = 0; nsample < samplemax; ++nsample) {
+        const float basefreqadjust =
+            powf(2.0f, adj[nsample] - adj[samplemax - 1] * 0.5f);
+        float *h = harmonics + nsample * nharmonics;
+        oscilgen->get(oscilgen->myBuffers(), h, basefreq * basefreqadjust,
+                      false);
+        normalize_max(h, nharmonics);
+    }
+
     const PADnoteParameters* this_c = this;
 
     auto thread_cb = [basefreq, bwadjust, &cb, do_abort,
                       samplesize, samplemax, spectrumsize,
-                      adj_ptr, &profile, this_c](
-                      unsigned nthreads, unsigned threadno)
+                      adj_ptr, harmonics, nharmonics, &profile, this_c](
+                      unsigned nthreads, unsigned threadno, prng_t &rnd)
     {
+        DenormalGuard denormalGuard;
         //prepare a BIG IFFT
         FFTwrapper    *fft      = new FFTwrapper(samplesize);
         FFTfreqBuffer  fftfreqs = fft->allocFreqBuf();
         float         *spectrum = new float[spectrumsize];
+        float         *work     = NULL;
 
         for(int nsample = 0; nsample < samplemax; ++nsample)
         if(nsample % nthreads == threadno)
@@ -939,45 +1008,93 @@ int PADnoteParameters::sampleGenerator(PADnoteParameters::callback cb,
             const float basefreqadjust =
                 powf(2.0f, adj_ptr[nsample] - adj_ptr[samplemax - 1] * 0.5f);
 
+            const float *h = harmonics + nsample * nharmonics;
             if(this_c->Pmode == pad_mode::bandwidth)
                 this_c->generatespectrum_bandwidthMode(spectrum,
                                                        spectrumsize,
                                                        basefreq*basefreqadjust,
+                                                       h,
                                                        profile,
                                                        profilesize,
                                                        bwadjust);
             else
                 this_c->generatespectrum_otherModes(spectrum, spectrumsize,
-                                                    basefreq * basefreqadjust);
+                                                    basefreq * basefreqadjust,
+                                                    h);
+
+            //step the generator once per spectrum, as OscilGen::get() did
+            rnd = (prng_r(rnd) & 0x7fffffff) + 1;
 
             //the last samples contain the first samples
-            //(used for linear/cubic interpolation)
-            const int extra_samples = 5;
+            //(used for linear/cubic/sinc interpolation)
+            const int extra_samples = 8;
             PADnoteParameters::Sample newsample;
-            newsample.smp = new float[samplesize + extra_samples];
-
-            newsample.smp[0] = 0.0f;
-            fftfreqs[0] = fft_t(0, 0);
-            for(int i = 1; i < spectrumsize; ++i) //randomize the phases
-                fftfreqs[i] = FFTpolar(spectrum[i], (float)RND * 2 * PI);
-            //that's all; here is the only ifft for the whole sample;
-            //no windows are used ;-)
-            fft->freqs2smps_noconst_input(fftfreqs, fft->allocSampleBuf(newsample.smp));
-
-            //normalize(rms)
-            float rms = 0.0f;
-            for(int i = 0; i < samplesize; ++i)
-                rms += newsample.smp[i] * newsample.smp[i];
-            rms = sqrtf(rms);
-            if(rms < 0.000001f)
-                rms = 1.0f;
-            rms *= sqrtf(262144.0f / samplesize);//262144=2^18
-            for(int i = 0; i < samplesize; ++i)
-                newsample.smp[i] *= 1.0f / rms * 50.0f;
-
-            //prepare extra samples used by the linear or cubic interpolation
-            for(int i = 0; i < extra_samples; ++i)
-                newsample.smp[i + samplesize] = newsample.smp[i];
+            newsample.smp   = NULL;
+            newsample.smp16 = NULL;
+            newsample.scale = 1.0f;
+
+            //equal spectra are shared with other instances, so only
+            //compute the sample if there is none for the spectrum yet
+            const bool compact = PADsampleStore::compact();
+            const PADsampleStore::key_t key =
+                PADsampleStore::key(spectrum, spectrumsize, compact);
+            void *shared = PADsampleStore::acquire(key, newsample.scale);
+            if(shared)  //draw the phases anyway, for the following samples
+                for(int i = 1; i < spectrumsize; ++i)
+                    prng_r(rnd);
+            if(shared && compact)
+                newsample.smp16 = (short *)shared;
+            else if(shared)
+                newsample.smp = (float *)shared;
+            else {
+                //compact samples are computed in a reused float buffer
+                if(compact && !work)
+                    work = new float[samplesize + extra_samples];
+                float *smp = compact ? work
+                                     : new float[samplesize + extra_samples];
+
+                smp[0] = 0.0f;
+                fftfreqs[0] = fft_t(0, 0);
+                for(int i = 1; i < spectrumsize; ++i) //randomize the phases
+                    fftfreqs[i] = FFTpolar(spectrum[i], RND_r(rnd) * 2 * PI);
+                //that's all; here is the only ifft for the whole sample;
+                //no windows are used ;-)
+                fft->freqs2smps_noconst_input(fftfreqs, fft->allocSampleBuf(smp));
+
+                //normalize(rms)
+                float rms = 0.0f;
+                for(int i = 0; i < samplesize; ++i)
+                    rms += smp[i] * smp[i];
+                rms = sqrtf(rms);
+                if(rms < 0.000001f)
+                    rms = 1.0f;
+                rms *= sqrtf(262144.0f / samplesize);//262144=2^18
+                for(int i = 0; i < samplesize; ++i)
+                    smp[i] *= 1.0f / rms * 50.0f;
+
+                //prepare extra samples used by the linear or cubic interpolation
+                for(int i = 0; i < extra_samples; ++i)
+                    smp[i + samplesize] = smp[i];
+
+                if(compact) {
+                    //quantize with the peak at full scale
+                    float peak = 0.0f;
+                    for(int i = 0; i < samplesize; ++i)
+                        peak = std::max(peak, fabsf(smp[i]));
+                    if(peak > 0.0f)
+                        newsample.scale = peak / 32767.0f;
+                    const float step = 1.0f / newsample.scale;
+                    short *smp16 = new short[samplesize + extra_samples];
+                    for(int i = 0; i < samplesize + extra_samples; ++i)
+                        smp16[i] = (short)lrintf(smp[i] * step);
+                    newsample.smp16 = PADsampleStore::publish(
+                        key, smp16, samplesize + extra_samples,
+                        newsample.scale);
+                }
+                else
+                    newsample.smp = PADsampleStore::publish(
+                        key, smp, samplesize + extra_samples);
+            }
 
             //yield new sample
             newsample.size     = samplesize;
@@ -989,25 +1106,30 @@ int PADnoteParameters::sampleGenerator(PADnoteParameters::callback cb,
         delete (fft);
         delete[] fftfreqs.data;
         delete[] spectrum;
+        delete[] work;
     };
 
-    if(oscilgen->needPrepare())
-        oscilgen->prepare();
-
 #ifdef WIN32
     //Temporarily disable multi-threading here as C++11 threads are broken on
     //mingw cross compilation
-    thread_cb(1,0);
+    thread_cb(1, 0, *rnd);
 #else
-    unsigned nthreads = std::min(max_threads,
-                                 std::thread::hardware_concurrency());
+    unsigned nthreads = std::max(1u, std::min(max_threads,
+                                 std::thread::hardware_concurrency()));
+    //the first thread continues rnd, the others get seeds drawn from it
+    std::vector<prng_t> rnds(nthreads);
+    for(unsigned i = 1; i < nthreads; ++i)
+        rnds[i] = prng_r(*rnd);
+    rnds[0] = *rnd;
     std::vector<std::thread> threads(nthreads);
     for(unsigned i = 0; i < nthreads; ++i)
-        threads[i] = std::thread(thread_cb, nthreads, i);
+        threads[i] = std::thread(thread_cb, nthreads, i, std::ref(rnds[i]));
     for(unsigned i = 0; i < nthreads; ++i)
         threads[i].join();
+    *rnd = rnds[0];
 #endif
 
+    delete[] harmonics;
     return samplemax;
 }
 
@@ -1016,7 +1138,7 @@ void PADnoteParameters::export2wav(std::string basefilename)
     applyparameters();
     basefilename += "_PADsynth_";
     for(int k = 0; k < PAD_MAX_SAMPLES; ++k) {
-        if(sample[k].smp == NULL)
+        if(!sample[k].valid())
             continue;
         char tmpstr[20];
         snprintf(tmpstr, 20, "_%02d", k + 1);
@@ -1026,7 +1148,7 @@ void PADnoteParameters::export2wav(std::string basefilename)
             int nsmps = sample[k].size;
             short int *smps = new short int[nsmps];
             for(int i = 0; i < nsmps; ++i)
-                smps[i] = (short int)(sample[k].smp[i] * 32767.0f);
+                smps[i] = (short int)(sample[k].value(i) * 32767.0f);
             wav.writeMonoSamples(nsmps, smps);
         }
     }
@@ -15,9 +15,11 @@
 #define PAD_NOTE_PARAMETERS_H
 
 #include "../globals.h"
+#include "../Misc/Util.h"
 
 #include "Presets.h"
 #include <string>
+#include <vector>
 #include <functional>
 
 namespace zyn {
@@ -161,7 +163,13 @@ class PADnoteParameters:public Presets
         //! Compute the #sample array from the other parameters.
         //! For the function's parameters, see sampleGenerator()
         void applyparameters(std::function<bool()> do_abort,
-                             unsigned max_threads = 0);
+                             unsigned max_threads = 0,
+                             prng_t *rnd = NULL);
+        //! Compute the #sample arrays of several instances in parallel,
+        //! sharing the hardware threads between them.
+        //! Returns after all instances are done.
+        static void applyparameters(const std::vector<PADnoteParameters *> &pars,
+                                    std::function<bool()> do_abort);
         void export2wav(std::string basefilename);
 
         OscilGen  *oscilgen;
@@ -170,7 +178,12 @@ class PADnoteParameters:public Presets
         struct Sample {
             int    size;
             float  basefreq;
-            float *smp;
+            float *smp;   //!< samples, NULL if unused or compact
+            short *smp16; //!< compact samples, NULL if unused or float
+            float  scale; //!< value of one step of smp16
+
+            bool valid(void) const { return smp || smp16; }
+            float value(int i) const { return smp ? smp[i] : smp16[i] * scale; }
         };
 
         //! RT sample data
@@ -190,9 +203,13 @@ class PADnoteParameters:public Presets
         //!                 user)
         //! @param max_threads Maximum number of threads for computation, or
         //!                    zero if no maximum shall be set
+        //! @param rnd Generator of the random phases, NULL for the global
+        //!            one. The samples only depend on it and the parameters,
+        //!            for a given number of threads
         int sampleGenerator(PADnoteParameters::callback cb,
                             std::function<bool()> do_abort,
-                            unsigned max_threads = 0);
+                            unsigned max_threads = 0,
+                            prng_t *rnd = NULL);
 
         const AbsTime *time;
         int64_t last_update_timestamp;
@@ -205,12 +222,14 @@ class PADnoteParameters:public Presets
         void generatespectrum_bandwidthMode(float *spectrum,
                                             int size,
                                             float basefreq,
+                                            const float *harmonics,
                                             const float *profile,
                                             int profilesize,
                                             float bwadjust) const;
         void generatespectrum_otherModes(float *spectrum,
                                          int size,
-                                         float basefreq) const;
+                                         float basefreq,
+                                         const float *harmonics) const;
         void deletesamples();
         void deletesample(int n);
 
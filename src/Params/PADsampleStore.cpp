@@ -0,0 +1,153 @@
+/*
+  ZynAddSubFX - a software synthesizer
+
+  PADsampleStore.cpp - Shared storage of PADsynth sample buffers
+
+  This program is free software; you can redistribute it and/or
+  modify it under the terms of the GNU General Public License
+  as published by the Free Software Foundation; either version 2
+  of the License, or (at your option) any later version.
+*/
+
+#include <atomic>
+#include <cassert>
+#include <cstring>
+#include <pthread.h>
+#include <unordered_map>
+
+#include "PADsampleStore.h"
+
+namespace zyn {
+
+struct StoreEntry {
+    void    *smp;  //NULL while a thread computes it
+    int      size;
+    bool     compact; //smp holds shorts instead of floats
+    float    scale;
+    unsigned refs;
+};
+
+//pthread like FFTwrapper, as C++11 threads are broken on mingw
+static pthread_mutex_t mutex     = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t  published = PTHREAD_COND_INITIALIZER;
+
+static std::atomic<bool> compact_mode(false);
+
+static std::unordered_map<PADsampleStore::key_t, StoreEntry> &entries(void)
+{
+    static std::unordered_map<PADsampleStore::key_t, StoreEntry> map;
+    return map;
+}
+
+static std::unordered_map<const void *, PADsampleStore::key_t> &keys(void)
+{
+    static std::unordered_map<const void *, PADsampleStore::key_t> map;
+    return map;
+}
+
+//FNV-1a over the words of the spectrum
+PADsampleStore::key_t PADsampleStore::key(const float *spectrum,
+                                          int spectrumsize,
+                                          bool compact)
+{
+    key_t hash = 14695981039346656037ull;
+    hash = (hash ^ (uint32_t)spectrumsize) * 1099511628211ull;
+    hash = (hash ^ (uint32_t)compact) * 1099511628211ull;
+    for(int i = 0; i < spectrumsize; ++i) {
+        uint32_t word;
+        memcpy(&word, spectrum + i, sizeof(word));
+        hash = (hash ^ word) * 1099511628211ull;
+    }
+    return hash;
+}
+
+void *PADsampleStore::acquire(key_t key, float &scale)
+{
+    void *smp = NULL;
+    pthread_mutex_lock(&mutex);
+    auto itr = entries().find(key);
+    while(itr != entries().end() && itr->second.smp == NULL) {
+        pthread_cond_wait(&published, &mutex);
+        itr = entries().find(key);
+    }
+    if(itr == entries().end())
+        entries()[key] = StoreEntry{NULL, 0, false, 1.0f, 0}; //computed by the caller
+    else {
+        itr->second.refs++;
+        smp   = itr->second.smp;
+        scale = itr->second.scale;
+    }
+    pthread_mutex_unlock(&mutex);
+    return smp;
+}
+
+static void store(PADsampleStore::key_t key, const StoreEntry &entry)
+{
+    pthread_mutex_lock(&mutex);
+    entries()[key]    = entry;
+    keys()[entry.smp] = key;
+    pthread_cond_broadcast(&published);
+    pthread_mutex_unlock(&mutex);
+}
+
+float *PADsampleStore::publish(key_t key, float *smp, int size)
+{
+    store(key, StoreEntry{smp, size, false, 1.0f, 1});
+    return smp;
+}
+
+short *PADsampleStore::publish(key_t key, short *smp, int size, float scale)
+{
+    store(key, StoreEntry{smp, size, true, scale, 1});
+    return smp;
+}
+
+void PADsampleStore::release(const void *smp)
+{
+    if(smp == NULL)
+        return;
+
+    StoreEntry unused{NULL, 0, false, 1.0f, 0};
+    pthread_mutex_lock(&mutex);
+    auto itr = keys().find(smp);
+    assert(itr != keys().end());
+    if(itr != keys().end()) {
+        StoreEntry &entry = entries()[itr->second];
+        if(--entry.refs == 0) {
+            unused = entry;
+            entries().erase(itr->second);
+            keys().erase(itr);
+        }
+    }
+    pthread_mutex_unlock(&mutex);
+    if(unused.compact)
+        delete[] (short *)unused.smp;
+    else
+        delete[] (float *)unused.smp;
+}
+
+void PADsampleStore::setCompact(bool compact)
+{
+    compact_mode = compact;
+}
+
+bool PADsampleStore::compact(void)
+{
+    return compact_mode;
+}
+
+void PADsampleStore::stats(size_t &buffers, size_t &bytes)
+{
+    pthread_mutex_lock(&mutex);
+    buffers = 0;
+    bytes   = 0;
+    for(auto &e:entries())
+        if(e.second.smp) {
+            buffers++;
+            bytes += e.second.size * (e.second.compact ? sizeof(short)
+                                                       : sizeof(float));
+        }
+    pthread_mutex_unlock(&mutex);
+}
+
+}
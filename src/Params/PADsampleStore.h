@@ -0,0 +1,78 @@
+/*
+  ZynAddSubFX - a software synthesizer
+
+  PADsampleStore.h - Shared storage of PADsynth sample buffers
+
+  This program is free software; you can redistribute it and/or
+  modify it under the terms of the GNU General Public License
+  as published by the Free Software Foundation; either version 2
+  of the License, or (at your option) any later version.
+*/
+
+#ifndef PAD_SAMPLE_STORE_H
+#define PAD_SAMPLE_STORE_H
+
+#include <cstddef>
+#include <cstdint>
+
+namespace zyn {
+
+/**
+ * Process wide store of the sample buffers of all PADnoteParameters.
+ *
+ * A buffer is identified by a hash of the spectrum it is computed from.
+ * Instances with equal spectra, e.g. the same instrument on several parts,
+ * kit items or Masters, share one read-only buffer instead of computing and
+ * keeping their own. Buffers are reference counted and freed together with
+ * their last reference.
+ *
+ * In compact mode (setCompact()) newly computed samples are stored as int16
+ * with a per-sample scale, which halves the memory and the cache footprint
+ * of PADsynth heavy sessions at 16 bit resolution.
+ *
+ * All functions are thread safe, but none of them is realtime safe.
+ */
+class PADsampleStore
+{
+    public:
+        typedef uint64_t key_t;
+
+        /**Key of the buffer computed from a spectrum in the given format*/
+        static key_t key(const float *spectrum, int spectrumsize,
+                         bool compact);
+
+        /**
+         * Look up a buffer.
+         * While another thread computes the buffer of the same key, this
+         * waits for it.
+         * @param scale set to the scale of a compact buffer
+         * @returns the buffer with a new reference, or NULL if there is no
+         *          buffer for key. In this case the caller has to compute it
+         *          and pass it to publish().
+         */
+        static void *acquire(key_t key, float &scale);
+
+        /**
+         * Store a buffer computed after acquire() returned NULL.
+         * @param smp buffer allocated with new[], owned by the store now
+         * @param size number of samples in smp
+         * @param scale value of one step of a compact buffer
+         * @returns smp with one reference for the caller
+         */
+        static float *publish(key_t key, float *smp, int size);
+        static short *publish(key_t key, short *smp, int size, float scale);
+
+        /**Drop a reference from acquire() or publish(). NULL is ignored.*/
+        static void release(const void *smp);
+
+        /**Store samples computed from now on as int16 (off by default)*/
+        static void setCompact(bool compact);
+        static bool compact(void);
+
+        /**Number of stored buffers and the sum of their sizes in bytes*/
+        static void stats(size_t &buffers, size_t &bytes);
+};
+
+}
+
+#endif
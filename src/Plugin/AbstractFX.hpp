@@ -26,12 +26,17 @@
 // DPF includes
 #include "DistrhoPlugin.hpp"
 
+#include <chrono>
+
 // ZynAddSubFX includes
 #include "Params/FilterParams.h"
 #include "Effects/Effect.h"
 #include "Misc/Allocator.h"
+#include "Misc/Denormal.h"
 #include "zyn-version.h"
 
+#include "BlockFifo.hpp"
+
 /* ------------------------------------------------------------------------------------------------------------
  * Abstract plugin class */
 
@@ -40,28 +45,28 @@ class AbstractPluginFX : public Plugin
 {
 public:
     AbstractPluginFX(const uint32_t params, const uint32_t programs)
-        : Plugin(params-2, programs, 0),
+        : Plugin(params-2+1, programs, 0), // plus the CPU load output
           paramCount(params-2), // volume and pan handled by host
           programCount(programs),
           bufferSize(getBufferSize()),
+          blockSize(getBlockSize(bufferSize)),
           sampleRate(getSampleRate()),
           effect(nullptr),
           efxoutl(nullptr),
-          efxoutr(nullptr)
+          efxoutr(nullptr),
+          fifo(blockSize),
+          latency(0),
+          cpuLoad(0.0f)
     {
-        efxoutl = new float[bufferSize];
-        efxoutr = new float[bufferSize];
         filterpar = new zyn::FilterParams();
-        std::memset(efxoutl, 0, sizeof(float)*bufferSize);
-        std::memset(efxoutr, 0, sizeof(float)*bufferSize);
+        allocBuffers();
 
         doReinit(true);
     }
 
     ~AbstractPluginFX() override
     {
-        delete[] efxoutl;
-        delete[] efxoutr;
+        freeBuffers();
         delete effect;
         delete filterpar;
     }
@@ -105,6 +110,32 @@ protected:
                          zyn::version.get_revision());
     }
 
+   /* --------------------------------------------------------------------------------------------------------
+    * Init */
+
+   /**
+      Initialize the effect parameter @a index, all but the last parameter.
+    */
+    virtual void initEffectParameter(uint32_t index, Parameter& parameter) noexcept = 0;
+
+   /**
+      Initialize the parameter @a index.
+      The last parameter reports the CPU load of the plugin to the host.
+    */
+    void initParameter(uint32_t index, Parameter& parameter) noexcept override
+    {
+        if (index != paramCount)
+            return initEffectParameter(index, parameter);
+
+        parameter.hints  = kParameterIsOutput;
+        parameter.name   = "CPU Load";
+        parameter.symbol = "cpu";
+        parameter.unit   = "%";
+        parameter.ranges.def = 0.0f;
+        parameter.ranges.min = 0.0f;
+        parameter.ranges.max = 100.0f;
+    }
+
    /* --------------------------------------------------------------------------------------------------------
     * Internal data */
 
@@ -114,6 +145,9 @@ protected:
     */
     float getParameterValue(uint32_t index) const override
     {
+        if (index == paramCount)
+            return cpuLoad;
+
         return static_cast<float>(effect->getpar(static_cast<int>(index+2)));
     }
 
@@ -125,6 +159,9 @@ protected:
     */
     void setParameterValue(uint32_t index, float value) override
     {
+        if (index >= paramCount)
+            return;
+
         // make sure value is in bounds for uchar conversion
         if (value < 0.0f)
             value = 0.0f;
@@ -160,6 +197,10 @@ protected:
     void activate() override
     {
         effect->cleanup();
+
+        // back to the zero-latency path until the host sends an odd block
+        fifo.reset();
+        updateLatency();
     }
 
    /**
@@ -168,21 +209,13 @@ protected:
     */
     void run(const float** inputs, float** outputs, uint32_t frames) override
     {
-        if (outputs[0] != inputs[0])
-            copyWithMultiply(outputs[0], inputs[0], 0.5f, frames);
-        else
-            multiply(outputs[0], 0.5f, frames);
+        const zyn::DenormalGuard denormalGuard;
+        const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
 
-        if (outputs[1] != inputs[1])
-            copyWithMultiply(outputs[1], inputs[1], 0.5f, frames);
-        else
-            multiply(outputs[1], 0.5f, frames);
+        process(inputs, outputs, frames);
 
-        // FIXME: Make Zyn use const floats
-        effect->out(zyn::Stereo<float*>((float*)inputs[0], (float*)inputs[1]));
-
-        addWithMultiply(outputs[0], efxoutl, 0.5f, frames);
-        addWithMultiply(outputs[1], efxoutr, 0.5f, frames);
+        if (frames != 0)
+            updateCpuLoad(std::chrono::steady_clock::now() - start, frames);
     }
 
    /* --------------------------------------------------------------------------------------------------------
@@ -201,12 +234,16 @@ protected:
 
         bufferSize = newBufferSize;
 
-        delete[] efxoutl;
-        delete[] efxoutr;
-        efxoutl = new float[bufferSize];
-        efxoutr = new float[bufferSize];
-        std::memset(efxoutl, 0, sizeof(float)*bufferSize);
-        std::memset(efxoutr, 0, sizeof(float)*bufferSize);
+        const uint32_t newBlockSize = getBlockSize(bufferSize);
+        if (blockSize == newBlockSize)
+            return;
+
+        blockSize = newBlockSize;
+
+        freeBuffers();
+        allocBuffers();
+        fifo.setBlockSize(blockSize);
+        updateLatency();
 
         doReinit(false);
     }
@@ -223,6 +260,7 @@ protected:
         sampleRate = newSampleRate;
 
         doReinit(false);
+        fifo.clear();
     }
 
     // -------------------------------------------------------------------------------------------------------
@@ -231,7 +269,12 @@ private:
     const uint32_t paramCount;
     const uint32_t programCount;
 
+    // largest block the effect is run with, smaller blocks keep the
+    // FIFO latency low for hosts with odd block sizes
+    static const uint32_t kMaxBlockSize = 64;
+
     uint32_t bufferSize;
+    uint32_t blockSize; // frames per effect->out()
     double   sampleRate;
 
     zyn::Effect* effect;
@@ -239,6 +282,13 @@ private:
     float*  efxoutr;
     zyn::FilterParams* filterpar;
 
+    // runs the effect in blocks of blockSize on any host block size
+    BlockFifo fifo;
+    uint32_t  latency; // last one reported to the host
+
+    // smoothed percentage of the realtime budget spent in run()
+    float cpuLoad;
+
     zyn::AllocatorClass allocator;
 
     void doReinit(const bool firstInit)
@@ -254,7 +304,7 @@ private:
             delete effect;
         }
 
-        zyn::EffectParams pars(allocator, false, efxoutl, efxoutr, 0, static_cast<uint>(sampleRate), static_cast<int>(bufferSize), filterpar);
+        zyn::EffectParams pars(allocator, false, efxoutl, efxoutr, 0, static_cast<uint>(sampleRate), static_cast<int>(blockSize), filterpar);
         effect = new ZynFX(pars);
 
         if (firstInit)
@@ -272,22 +322,69 @@ private:
         effect->changepar(1, 64);
     }
 
-    void addWithMultiply(float* dst, const float* src, const float multiplier, const uint32_t frames) noexcept
+    static uint32_t getBlockSize(const uint32_t hostBufferSize) noexcept
     {
-        for (uint32_t i=0; i<frames; ++i)
-            dst[i] += src[i] * multiplier;
+        if (hostBufferSize == 0)
+            return kMaxBlockSize;
+        return hostBufferSize < kMaxBlockSize ? hostBufferSize : kMaxBlockSize;
     }
 
-    void copyWithMultiply(float* dst, const float* src, const float multiplier, const uint32_t frames) noexcept
+    void allocBuffers()
     {
-        for (uint32_t i=0; i<frames; ++i)
-            dst[i] = src[i] * multiplier;
+        efxoutl = new float[blockSize];
+        efxoutr = new float[blockSize];
+        std::memset(efxoutl, 0, sizeof(float)*blockSize);
+        std::memset(efxoutr, 0, sizeof(float)*blockSize);
     }
 
-    void multiply(float* dst, const float multiplier, const uint32_t frames) noexcept
+    void freeBuffers()
     {
-        for (uint32_t i=0; i<frames; ++i)
-            dst[i] *= multiplier;
+        delete[] efxoutl;
+        delete[] efxoutr;
+    }
+
+    void process(const float** inputs, float** outputs, uint32_t frames) noexcept
+    {
+        fifo.process(inputs, outputs, frames,
+                     [this](const float* inl, const float* inr, float* outl, float* outr) {
+                         processBlock(inl, inr, outl, outr);
+                     });
+        updateLatency();
+    }
+
+    // tell the host when the FIFO path is taken or left
+    void updateLatency() noexcept
+    {
+        if (latency == fifo.getLatency())
+            return;
+
+        latency = fifo.getLatency();
+        setLatency(latency);
+    }
+
+    // share of the realtime budget of frames spent in run(), smoothed over
+    // about a quarter second
+    void updateCpuLoad(const std::chrono::steady_clock::duration elapsed, uint32_t frames) noexcept
+    {
+        const double seconds = std::chrono::duration<double>(elapsed).count();
+        const double budget  = frames / sampleRate;
+        const double load    = seconds / budget * 100.0;
+        const double coeff   = budget < 0.25 ? budget / 0.25 : 1.0;
+
+        cpuLoad += static_cast<float>((load - cpuLoad) * coeff);
+    }
+
+    // one block of blockSize frames, in and out may be the same buffers
+    void processBlock(const float* inl, const float* inr, float* outl, float* outr) noexcept
+    {
+        // FIXME: Make Zyn use const floats
+        effect->out(zyn::Stereo<float*>((float*)inl, (float*)inr));
+
+        for (uint32_t i=0; i<blockSize; ++i)
+        {
+            outl[i] = (inl[i] + efxoutl[i]) * 0.5f;
+            outr[i] = (inr[i] + efxoutr[i]) * 0.5f;
+        }
     }
 
     DISTRHO_DECLARE_NON_COPY_CLASS(AbstractPluginFX)
@@ -0,0 +1,156 @@
+/*
+  ZynAddSubFX - a software synthesizer
+
+  BlockFifo.hpp - Fixed size effect blocks on any host block size
+
+  This program is free software; you can redistribute it and/or
+  modify it under the terms of the GNU General Public License
+  as published by the Free Software Foundation; either version 2
+  of the License, or (at your option) any later version.
+*/
+
+#ifndef ZYNADDSUBFX_BLOCKFIFO_HPP_INCLUDED
+#define ZYNADDSUBFX_BLOCKFIFO_HPP_INCLUDED
+
+#include <cstdint>
+#include <cstring>
+
+/* ------------------------------------------------------------------------------------------------------------
+ * Host blocks to effect blocks */
+
+/**
+   Runs a process of a fixed block size on the blocks a host passes to run().
+   While the host sends multiples of the block size, the blocks are processed in place without latency.
+   From the first host block which is no multiple, a FIFO delays everything by one block, until reset().
+   Independent of DPF, see AbstractPluginFX.
+*/
+class BlockFifo
+{
+public:
+    explicit BlockFifo(const uint32_t blockSize)
+        : size(0),
+          fifoMode(false),
+          fifoPos(0),
+          fifoInl(nullptr),
+          fifoInr(nullptr),
+          fifoOutl(nullptr),
+          fifoOutr(nullptr)
+    {
+        setBlockSize(blockSize);
+    }
+
+    ~BlockFifo()
+    {
+        freeBuffers();
+    }
+
+    uint32_t getBlockSize() const noexcept
+    {
+        return size;
+    }
+
+   /**
+      Frames by which the output is behind the input, 0 or the block size.
+    */
+    uint32_t getLatency() const noexcept
+    {
+        return fifoMode ? size : 0;
+    }
+
+   /**
+      Change the block size, not realtime safe.
+      Starts over on the zero-latency path.
+    */
+    void setBlockSize(const uint32_t blockSize)
+    {
+        freeBuffers();
+        size     = blockSize;
+        fifoInl  = new float[size];
+        fifoInr  = new float[size];
+        fifoOutl = new float[size];
+        fifoOutr = new float[size];
+        reset();
+    }
+
+   /**
+      Go back to the zero-latency path until the host sends an odd block.
+    */
+    void reset() noexcept
+    {
+        fifoMode = false;
+        clear();
+    }
+
+   /**
+      Drop the frames in the FIFO, staying on the current path.
+    */
+    void clear() noexcept
+    {
+        std::memset(fifoInl, 0, sizeof(float)*size);
+        std::memset(fifoInr, 0, sizeof(float)*size);
+        std::memset(fifoOutl, 0, sizeof(float)*size);
+        std::memset(fifoOutr, 0, sizeof(float)*size);
+        fifoPos = 0;
+    }
+
+   /**
+      Process one host block of stereo frames.
+      @param block called as block(inl, inr, outl, outr) for each block of getBlockSize() frames,
+                   in and out may be the same buffers
+    */
+    template<class Block>
+    void process(const float** inputs, float** outputs, const uint32_t frames, Block block) noexcept
+    {
+        if (! fifoMode && frames % size != 0)
+            fifoMode = true;
+
+        if (! fifoMode)
+        {
+            for (uint32_t off = 0; off < frames; off += size)
+                block(inputs[0] + off, inputs[1] + off,
+                      outputs[0] + off, outputs[1] + off);
+            return;
+        }
+
+        for (uint32_t i = 0; i < frames; ++i)
+        {
+            const float inl = inputs[0][i];
+            const float inr = inputs[1][i];
+            outputs[0][i] = fifoOutl[fifoPos];
+            outputs[1][i] = fifoOutr[fifoPos];
+            fifoInl[fifoPos] = inl;
+            fifoInr[fifoPos] = inr;
+
+            if (++fifoPos == size)
+            {
+                block(fifoInl, fifoInr, fifoOutl, fifoOutr);
+                fifoPos = 0;
+            }
+        }
+    }
+
+private:
+    uint32_t size; // frames per block
+
+    // one block of input and output while the host block size is no
+    // multiple of size
+    bool     fifoMode;
+    uint32_t fifoPos;
+    float*   fifoInl;
+    float*   fifoInr;
+    float*   fifoOutl;
+    float*   fifoOutr;
+
+    void freeBuffers()
+    {
+        delete[] fifoInl;
+        delete[] fifoInr;
+        delete[] fifoOutl;
+        delete[] fifoOutr;
+    }
+
+    BlockFifo(const BlockFifo&) = delete;
+    BlockFifo& operator=(const BlockFifo&) = delete;
+};
+
+#endif // ZYNADDSUBFX_BLOCKFIFO_HPP_INCLUDED
@@ -23,6 +23,7 @@
 #define DISTRHO_PLUGIN_IS_SYNTH      0
 #define DISTRHO_PLUGIN_NUM_INPUTS    2
 #define DISTRHO_PLUGIN_NUM_OUTPUTS   2
+#define DISTRHO_PLUGIN_WANT_LATENCY  1
 #define DISTRHO_PLUGIN_WANT_PROGRAMS 1
 #define DISTRHO_PLUGIN_LV2_CATEGORY  "lv2:DistortionPlugin"
 
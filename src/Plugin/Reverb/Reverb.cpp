@@ -61,10 +61,10 @@ protected:
     * Init */
 
    /**
-      Initialize the parameter @a index.
+      Initialize the effect parameter @a index.
       This function will be called once, shortly after the plugin is created.
     */
-    void initParameter(uint32_t index, Parameter& parameter) noexcept override
+    void initEffectParameter(uint32_t index, Parameter& parameter) noexcept override
     {
         parameter.hints = kParameterIsInteger;
         parameter.unit  = "";
@@ -118,6 +118,7 @@ public:
     {
         synth.buffersize = static_cast<int>(getBufferSize());
         synth.samplerate = static_cast<uint>(getSampleRate());
+        synth.controlperiod = CONTROL_PERIOD; // same modulation at any host buffer size
 
         if (synth.buffersize > 32)
             synth.buffersize = 32;
@@ -621,5 +622,6 @@ namespace Nio {
    void waveStop(){}
    void setAudioCompressor(bool){}
    bool getAudioCompressor(void){return false;}
+   unsigned getLatency(void){return 0;}
 }
 }
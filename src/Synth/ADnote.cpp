@@ -21,6 +21,7 @@
 #include "../globals.h"
 #include "../Misc/Util.h"
 #include "../Misc/Allocator.h"
+#include "../Misc/Denormal.h"
 #include "../Params/ADnoteParameters.h"
 #include "../Containers/ScratchString.h"
 #include "../Containers/NotePool.h"
@@ -503,7 +504,7 @@ SynthNote *ADnote::cloneLegato(void)
 {
     SynthParams sp{memory, ctl, synth, time, velocity,
                 portamento, legato.param.note_log2_freq, true,
-                initial_seed };
+                initial_seed, modbank };
     return memory.alloc<ADnote>(&pars, sp);
 }
 
@@ -811,7 +812,7 @@ void ADnote::initparameters(WatchManager *wm, const char *prefix)
     NoteGlobalPar.initparameters(pars.GlobalPar, synth,
                                  time,
                                  memory, basefreq, velocity,
-                                 stereo, wm, prefix);
+                                 stereo, wm, modbank, prefix);
 
     NoteGlobalPar.AmpEnvelope->envout_dB(); //discard the first envelope output
     globalnewamplitude = NoteGlobalPar.Volume
@@ -849,27 +850,27 @@ void ADnote::initparameters(WatchManager *wm, const char *prefix)
         vce.newamplitude = 1.0f;
         if(param.PAmpEnvelopeEnabled) {
             vce.AmpEnvelope = memory.alloc<Envelope>(*param.AmpEnvelope,
-                    basefreq, synth.dt(), wm,
-                    (pre+"VoicePar"+nvoice+"/AmpEnvelope/").c_str);
+                    basefreq, synth, wm,
+                    (pre+"VoicePar"+nvoice+"/AmpEnvelope/").c_str, modbank);
             vce.AmpEnvelope->envout_dB(); //discard the first envelope sample
             vce.newamplitude *= vce.AmpEnvelope->envout_dB();
         }
 
         if(param.PAmpLfoEnabled) {
             vce.AmpLfo = memory.alloc<LFO>(*param.AmpLfo, basefreq, time, wm,
-                    (pre+"VoicePar"+nvoice+"/AmpLfo/").c_str);
+                    (pre+"VoicePar"+nvoice+"/AmpLfo/").c_str, modbank);
             vce.newamplitude *= vce.AmpLfo->amplfoout();
         }
 
         /* Voice Frequency Parameters Init */
         if(param.PFreqEnvelopeEnabled)
             vce.FreqEnvelope = memory.alloc<Envelope>(*param.FreqEnvelope,
-                    basefreq, synth.dt(), wm,
-                    (pre+"VoicePar"+nvoice+"/FreqEnvelope/").c_str);
+                    basefreq, synth, wm,
+                    (pre+"VoicePar"+nvoice+"/FreqEnvelope/").c_str, modbank);
 
         if(param.PFreqLfoEnabled)
             vce.FreqLfo = memory.alloc<LFO>(*param.FreqLfo, basefreq, time, wm,
-                    (pre+"VoicePar"+nvoice+"/FreqLfo/").c_str);
+                    (pre+"VoicePar"+nvoice+"/FreqLfo/").c_str, modbank);
 
         /* Voice Filter Parameters Init */
         if(param.PFilterEnabled) {
@@ -882,14 +883,14 @@ void ADnote::initparameters(WatchManager *wm, const char *prefix)
             if(param.PFilterEnvelopeEnabled) {
                 vce.FilterEnvelope =
                     memory.alloc<Envelope>(*param.FilterEnvelope,
-                            basefreq, synth.dt(), wm,
-                            (pre+"VoicePar"+nvoice+"/FilterEnvelope/").c_str);
+                            basefreq, synth, wm,
+                            (pre+"VoicePar"+nvoice+"/FilterEnvelope/").c_str, modbank);
                 vce.Filter->addMod(*vce.FilterEnvelope);
             }
 
             if(param.PFilterLfoEnabled) {
                 vce.FilterLfo = memory.alloc<LFO>(*param.FilterLfo, basefreq, time, wm,
-                        (pre+"VoicePar"+nvoice+"/FilterLfo/").c_str);
+                        (pre+"VoicePar"+nvoice+"/FilterLfo/").c_str, modbank);
                 vce.Filter->addMod(*vce.FilterLfo);
             }
         }
@@ -934,16 +935,16 @@ void ADnote::initparameters(WatchManager *wm, const char *prefix)
 
         if(param.PFMFreqEnvelopeEnabled)
             vce.FMFreqEnvelope = memory.alloc<Envelope>(*param.FMFreqEnvelope,
-                    basefreq, synth.dt(), wm,
-                    (pre+"VoicePar"+nvoice+"/FMFreqEnvelope/").c_str);
+                    basefreq, synth, wm,
+                    (pre+"VoicePar"+nvoice+"/FMFreqEnvelope/").c_str, modbank);
 
         vce.FMnewamplitude = vce.FMVolume * ctl.fmamp.relamp;
 
         if(param.PFMAmpEnvelopeEnabled) {
             vce.FMAmpEnvelope =
                 memory.alloc<Envelope>(*param.FMAmpEnvelope,
-                        basefreq, synth.dt(), wm,
-                        (pre+"VoicePar"+nvoice+"/FMAmpEnvelope/").c_str);
+                        basefreq, synth, wm,
+                        (pre+"VoicePar"+nvoice+"/FMAmpEnvelope/").c_str, modbank);
             vce.FMnewamplitude *= vce.FMAmpEnvelope->envout_dB();
         }
     }
@@ -1147,7 +1148,8 @@ void ADnote::computecurrentparameters()
             voicefreq = getvoicebasefreq(nvoice, portamentofreqdelta_log2 +
                 (voicepitch + globalpitch) / 12.0f); //Hz frequency
             voicefreq *=
-                powf(ctl.pitchwheel.relfreq, NoteVoicePar[nvoice].BendAdjust); //change the frequency by the controller
+                fast_exp2f(ctl.pitchwheel.relfreq_log2
+                           * NoteVoicePar[nvoice].BendAdjust); //change the frequency by the controller
             setfreq(nvoice, voicefreq + NoteVoicePar[nvoice].OffsetHz);
 
             /***************/
@@ -1639,8 +1641,13 @@ inline void ADnote::ComputeVoiceDC(int nvoice)
  */
 int ADnote::noteout(float *outl, float *outr)
 {
+#if FLUSH_DENORMALS
+    memset(outl, 0, synth.bufferbytes);
+    memset(outr, 0, synth.bufferbytes);
+#else
     memcpy(outl, synth.denormalkillbuf, synth.bufferbytes);
     memcpy(outr, synth.denormalkillbuf, synth.bufferbytes);
+#endif
 
     if(NoteEnabled == OFF)
         return 0;
@@ -2019,18 +2026,19 @@ void ADnote::Global::initparameters(const ADnoteGlobalParam &param,
                                     float basefreq, float velocity,
                                     bool stereo,
                                     WatchManager *wm,
+                                    ModulatorBank *modbank,
                                     const char *prefix)
 {
     ScratchString pre = prefix;
     FreqEnvelope = memory.alloc<Envelope>(*param.FreqEnvelope, basefreq,
-            synth.dt(), wm, (pre+"GlobalPar/FreqEnvelope/").c_str);
+            synth, wm, (pre+"GlobalPar/FreqEnvelope/").c_str, modbank);
     FreqLfo      = memory.alloc<LFO>(*param.FreqLfo, basefreq, time, wm,
-                   (pre+"GlobalPar/FreqLfo/").c_str);
+                   (pre+"GlobalPar/FreqLfo/").c_str, modbank);
 
     AmpEnvelope = memory.alloc<Envelope>(*param.AmpEnvelope, basefreq,
-            synth.dt(), wm, (pre+"GlobalPar/AmpEnvelope/").c_str);
+            synth, wm, (pre+"GlobalPar/AmpEnvelope/").c_str, modbank);
     AmpLfo      = memory.alloc<LFO>(*param.AmpLfo, basefreq, time, wm,
-                   (pre+"GlobalPar/AmpLfo/").c_str);
+                   (pre+"GlobalPar/AmpLfo/").c_str, modbank);
 
     Volume = dB2rap(param.Volume)
              * VelF(velocity, param.PAmpVelocityScaleFunction);     //sensing
@@ -2039,9 +2047,9 @@ void ADnote::Global::initparameters(const ADnoteGlobalParam &param,
             stereo, basefreq);
 
     FilterEnvelope = memory.alloc<Envelope>(*param.FilterEnvelope, basefreq,
-            synth.dt(), wm, (pre+"GlobalPar/FilterEnvelope/").c_str);
+            synth, wm, (pre+"GlobalPar/FilterEnvelope/").c_str, modbank);
     FilterLfo      = memory.alloc<LFO>(*param.FilterLfo, basefreq, time, wm,
-                   (pre+"GlobalPar/FilterLfo/").c_str);
+                   (pre+"GlobalPar/FilterLfo/").c_str, modbank);
 
     Filter->addMod(*FilterEnvelope);
     Filter->addMod(*FilterLfo);
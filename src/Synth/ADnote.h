@@ -134,6 +134,7 @@ class ADnote:public SynthNote
                                 float basefreq, float velocity,
                                 bool stereo,
                                 WatchManager *wm,
+                                ModulatorBank *modbank,
                                 const char *prefix);
             /******************************************
             *     FREQUENCY GLOBAL PARAMETERS        *
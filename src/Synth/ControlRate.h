@@ -0,0 +1,98 @@
+/*
+  ZynAddSubFX - a software synthesizer
+
+  ControlRate.h - Fixed rate updates of buffer rate modulators
+
+  This program is free software; you can redistribute it and/or
+  modify it under the terms of the GNU General Public License
+  as published by the Free Software Foundation; either version 2
+  of the License, or (at your option) any later version.
+*/
+
+#ifndef CONTROL_RATE_H
+#define CONTROL_RATE_H
+
+#include <cmath>
+
+namespace zyn {
+
+/**
+ * Schedule of a modulator (Envelope, LFO) which is read once per buffer,
+ * but updated every SYNTH_T::controlperiod samples. The notes render longer
+ * buffers in blocks of about one period (SYNTH_T::notebuffersize()), so a
+ * buffer here is such a block and has at most one update in most setups.
+ *
+ * Each buffer runs the updates up to the start of the next buffer, so an
+ * event between two buffers (e.g. a note off) applies to the same updates
+ * at any buffer size. The output is interpolated between the two updates
+ * around the start of the buffer. With one update per buffer it is just
+ * the update, as before there was a control rate.
+ */
+class ControlRate
+{
+    public:
+        /**@param ticks_ updates per buffer, see SYNTH_T::controlticks()*/
+        ControlRate(float ticks_)
+            :ticks(ticks_), next(0.0f), last(0.0f), prev(0.0f)
+        {}
+
+        /**
+         * Move one buffer ahead
+         * @param update called once per update as float(bool lastOfBuffer)
+         * @returns the output at the start of this buffer
+         */
+        template<class Update>
+        float advance(Update update)
+        {
+            const int n = updates(next, ticks);
+            float first = 0.0f, before = 0.0f, after = 0.0f;
+            for(int k = 0; k < n; ++k) {
+                before = after;
+                after  = update(k + 1 == n);
+                if(k == 0)
+                    first = after;
+            }
+            return step(n, first, before, after);
+        }
+
+        /**
+         * Move one buffer ahead with updates computed elsewhere
+         * @param n number of updates, see updates()
+         * @param first output of the first update
+         * @param before output of the second to last update, if n > 1
+         * @param after output of the last update
+         * @returns the output at the start of this buffer
+         */
+        float step(int n, float first, float before, float after)
+        {
+            float out;
+            if(n) {
+                out  = next > 0.0f ? last + (first - last) * (1.0f - next)
+                                   : first;
+                prev = n > 1 ? before : last;
+                last = after;
+            } else //updated up to here by an earlier buffer
+                out = prev + (last - prev) * (2.0f - next);
+            next += n - ticks;
+            return out;
+        }
+
+        /**Position of the next update, in updates from the next buffer read*/
+        float position(void) const {return next;}
+
+        /**Number of updates in a buffer starting at the given position*/
+        static int updates(float next, float ticks)
+        {
+            const float end = ticks > 1.0f ? ticks : 1.0f;
+            return next < end ? (int)ceilf(end - next) : 0;
+        }
+
+    private:
+        const float ticks; //updates per buffer
+        float next; //position of the next update, in updates from this buffer
+        float last, prev; //outputs of the last two updates
+};
+
+}
+
+#endif
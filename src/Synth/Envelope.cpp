@@ -13,14 +13,20 @@
 
 #include <cmath>
 #include "Envelope.h"
+#include "ModulatorBank.h"
 #include "../Params/EnvelopeParams.h"
 
 namespace zyn {
 
-Envelope::Envelope(EnvelopeParams &pars, float basefreq, float bufferdt,
-        WatchManager *m, const char *watch_prefix)
-    :watchOut(m, watch_prefix, "out")
+Envelope::Envelope(EnvelopeParams &pars, float basefreq, const SYNTH_T &synth,
+        WatchManager *m, const char *watch_prefix, ModulatorBank *bank_)
+    :control(synth.controlticks()),
+     watchOut(m, watch_prefix, "out"),
+     bank(bank_),
+     slot(bank_ ? bank_->add(this) : -1)
 {
+    const float controldt = synth.controldt();
+
     envpoints = pars.Penvpoints;
     if(envpoints > MAX_ENVELOPE_POINTS)
         envpoints = MAX_ENVELOPE_POINTS;
@@ -43,8 +49,8 @@ Envelope::Envelope(EnvelopeParams &pars, float basefreq, float bufferdt,
 
     for(int i = 0; i < MAX_ENVELOPE_POINTS; ++i) {
         const float dtstretched = pars.getdt(i) * envstretch;
-        if(dtstretched > bufferdt)
-            envdt[i] = bufferdt / dtstretched;
+        if(dtstretched > controldt)
+            envdt[i] = controldt / dtstretched;
         else
             envdt[i] = 2.0f;  //any value larger than 1
 
@@ -79,10 +85,14 @@ Envelope::Envelope(EnvelopeParams &pars, float basefreq, float bufferdt,
     envfinish = false;
     inct      = envdt[1];
     envoutval = 0.0f;
+    sync();
 }
 
 Envelope::~Envelope()
-{}
+{
+    if(slot >= 0)
+        bank->remove(this);
+}
 
 
 /*
@@ -95,11 +105,83 @@ void Envelope::releasekey()
     keyreleased = true;
     if(forcedrelease)
         t = 0.0f;
+    sync();
 }
 
 void Envelope::forceFinish(void)
 {
     envfinish = true;
+    sync();
+}
+
+bool Envelope::sustaining(void) const
+{
+    return (currentpoint == envsustain + 1) && !keyreleased;
+}
+
+/*
+ * Pass the current stage to the ModulatorBank, if it can compute it:
+ * a held final or sustained value, or a linear segment
+ */
+void Envelope::sync(void)
+{
+    if(slot < 0)
+        return;
+    if(mode == 2 && currentpoint == 1) //see update_dB()
+        bank->setEnvelopeScalar(slot);
+    else if(envfinish)
+        bank->setEnvelope(slot, envval[envpoints - 1], 0.0f, 0.0f, 0.0f,
+                          control.position());
+    else if(sustaining()) {
+        //unless update() finishes it at zero
+        bool zerorelease = mode == ADSR_lin || mode == ADSR_dB;
+        for(int i = envsustain; i < envpoints; ++i)
+            if(envval[i] != -40.0f)
+                zerorelease = false;
+        if(zerorelease)
+            bank->setEnvelopeScalar(slot);
+        else
+            bank->setEnvelope(slot, envval[envsustain], 0.0f, 0.0f, 0.0f,
+                              control.position());
+    } else if(!(keyreleased && forcedrelease) && inct < 1.0f)
+        bank->setEnvelope(slot, envval[currentpoint - 1],
+                          envval[currentpoint] - envval[currentpoint - 1],
+                          t, inct, control.position());
+    else
+        bank->setEnvelopeScalar(slot);
+}
+
+/*
+ * Take the buffer computed by the ModulatorBank, with the same state and
+ * watch as after the updates of update() or update_dB()
+ */
+bool Envelope::take(float &out, bool doWatch, bool dB)
+{
+    int   n;
+    float first, before, after, tnext;
+    if(slot < 0 || !bank->takeEnvelope(slot, n, first, before, after, tnext))
+        return false;
+    if(n) {
+        envoutval = after;
+        if(envfinish) {
+            if(doWatch)
+                watch(dB ? currentpoint + t : envpoints - 1, after);
+        } else if(sustaining()) {
+            if(doWatch)
+                watch(dB ? currentpoint + t : envsustain, after);
+        } else {
+            t = tnext;
+            if(doWatch)
+                watch(currentpoint + t, after);
+        }
+        if(dB) {
+            first  = EnvelopeParams::env_dB2rap(first);
+            before = EnvelopeParams::env_dB2rap(before);
+            after  = EnvelopeParams::env_dB2rap(after);
+        }
+    }
+    out = control.step(n, first, before, after);
+    return true;
 }
 
 void Envelope::watch(float time, float value)
@@ -135,8 +217,39 @@ void Envelope::watch(float time, float value)
 
 /*
  * Envelope Output
+ *
+ * Each call moves one buffer ahead, the envelope itself is updated at the
+ * control rate (see ControlRate), either here or together with the other
+ * envelopes of the part in a ModulatorBank. Only the last update of a
+ * buffer is watched.
  */
 float Envelope::envout(bool doWatch)
+{
+    float out;
+    if(take(out, doWatch, false))
+        return out;
+    out = control.advance([this, doWatch](bool last) {
+            return update(doWatch && last);
+        });
+    sync();
+    return out;
+}
+
+float Envelope::envout_dB()
+{
+    if(linearenvelope)
+        return envout(true);
+    float out;
+    if(take(out, true, true))
+        return out;
+    out = control.advance([this](bool last) {
+            return update_dB(last);
+        });
+    sync();
+    return out;
+}
+
+float Envelope::update(bool doWatch)
 {
     float out;
     if(envfinish) { //if the envelope is finished
@@ -223,12 +336,9 @@ float Envelope::envout(bool doWatch)
 /*
  * Envelope Output (dB)
  */
-float Envelope::envout_dB()
+float Envelope::update_dB(bool doWatch)
 {
     float out;
-    if(linearenvelope)
-        return envout(true);
-
     if((currentpoint == 1) && (!keyreleased || !forcedrelease)) { //first point is always lineary interpolated <- seems to have odd effects
         float v1 = EnvelopeParams::env_dB2rap(envval[0]);
         float v2 = EnvelopeParams::env_dB2rap(envval[1]);
@@ -249,9 +359,10 @@ float Envelope::envout_dB()
             envoutval = MIN_ENVELOPE_DB;
         out = envoutval;
     } else
-        out = envout(false);
+        out = update(false);
 
-    watch(currentpoint + t, out);
+    if(doWatch)
+        watch(currentpoint + t, out);
     return EnvelopeParams::env_dB2rap(out);
 
 }
@@ -16,6 +16,7 @@
 
 #include "../globals.h"
 #include "WatchPoint.h"
+#include "ControlRate.h"
 
 namespace zyn {
 
@@ -23,14 +24,17 @@ namespace zyn {
 class Envelope
 {
     public:
-        /**Constructor*/
-        Envelope(class EnvelopeParams &pars, float basefreq, float dt, WatchManager *m=0,
-                const char *watch_prefix=0);
+        /**Constructor
+         * @param bank_ bank to update the envelope in, if any*/
+        Envelope(class EnvelopeParams &pars, float basefreq,
+                const SYNTH_T &synth, WatchManager *m=0,
+                const char *watch_prefix=0, ModulatorBank *bank_=0);
         /**Destructor*/
         ~Envelope(void);
         void releasekey(void);
         /**Push Envelope to finishing state*/
         void forceFinish(void);
+        /**Output at the start of the next buffer*/
         float envout(bool doWatch=true);
         float envout_dB(void);
         /**Determines the status of the Envelope
@@ -39,6 +43,14 @@ class Envelope
         void watch(float time, float value);
 
     private:
+        friend class ModulatorBank;
+
+        float update(bool doWatch);
+        float update_dB(bool doWatch);
+        bool sustaining(void) const;
+        void sync(void);
+        bool take(float &out, bool doWatch, bool dB);
+
         int   envpoints;
         int   envsustain;    //"-1" means disabled
         float envdt[MAX_ENVELOPE_POINTS]; //seconds
@@ -55,8 +67,12 @@ class Envelope
         float t; // the time from the last point
         float inct; // the time increment
         float envoutval; //used to do the forced release
+        ControlRate control;
 
         VecWatchPoint watchOut;
+
+        ModulatorBank *bank;
+        int slot; //in bank, -1 if the envelope is updated alone
 };
 
 }
@@ -12,6 +12,7 @@
 */
 
 #include "LFO.h"
+#include "ModulatorBank.h"
 #include "../Params/LFOParams.h"
 #include "../Misc/Util.h"
 
@@ -22,15 +23,18 @@
 namespace zyn {
 
 LFO::LFO(const LFOParams &lfopars_, float basefreq_, const AbsTime &t, WatchManager *m,
-        const char *watch_prefix)
+        const char *watch_prefix, ModulatorBank *bank_)
     :first_half(-1),
     time(t),
     delayTime(t, lfopars_.delay), //0..4 sec
     deterministic(!lfopars_.Pfreqrand),
-    dt(t.dt()),
+    dt(t.controldt()),
+    control(t.controlticks()),
     lfopars(lfopars_), 
     basefreq(basefreq_),
-    watchOut(m, watch_prefix, "out")
+    watchOut(m, watch_prefix, "out"),
+    bank(bank_),
+    slot(bank_ ? bank_->add(this) : -1)
 {
     updatePars();
     
@@ -41,7 +45,9 @@ LFO::LFO(const LFOParams &lfopars_, float basefreq_, const AbsTime &t, WatchMana
             phase = 0.0f;
     }
     else {
-        phase = fmod((float)t.time() * phaseInc, 1.0f);
+        //all updates of the frames so far
+        phase = fmod((float)t.time() * (t.dt() / t.controldt()) * phaseInc,
+                     1.0f);
     }
 
     lfornd = limit(lfopars.Prandomness / 127.0f, 0.0f, 1.0f);
@@ -73,10 +79,33 @@ LFO::LFO(const LFOParams &lfopars_, float basefreq_, const AbsTime &t, WatchMana
     computeNextFreqRnd(); //twice because I want incrnd & nextincrnd to be random
     z1 = 0.0;
     z2 = 0.0;
+    sync();
 }
 
 LFO::~LFO()
-{}
+{
+    if(slot >= 0)
+        bank->remove(this);
+}
+
+/*
+ * Pass the current stage to the ModulatorBank, if it can compute it
+ */
+void LFO::sync(void)
+{
+    if(slot < 0)
+        return;
+    if(lfo_state != running || !deterministic
+       || waveShape == LFO_SQUARE || waveShape == LFO_RANDOM) {
+        bank->setLfoScalar(slot);
+        return;
+    }
+    const bool slope = waveShape == LFO_SINE || waveShape == LFO_TRIANGLE;
+    bank->setLfo(slot, waveShape, phase, phaseInc,
+                 (lfopars.Pstartphase + 63.0f) / 127.0f, lfointensity,
+                 slope ? amp1 : amp2, slope ? amp2 - amp1 : 0.0f,
+                 control.position());
+}
 
 void LFO::updatePars()
 {
@@ -106,14 +135,6 @@ float LFO::baseOut(const char waveShape, const float phase)
 {
     float lfo_out;
     switch(waveShape) {
-        case LFO_TRIANGLE:
-            if(phase >= 0.0f && phase < 0.25f)
-                return 4.0f * phase;
-            else if(phase > 0.25f && phase < 0.75f)
-                return 2 - 4 * phase;
-            else
-                return 4.0f * phase - 4.0f;
-            break;
         case LFO_SQUARE:
             if(phase < 0.5f)
                 lfo_out = -1;
@@ -122,10 +143,6 @@ float LFO::baseOut(const char waveShape, const float phase)
 
             return biquad(lfo_out);
             break;
-        case LFO_RAMPUP:    return (phase - 0.5f) * 2.0f;
-        case LFO_RAMPDOWN:  return (0.5f - phase) * 2.0f;
-        case LFO_EXP_DOWN1: return powf(0.05f, phase) * 2.0f - 1.0f;
-        case LFO_EXP_DOWN2: return powf(0.001f, phase) * 2.0f - 1.0f;
         case LFO_RANDOM:
             if ((phase < 0.5) != first_half) {
                 first_half = phase < 0.5;
@@ -133,6 +150,26 @@ float LFO::baseOut(const char waveShape, const float phase)
             }
             return biquad(last_random);
             break;
+        default:
+            return periodicOut(waveShape, phase);
+    }
+}
+
+float LFO::periodicOut(const char waveShape, const float phase)
+{
+    switch(waveShape) {
+        case LFO_TRIANGLE:
+            if(phase >= 0.0f && phase < 0.25f)
+                return 4.0f * phase;
+            else if(phase > 0.25f && phase < 0.75f)
+                return 2 - 4 * phase;
+            else
+                return 4.0f * phase - 4.0f;
+            break;
+        case LFO_RAMPUP:    return (phase - 0.5f) * 2.0f;
+        case LFO_RAMPDOWN:  return (0.5f - phase) * 2.0f;
+        case LFO_EXP_DOWN1: return powf(0.05f, phase) * 2.0f - 1.0f;
+        case LFO_EXP_DOWN2: return powf(0.001f, phase) * 2.0f - 1.0f;
         default:
             return cosf(phase * 2.0f * PI); //LFO_SINE
     }
@@ -187,9 +224,12 @@ void LFO::releasekey()
     fadeOutDuration = lfopars.fadeout * lfopars.time->framesPerSec();
     // set fadeout state
     lfo_state = lfo_state_type::fadingOut;
+    sync();
 }
 float LFO::lfoout()
 {
+    bool changed = false;
+
     //update internals
     if ( ! lfopars.time || lfopars.last_update_timestamp == lfopars.time->time())
     {
@@ -207,6 +247,7 @@ float LFO::lfoout()
                 lfointensity = powf(2, lfopars.Pintensity / 127.0f * 11.0f) - 1.0f; // [0...2047] cent
                 break;
         }
+        changed = true;
     }
     
     // refresh freq if tempo has changed
@@ -214,7 +255,36 @@ float LFO::lfoout()
         tempo = time.tempo;
         float lfofreq = float(tempo) * float(lfopars.denominator)/(240.0f * float(lfopars.numerator));
         phaseInc = fabsf(lfofreq) * dt;
+        changed = true;
+    }
+
+    // the ModulatorBank computed this buffer with the old parameters
+    int   n;
+    float first, before, after, lastphase;
+    if(slot >= 0 && !changed
+       && bank->takeLfo(slot, n, first, before, after, phase, lastphase)) {
+        if(n && watchOut.is_active()) {
+            const float p = fmod(lastphase + (lfopars.Pstartphase + 63.0f) / 127.0f, 1.0f);
+            float watch_data[2] = {p, periodicOut(waveShape, p)};
+            if(waveShape == LFO_SINE || waveShape == LFO_TRIANGLE)
+                watch_data[1] *= lfointensity * (amp1 + p * (amp2 - amp1));
+            else
+                watch_data[1] *= lfointensity * amp2;
+            watchOut(watch_data, 2);
+        }
+        return control.step(n, first, before, after);
     }
+
+    // the oscillator itself runs at the control rate, see ControlRate
+    const float out = control.advance([this](bool last) {
+            return update(last);
+        });
+    sync();
+    return out;
+}
+
+float LFO::update(bool doWatch)
+{
     float phaseWithStartphase = fmod(phase + (lfopars.Pstartphase + 63.0f) / 127.0f, 1.0f);
     float out = baseOut(waveShape, phaseWithStartphase);
     if(waveShape == LFO_SINE || waveShape == LFO_TRIANGLE)
@@ -289,8 +359,10 @@ float LFO::lfoout()
         computeNextFreqRnd();
     }
             
-    float watch_data[2] = {phaseWithStartphase, out};
-    watchOut(watch_data, 2);
+    if(doWatch) {
+        float watch_data[2] = {phaseWithStartphase, out};
+        watchOut(watch_data, 2);
+    }
 
     return out;
 }
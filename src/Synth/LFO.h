@@ -17,6 +17,7 @@
 #include "../globals.h"
 #include "../Misc/Time.h"
 #include "WatchPoint.h"
+#include "ControlRate.h"
 
 
 
@@ -30,15 +31,26 @@ class LFO
          *
          * @param lfopars pointer to a LFOParams object
          * @param basefreq base frequency of LFO
+         * @param bank_ bank to update the LFO in, if any
          */
         LFO(const LFOParams &lfopars_, float basefreq_, const AbsTime &t, WatchManager *m=0,
-                const char *watch_prefix=0);
+                const char *watch_prefix=0, ModulatorBank *bank_=0);
         ~LFO();
 
+        /**Output at the start of the next buffer*/
         float lfoout();
         float amplfoout();
         void releasekey();
+
+        /**Output of the shapes which do not depend on earlier outputs,
+         * before the intensity is applied*/
+        static float periodicOut(const char waveShape, const float phase);
     private:
+        friend class ModulatorBank;
+
+        float update(bool doWatch);
+        void sync(void);
+
         typedef enum lfo_state_type{
             delaying, 
             fadingIn,
@@ -94,7 +106,8 @@ class LFO
         //If After initialization there are no calls to random number gen.
         bool  deterministic;
 
-        const float     dt;
+        const float     dt; //time between two updates
+        ControlRate     control;
         const LFOParams &lfopars;
         const float basefreq;
 
@@ -111,6 +124,9 @@ class LFO
 
         VecWatchPoint watchOut;
 
+        ModulatorBank *bank;
+        int slot; //in bank, -1 if the LFO is updated alone
+
         void computeNextFreqRnd(void);
 };
 
@@ -0,0 +1,288 @@
+/*
+  ZynAddSubFX - a software synthesizer
+
+  ModulatorBank.cpp - Batched updates of the envelopes and LFOs of a Part
+
+  This program is free software; you can redistribute it and/or
+  modify it under the terms of the GNU General Public License
+  as published by the Free Software Foundation; either version 2
+  of the License, or (at your option) any later version.
+*/
+
+#include <cmath>
+#include <cstring>
+#include "ModulatorBank.h"
+#include "ControlRate.h"
+#include "Envelope.h"
+#include "LFO.h"
+#include "../Misc/Allocator.h"
+#include "../Params/LFOParams.h"
+
+namespace zyn {
+
+#define MODBANK_MIN_SIZE 64 //slots of a table when it is first used
+
+ModulatorBank::ModulatorBank(const SYNTH_T &synth, Allocator &memory_)
+    :memory(memory_), ticks(synth.controlticks())
+{
+    memset(&env, 0, sizeof(env));
+    memset(&lfo, 0, sizeof(lfo));
+}
+
+ModulatorBank::~ModulatorBank(void)
+{
+    //the owner array is the start of the memory of a table
+    memory.dealloc_mem(env.owner);
+    memory.dealloc_mem(lfo.owner);
+}
+
+//sums up the memory of the arrays of a table
+struct TableSize {
+    int    size;
+    size_t bytes;
+    template<class T>
+    void operator()(T *&) {bytes += size * sizeof(T);}
+};
+
+//places the arrays of a table one after the other, with their used slots
+struct TableMove {
+    int   size, n;
+    char *pos;
+    template<class T>
+    void operator()(T *&arr)
+    {
+        if(n)
+            memcpy(pos, arr, n * sizeof(T));
+        arr  = (T *)pos;
+        pos += size * sizeof(T);
+    }
+};
+
+//copies a slot of all arrays of a table
+struct SlotMove {
+    int from, to;
+    template<class T>
+    void operator()(T *&arr) {arr[to] = arr[from];}
+};
+
+//all arrays of a table are in one block, which is replaced by a larger one
+template<class Table>
+bool ModulatorBank::grow(Table &table)
+{
+    const int size = table.size ? 2 * table.size : MODBANK_MIN_SIZE;
+    TableSize measure = {size, 0};
+    table.arrays(measure);
+    void *mem = memory.alloc_mem(measure.bytes);
+    if(mem == NULL)
+        return false;
+
+    void     *old  = table.owner;
+    TableMove move = {size, table.n, (char *)mem};
+    table.arrays(move);
+    memory.dealloc_mem(old);
+    table.size = size;
+    return true;
+}
+
+int ModulatorBank::add(Envelope *e)
+{
+    if(env.n == env.size && !grow(env))
+        return -1;
+    const int slot = env.n++;
+    env.owner[slot] = e;
+    setEnvelopeScalar(slot);
+    return slot;
+}
+
+int ModulatorBank::add(LFO *l)
+{
+    if(lfo.n == lfo.size && !grow(lfo))
+        return -1;
+    const int slot = lfo.n++;
+    lfo.owner[slot] = l;
+    setLfoScalar(slot);
+    return slot;
+}
+
+//the last slot moves into the free one, including the results of tick()
+void ModulatorBank::remove(Envelope *e)
+{
+    const int slot = e->slot;
+    const int last = --env.n;
+    if(slot != last) {
+        SlotMove move = {last, slot};
+        env.arrays(move);
+        env.owner[slot]->slot = slot;
+    }
+}
+
+void ModulatorBank::remove(LFO *l)
+{
+    const int slot = l->slot;
+    const int last = --lfo.n;
+    if(slot != last) {
+        SlotMove move = {last, slot};
+        lfo.arrays(move);
+        lfo.owner[slot]->slot = slot;
+    }
+}
+
+void ModulatorBank::setEnvelope(int slot, float v0, float dv, float t,
+                                float inct, float next)
+{
+    env.v0[slot]    = v0;
+    env.dv[slot]    = dv;
+    env.t[slot]     = t;
+    env.inct[slot]  = inct;
+    env.next[slot]  = next;
+    env.ready[slot] = 0;
+}
+
+void ModulatorBank::setLfo(int slot, char shape, float phase, float inc,
+                           float startphase, float intensity, float a1,
+                           float da, float next)
+{
+    lfo.shape[slot]      = shape;
+    lfo.phase[slot]      = phase;
+    lfo.inc[slot]        = inc;
+    lfo.startphase[slot] = startphase;
+    lfo.intensity[slot]  = intensity;
+    lfo.a1[slot]         = a1;
+    lfo.da[slot]         = da;
+    lfo.next[slot]       = next;
+    lfo.ready[slot]      = 0;
+}
+
+//a step of 2 ends the stage within the first update, so tick() never
+//computes these slots
+void ModulatorBank::setEnvelopeScalar(int slot)
+{
+    setEnvelope(slot, 0.0f, 0.0f, 0.0f, 2.0f, 0.0f);
+}
+
+void ModulatorBank::setLfoScalar(int slot)
+{
+    setLfo(slot, LFO_SINE, 0.0f, 2.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f);
+}
+
+bool ModulatorBank::takeEnvelope(int slot, int &n, float &first,
+                                 float &before, float &after, float &t)
+{
+    if(!env.ready[slot])
+        return false;
+    env.ready[slot] = 0;
+    env.t[slot]     = env.tnext[slot];
+    env.next[slot] += env.updates[slot] - ticks;
+    n      = env.updates[slot];
+    first  = env.first[slot];
+    before = env.before[slot];
+    after  = env.after[slot];
+    t      = env.tnext[slot];
+    return true;
+}
+
+bool ModulatorBank::takeLfo(int slot, int &n, float &first, float &before,
+                            float &after, float &phase, float &lastphase)
+{
+    if(!lfo.ready[slot])
+        return false;
+    lfo.ready[slot] = 0;
+    lfo.phase[slot] = lfo.phasenext[slot];
+    lfo.next[slot] += lfo.updates[slot] - ticks;
+    n         = lfo.updates[slot];
+    first     = lfo.first[slot];
+    before    = lfo.before[slot];
+    after     = lfo.after[slot];
+    phase     = lfo.phasenext[slot];
+    lastphase = lfo.lastphase[slot];
+    return true;
+}
+
+/*
+ * The same arithmetic as Envelope::update(), LFO::update() and
+ * ControlRate::advance() with the loops over the modulators innermost, so
+ * the compiler vectorizes them. A stage has to last for all updates of the
+ * buffer to be ready, as t and the phase only grow, it is enough to check
+ * them after the last update. Buffers have more than one update only with
+ * more than one tick per buffer.
+ */
+void ModulatorBank::tick(void)
+{
+    int maxupdates = 0;
+
+    const int ne = env.n;
+    for(int i = 0; i < ne; ++i) {
+        const int n = ControlRate::updates(env.next[i], ticks);
+        env.updates[i] = n;
+        env.first[i]   = env.v0[i] + env.dv[i] * env.t[i];
+        env.before[i]  = env.first[i];
+        env.after[i]   = env.first[i];
+        env.tnext[i]   = n ? env.t[i] + env.inct[i] : env.t[i];
+        maxupdates     = n > maxupdates ? n : maxupdates;
+    }
+    for(int k = 1; k < maxupdates; ++k)
+        for(int i = 0; i < ne; ++i)
+            if(k < env.updates[i]) {
+                env.before[i] = env.after[i];
+                env.after[i]  = env.v0[i] + env.dv[i] * env.tnext[i];
+                env.tnext[i] += env.inct[i];
+            }
+    for(int i = 0; i < ne; ++i)
+        env.ready[i] = env.tnext[i] < 1.0f;
+
+    //the phases of the first, the second to last and the last update are
+    //kept in first, before and lastphase until the outputs are computed
+    const int nl = lfo.n;
+    maxupdates = 0;
+    for(int i = 0; i < nl; ++i) {
+        const int n = ControlRate::updates(lfo.next[i], ticks);
+        lfo.updates[i]   = n;
+        lfo.first[i]     = lfo.phase[i];
+        lfo.before[i]    = lfo.phase[i];
+        lfo.lastphase[i] = lfo.phase[i];
+        lfo.phasenext[i] = n ? lfo.phase[i] + lfo.inc[i] : lfo.phase[i];
+        maxupdates       = n > maxupdates ? n : maxupdates;
+    }
+    for(int k = 1; k < maxupdates; ++k)
+        for(int i = 0; i < nl; ++i)
+            if(k < lfo.updates[i]) {
+                lfo.before[i]     = lfo.lastphase[i];
+                lfo.lastphase[i]  = lfo.phasenext[i];
+                lfo.phasenext[i] += lfo.inc[i];
+            }
+    for(int i = 0; i < nl; ++i)
+        lfo.ready[i] = lfo.phasenext[i] < 1.0f;
+
+    //the outputs of the ready LFOs, one shape after the other
+    static const char shapes[] = {LFO_SINE, LFO_TRIANGLE, LFO_RAMPUP,
+                                  LFO_RAMPDOWN, LFO_EXP_DOWN1, LFO_EXP_DOWN2};
+    int *index = lfo.index;
+    for(char shape:shapes) {
+        int m = 0;
+        for(int i = 0; i < nl; ++i)
+            if(lfo.ready[i] && lfo.shape[i] == shape)
+                index[m++] = i;
+        for(int j = 0; j < m; ++j) {
+            const int   i = index[j];
+            const float p = fmod(lfo.first[i] + lfo.startphase[i], 1.0f);
+            lfo.first[i]  = LFO::periodicOut(shape, p)
+                            * (lfo.intensity[i] * (lfo.a1[i] + p * lfo.da[i]));
+            lfo.after[i]  = lfo.first[i];
+        }
+        if(maxupdates < 2)
+            continue;
+        for(int j = 0; j < m; ++j) {
+            const int i = index[j];
+            if(lfo.updates[i] < 2)
+                continue;
+            const float p = fmod(lfo.lastphase[i] + lfo.startphase[i], 1.0f);
+            const float q = fmod(lfo.before[i] + lfo.startphase[i], 1.0f);
+            lfo.after[i]  = LFO::periodicOut(shape, p)
+                            * (lfo.intensity[i] * (lfo.a1[i] + p * lfo.da[i]));
+            lfo.before[i] = LFO::periodicOut(shape, q)
+                            * (lfo.intensity[i] * (lfo.a1[i] + q * lfo.da[i]));
+        }
+    }
+}
+
+}
@@ -0,0 +1,142 @@
+/*
+  ZynAddSubFX - a software synthesizer
+
+  ModulatorBank.h - Batched updates of the envelopes and LFOs of a Part
+
+  This program is free software; you can redistribute it and/or
+  modify it under the terms of the GNU General Public License
+  as published by the Free Software Foundation; either version 2
+  of the License, or (at your option) any later version.
+*/
+
+#ifndef MODULATOR_BANK_H
+#define MODULATOR_BANK_H
+
+#include "../globals.h"
+
+namespace zyn {
+
+/**
+ * State of the envelopes and LFOs of all notes of a Part, kept in
+ * contiguous arrays and computed one buffer ahead in a single sweep.
+ *
+ * Most of the time a modulator just moves along a linear envelope segment,
+ * holds a sustained or final value, or runs a plain periodic LFO. For these
+ * stages the bank computes the outputs of the control rate updates of the
+ * buffer (see ControlRate) and the state after them for all notes at once,
+ * grouped by the LFO shape, instead of stepping every modulator on its own.
+ *
+ * The result is only a proposal: the envelope or LFO takes it when it is
+ * read (Envelope::envout(), LFO::lfoout()), so modulators which are not read
+ * in a buffer do not advance, just like without the bank. Stages which
+ * cross a segment or a cycle, and all other stages (forced release, the
+ * first dB segment, LFO delay and fades, random shapes) are left to the
+ * scalar update of the modulator.
+ *
+ * The arrays grow with the number of modulators, in the memory of the
+ * notes. When that runs out, the modulators which do not fit are updated on
+ * their own.
+ */
+class ModulatorBank
+{
+    public:
+        ModulatorBank(const SYNTH_T &synth, Allocator &memory);
+        ~ModulatorBank(void);
+
+        /**Compute the next buffer of all modulators, before the notes*/
+        void tick(void);
+
+        /**Modulators which are in the bank*/
+        int envelopes(void) const {return env.n;}
+        int lfos(void) const {return lfo.n;}
+
+    private:
+        friend class Envelope;
+        friend class LFO;
+
+        //called by the modulators, see there
+
+        /**@returns the slot of the modulator, or -1 to update it alone*/
+        int add(Envelope *e);
+        int add(LFO *l);
+        void remove(Envelope *e);
+        void remove(LFO *l);
+
+        /**Set the stage of a modulator after it was updated on its own.
+         * A linear envelope stage is out = v0 + dv * t with t += inct per
+         * update, a held value is v0 with dv = inct = 0. next is the
+         * ControlRate::position() of the modulator.*/
+        void setEnvelope(int slot, float v0, float dv, float t, float inct,
+                         float next);
+        /**An LFO stage is out = base(p) * (intensity * (a1 + p * da)), with
+         * p = fmod(phase + startphase, 1) and phase += inc per update*/
+        void setLfo(int slot, char shape, float phase, float inc,
+                    float startphase, float intensity, float a1, float da,
+                    float next);
+        /**Leave the modulator to its own updates until it is set again*/
+        void setEnvelopeScalar(int slot);
+        void setLfoScalar(int slot);
+
+        /**Take the updates computed by tick(), if any, as passed to
+         * ControlRate::step()
+         * @param t set to the state after the buffer
+         * @returns true if the bank computed this buffer*/
+        bool takeEnvelope(int slot, int &n, float &first, float &before,
+                          float &after, float &t);
+        /**@param lastphase set to the phase of the last update*/
+        bool takeLfo(int slot, int &n, float &first, float &before,
+                     float &after, float &phase, float &lastphase);
+
+        /**Double the size of a table, false if there is no memory*/
+        template<class Table>
+        bool grow(Table &table);
+
+        Allocator  &memory;
+        const float ticks; //updates per buffer
+
+        //slots [0, n) are used out of size, arrays() passes each array to
+        //a functor for moving them around
+        struct {
+            int        n, size;
+            Envelope **owner;
+            float     *v0, *dv, *t, *inct, *next;
+            //results of tick()
+            float     *first, *before, *after, *tnext;
+            int       *updates, *ready;
+
+            template<class F>
+            void arrays(F &f)
+            {
+                f(owner);
+                f(v0); f(dv); f(t); f(inct); f(next);
+                f(first); f(before); f(after); f(tnext);
+                f(updates); f(ready);
+            }
+        } env;
+
+        struct {
+            int    n, size;
+            LFO  **owner;
+            float *phase, *inc, *startphase, *intensity, *a1, *da, *next;
+            //results of tick()
+            float *first, *before, *after, *lastphase, *phasenext;
+            int   *updates, *ready;
+            int   *index; //scratch of tick()
+            char  *shape;
+
+            template<class F>
+            void arrays(F &f)
+            {
+                f(owner);
+                f(phase); f(inc); f(startphase); f(intensity); f(a1); f(da);
+                f(next);
+                f(first); f(before); f(after); f(lastphase); f(phasenext);
+                f(updates); f(ready); f(index);
+                f(shape);
+            }
+        } lfo;
+};
+
+}
+
+#endif
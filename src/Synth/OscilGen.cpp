@@ -70,6 +70,9 @@ const rtosc::Ports OscilGen::non_realtime_ports = {
                 Zigzag, Limiter, Upper Limiter, Lower Limiter,
                 Inverse Limiter, Clip, Asym2, Pow2, sigmoid, Tanh, Cubic, Square),
             "Shape of distortion to be applied"),
+    rOption(Pwaveshapingoversampling, rShort("os"), rDefault(1x),
+            rOptions(1x, 2x, 4x, 8x),
+            "Oversampling of the waveshaping to reduce aliasing"),
     rOption(Pfiltertype, rShort("filter"), rOptions(No Filter,
             lp, hp1, hp1b, bp1, bs1, lp2, hp2, bp2, bs2,
             cos, sin, low_shelf, s, lpsk), rDefaultId(No Filter), "Harmonic Filter"),
@@ -362,7 +365,10 @@ OscilGenBuffers::OscilGenBuffers(zyn::OscilGenBuffersCreator c) :
     cachedbasefunc(ctorAllocSamples(c.fft, c.oscilsize)),
     cachedbasevalid(false),
     basefuncFFTfreqs(ctorAllocFreqs(c.fft, c.oscilsize)),
-    scratchFreqs(ctorAllocFreqs(c.fft, c.oscilsize))
+    scratchFreqs(ctorAllocFreqs(c.fft, c.oscilsize)),
+    bigfft(nullptr),
+    bigfreqs(nullptr),
+    bigsmps(nullptr)
 {
     defaults();
 }
@@ -375,6 +381,9 @@ OscilGenBuffers::~OscilGenBuffers()
     delete[] oscilFFTfreqs.data;
     delete[] cachedbasefunc.data;
     delete[] scratchFreqs.data;
+    delete bigfft;
+    delete[] bigfreqs;
+    delete[] bigsmps;
 }
 
 zyn::OscilGenBuffersCreator OscilGen::createOscilGenBuffers() const
@@ -389,6 +398,7 @@ void OscilGenBuffers::defaults()
     oldhmagtype = 0;
     oldwaveshapingfunction = 0;
     oldwaveshaping = 64;
+    oldwaveshapingoversampling = 0;
     oldbasefuncmodulation     = 0;
     oldharmonicshift          = 0;
     oldbasefuncmodulationpar1 = 0;
@@ -461,6 +471,7 @@ void OscilGen::defaults()
 
     Pwaveshapingfunction = 0;
     Pwaveshaping    = 64;
+    Pwaveshapingoversampling = 0;
     Pfiltertype     = 0;
     Pfilterpar1     = 64;
     Pfilterpar2     = 64;
@@ -660,6 +671,7 @@ void OscilGen::waveshape(OscilGenBuffers& bfrs, FFTfreqBuffer freqs) const
 {
     bfrs.oldwaveshapingfunction = Pwaveshapingfunction;
     bfrs.oldwaveshaping = Pwaveshaping;
+    bfrs.oldwaveshapingoversampling = Pwaveshapingoversampling;
     if(Pwaveshapingfunction == 0)
         return;
 
@@ -669,6 +681,12 @@ void OscilGen::waveshape(OscilGenBuffers& bfrs, FFTfreqBuffer freqs) const
         float gain = i / (synth.oscilsize / 8.0f);
         freqs[synth.oscilsize / 2 - i] *= gain;
     }
+
+    if(Pwaveshapingoversampling != 0) {
+        waveshapeOversampled(bfrs, freqs);
+        return;
+    }
+
     fft->freqs2smps_noconst_input(freqs, bfrs.tmpsmps);
 
     //Normalize
@@ -680,6 +698,48 @@ void OscilGen::waveshape(OscilGenBuffers& bfrs, FFTfreqBuffer freqs) const
     fft->smps2freqs_noconst_input(bfrs.tmpsmps, freqs); //perform FFT
 }
 
+/*
+ * Waveshape a longer, band limited version of the period
+ *
+ * As the oscillator is a single periodic cycle, zero padding the spectrum
+ * gives an exact interpolation. The harmonics the shaper creates above the
+ * original nyquist are then dropped instead of being folded back.
+ */
+void OscilGen::waveshapeOversampled(OscilGenBuffers& bfrs,
+                                    FFTfreqBuffer freqs) const
+{
+    const int factor = 1 << (Pwaveshapingoversampling > 3 ? 3 : Pwaveshapingoversampling);
+    const int half   = synth.oscilsize / 2;
+    const int size   = synth.oscilsize * factor;
+
+    //the plan is only made again when the factor changes
+    if(!bfrs.bigfft || bfrs.bigfft->fftsize() != size) { // XXXRT
+        delete bfrs.bigfft;
+        delete[] bfrs.bigfreqs;
+        delete[] bfrs.bigsmps;
+        bfrs.bigfft   = new FFTwrapper(size);
+        bfrs.bigfreqs = bfrs.bigfft->allocFreqBuf().data;
+        bfrs.bigsmps  = bfrs.bigfft->allocSampleBuf().data;
+    }
+    FFTfreqBuffer   bigfreqs = bfrs.bigfft->allocFreqBuf(bfrs.bigfreqs);
+    FFTsampleBuffer bigsmps  = bfrs.bigfft->allocSampleBuf(bfrs.bigsmps);
+
+    clearAll(bigfreqs.data, size);
+    for(int i = 0; i < half; ++i)
+        bigfreqs[i] = freqs[i];
+    bfrs.bigfft->freqs2smps_noconst_input(bigfreqs, bigsmps);
+
+    normalize(bigsmps.data, size);
+    waveShapeSmps(size, bigsmps.data, Pwaveshapingfunction, Pwaveshaping);
+
+    bfrs.bigfft->smps2freqs_noconst_input(bigsmps, bigfreqs);
+
+    //the unnormalized FFT is factor times louder than one of oscilsize
+    const float scale = 1.0f / factor;
+    for(int i = 0; i < half; ++i)
+        freqs[i] = bigfreqs[i] * scale;
+}
+
 
 /*
  * Do the Frequency Modulation of the Oscil
@@ -1044,7 +1104,8 @@ bool OscilGen::needPrepare(OscilGenBuffers& bfrs) const
 
     //Check function parameters
     if((bfrs.oldbasepar != Pbasefuncpar) || (bfrs.oldbasefunc != Pcurrentbasefunc)
-       || DIFF(hmagtype) || DIFF(waveshaping) || DIFF(waveshapingfunction))
+       || DIFF(hmagtype) || DIFF(waveshaping) || DIFF(waveshapingfunction)
+       || DIFF(waveshapingoversampling))
         outdated = true;
 
     //Check filter parameters
@@ -1088,11 +1149,12 @@ short int OscilGen::get(OscilGenBuffers& bfrs, float* smps, float freqHz, int re
 
     fft_t *input = freqHz > 0.0f ? bfrs.oscilFFTfreqs.data : bfrs.pendingfreqs;
 
-    unsigned int realrnd = prng();
-    sprng(randseed);
+    //the randomness only depends on randseed, it is drawn from a local
+    //generator as get() may run on several threads
+    prng_t rndstate = randseed;
 
     int outpos =
-        (int)((RND * 2.0f
+        (int)((RND_r(rndstate) * 2.0f
                - 1.0f) * synth.oscilsize_f * (Prand - 64.0f) / 64.0f);
     outpos = (outpos + 2 * synth.oscilsize) % synth.oscilsize;
 
@@ -1131,7 +1193,7 @@ short int OscilGen::get(OscilGenBuffers& bfrs, float* smps, float freqHz, int re
         const float rnd = PI * powf((Prand - 64.0f) / 64.0f, 2.0f);
         for(int i = 1; i < nyquist - 1; ++i) //to Nyquist only for AntiAliasing
             bfrs.outoscilFFTfreqs[i] *=
-                FFTpolar<fftwf_real>(1.0f, (float)(rnd * i * RND));
+                FFTpolar<fftwf_real>(1.0f, (float)(rnd * i * RND_r(rndstate)));
     }
 
     //Harmonic Amplitude Randomness
@@ -1144,12 +1206,12 @@ short int OscilGen::get(OscilGenBuffers& bfrs, float* smps, float freqHz, int re
                 power = power * 2.0f - 0.5f;
                 power = powf(15.0f, power);
                 for(int i = 1; i < nyquist - 1; ++i)
-                    bfrs.outoscilFFTfreqs[i] *= powf(RND, power) * normalize;
+                    bfrs.outoscilFFTfreqs[i] *= powf(RND_r(rndstate), power) * normalize;
                 break;
             case 2:
                 power = power * 2.0f - 0.5f;
                 power = powf(15.0f, power) * 2.0f;
-                float rndfreq = 2 * PI * RND;
+                float rndfreq = 2 * PI * RND_r(rndstate);
                 for(int i = 1; i < nyquist - 1; ++i)
                     bfrs.outoscilFFTfreqs[i] *= powf(fabsf(sinf(i * rndfreq)), power)
                                            * normalize;
@@ -1171,8 +1233,6 @@ short int OscilGen::get(OscilGenBuffers& bfrs, float* smps, float freqHz, int re
             smps[i] = bfrs.tmpsmps[i] * 0.25f;            //correct the amplitude
     }
 
-    sprng(realrnd + 1);
-
     if(Prand < 64)
         return outpos;
     else
@@ -1290,6 +1350,7 @@ void OscilGen::paste(OscilGen &o)
 
     COPY(Pwaveshaping);
     COPY(Pwaveshapingfunction);
+    COPY(Pwaveshapingoversampling);
     COPY(Pfiltertype);
     COPY(Pfilterpar1);
     COPY(Pfilterpar2);
@@ -1340,6 +1401,7 @@ void OscilGen::add2XML(XMLwrapper& xml)
 
     xml.addpar("wave_shaping", Pwaveshaping);
     xml.addpar("wave_shaping_function", Pwaveshapingfunction);
+    xml.addpar("wave_shaping_oversampling", Pwaveshapingoversampling);
 
     xml.addpar("filter_type", Pfiltertype);
     xml.addpar("filter_par1", Pfilterpar1);
@@ -1419,6 +1481,8 @@ void OscilGen::getfromXML(XMLwrapper& xml)
     Pwaveshaping = xml.getpar127("wave_shaping", Pwaveshaping);
     Pwaveshapingfunction = xml.getpar127("wave_shaping_function",
                                           Pwaveshapingfunction);
+    Pwaveshapingoversampling = xml.getpar127("wave_shaping_oversampling",
+                                             Pwaveshapingoversampling);
 
     Pfiltertype     = xml.getpar127("filter_type", Pfiltertype);
     Pfilterpar1     = xml.getpar127("filter_par1", Pfilterpar1);
@@ -15,6 +15,7 @@
 #define OSCIL_GEN_H
 
 #include "../globals.h"
+#include "../Misc/Util.h"
 #include <rtosc/ports.h>
 #include "../Params/Presets.h"
 #include "../DSP/FFTwrapper.h"
@@ -67,9 +68,15 @@ private:
     FFTfreqBuffer basefuncFFTfreqs; //Base function frequencies
     FFTfreqBuffer scratchFreqs; //Yet another tmp buffer
 
+    //FFT and buffers of the oversampled waveshaping, created on first use
+    FFTwrapper *bigfft;
+    fft_t *bigfreqs;
+    float *bigsmps;
+
     //Internal Data
     unsigned char oldbasefunc, oldbasepar, oldhmagtype,
-                  oldwaveshapingfunction, oldwaveshaping;
+                  oldwaveshapingfunction, oldwaveshaping,
+                  oldwaveshapingoversampling;
     int oldfilterpars, oldsapars, oldbasefuncmodulation,
         oldbasefuncmodulationpar1, oldbasefuncmodulationpar2,
         oldbasefuncmodulationpar3, oldharmonicshift;
@@ -97,9 +104,13 @@ class OscilGen:public Presets, NoCopyNoMove
 
         /**do the antialiasing(cut off higher freqs.),apply randomness and do a IFFT*/
         //returns where should I start getting samples, used in block type randomness
+        //the randomness only depends on randseed, not on the global generator
         short get(OscilGenBuffers& bfrs, float *smps, float freqHz, int resonance = 0) const;
         short get(float *smps, float freqHz, int resonance = 0) {
-            return get(myBuffers(), smps, freqHz, resonance);
+            const short outpos = get(myBuffers(), smps, freqHz, resonance);
+            //the notes step the global generator once per oscillator
+            sprng(prng() + 1);
+            return outpos;
         }
         //if freqHz is smaller than 0, return the "un-randomized" sample for UI
 
@@ -143,6 +154,7 @@ class OscilGen:public Presets, NoCopyNoMove
                       Pbasefuncmodulationpar3; //the parameter of the base function modulation
 
         unsigned char Pwaveshaping, Pwaveshapingfunction;
+        unsigned char Pwaveshapingoversampling; //0=1x, 1=2x, 2=4x, 3=8x
         unsigned char Pfiltertype, Pfilterpar1, Pfilterpar2;
         bool          Pfilterbeforews;
         unsigned char Psatype, Psapar; //spectrum adjust
@@ -198,6 +210,8 @@ class OscilGen:public Presets, NoCopyNoMove
         void changebasefunction(OscilGenBuffers& bfrs) const;
         //Waveshaping
         void waveshape(OscilGenBuffers& bfrs, FFTfreqBuffer freqs) const;
+        void waveshapeOversampled(OscilGenBuffers& bfrs,
+                                  FFTfreqBuffer freqs) const;
 
         //Filter the oscillator accotding to Pfiltertype and Pfilterpar
         void oscilfilter(fft_t *freqs) const;
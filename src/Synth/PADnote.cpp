@@ -10,6 +10,7 @@
   as published by the Free Software Foundation; either version 2
   of the License, or (at your option) any later version.
 */
+#include <algorithm>
 #include <cassert>
 #include <cmath>
 #include "PADnote.h"
@@ -24,6 +25,10 @@
 #include "../Containers/NotePool.h"
 #include "../Misc/Util.h"
 
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
 namespace zyn {
 
 PADnote::PADnote(const PADnoteParameters *parameters,
@@ -91,7 +96,7 @@ void PADnote::setup(float velocity_,
     float mindist = fabsf(log2freq - log2f(pars.sample[0].basefreq + 0.0001f));
     nsample = 0;
     for(int i = 1; i < PAD_MAX_SAMPLES; ++i) {
-        if(pars.sample[i].smp == NULL)
+        if(!pars.sample[i].valid())
             break;
         const float dist = fabsf(log2freq - log2f(pars.sample[i].basefreq + 0.0001f));
 
@@ -145,18 +150,18 @@ void PADnote::setup(float velocity_,
         ScratchString pre = prefix;
 
         NoteGlobalPar.FreqEnvelope =
-            memory.alloc<Envelope>(*pars.FreqEnvelope, basefreq, synth.dt(),
-                    wm, (pre+"FreqEnvelope/").c_str);
+            memory.alloc<Envelope>(*pars.FreqEnvelope, basefreq, synth,
+                    wm, (pre+"FreqEnvelope/").c_str, modbank);
         NoteGlobalPar.FreqLfo      =
             memory.alloc<LFO>(*pars.FreqLfo, basefreq, time,
-                    wm, (pre+"FreqLfo/").c_str);
+                    wm, (pre+"FreqLfo/").c_str, modbank);
 
         NoteGlobalPar.AmpEnvelope =
-            memory.alloc<Envelope>(*pars.AmpEnvelope, basefreq, synth.dt(),
-                    wm, (pre+"AmpEnvelope/").c_str);
+            memory.alloc<Envelope>(*pars.AmpEnvelope, basefreq, synth,
+                    wm, (pre+"AmpEnvelope/").c_str, modbank);
         NoteGlobalPar.AmpLfo      =
             memory.alloc<LFO>(*pars.AmpLfo, basefreq, time,
-                    wm, (pre+"AmpLfo/").c_str);
+                    wm, (pre+"AmpLfo/").c_str, modbank);
     }
 
     NoteGlobalPar.Volume = 4.0f
@@ -181,9 +186,9 @@ void PADnote::setup(float velocity_,
 
         //setup mod
         env = memory.alloc<Envelope>(*pars.FilterEnvelope, basefreq,
-                synth.dt(), wm, (pre+"FilterEnvelope/").c_str);
+                synth, wm, (pre+"FilterEnvelope/").c_str, modbank);
         lfo = memory.alloc<LFO>(*pars.FilterLfo, basefreq, time,
-                wm, (pre+"FilterLfo/").c_str);
+                wm, (pre+"FilterLfo/").c_str, modbank);
         flt->addMod(*env);
         flt->addMod(*lfo);
     }
@@ -195,7 +200,7 @@ void PADnote::setup(float velocity_,
         flt.updateNoteFreq(basefreq);
     }
 
-    if(!pars.sample[nsample].smp) {
+    if(!pars.sample[nsample].valid()) {
         finished_ = true;
         return;
     }
@@ -204,7 +209,8 @@ void PADnote::setup(float velocity_,
 SynthNote *PADnote::cloneLegato(void)
 {
     SynthParams sp{memory, ctl, synth, time, velocity,
-                   portamento, legato.param.note_log2_freq, true, legato.param.seed};
+                   portamento, legato.param.note_log2_freq, true, legato.param.seed,
+                   modbank};
     return memory.alloc<PADnote>(&pars, sp, interpolation);
 }
 
@@ -276,86 +282,263 @@ void PADnote::computecurrentparameters()
 
     realfreq =
         powf(2.0f, note_log2_freq + globalpitch / 12.0f + portamentofreqdelta_log2) *
-        powf(ctl.pitchwheel.relfreq, BendAdjust) + OffsetHz;
+        fast_exp2f(ctl.pitchwheel.relfreq_log2 * BendAdjust) + OffsetHz;
 }
 
 
-int PADnote::Compute_Linear(float *outl,
-                            float *outr,
-                            int freqhi,
-                            float freqlo)
+/*
+ * Interpolation runs in two passes per chunk of output samples: the serial
+ * advance of the read positions, then the kernels, which have no dependency
+ * between output samples and compute several of them at once.
+ *
+ * Compact samples are widened to float while loading them. The kernels are
+ * linear in the samples, so their scale is applied once to the result.
+ */
+#define PAD_CHUNK 64
+
+//windowed sinc: taps per output sample and tabulated phases between samples
+#define PAD_SINC_TAPS   8
+#define PAD_SINC_PHASES 128
+
+/*
+ * Kernel rows of the sinc interpolation, which reads smps[pos..pos+7] and
+ * interpolates between the taps 3 and 4. Each row also holds the difference
+ * to the next phase to interpolate linearly between two phases.
+ */
+struct SincTable {
+    float k[PAD_SINC_PHASES][2][PAD_SINC_TAPS];
+
+    SincTable(void)
+    {
+        float row[PAD_SINC_PHASES + 1][PAD_SINC_TAPS];
+        for(int p = 0; p <= PAD_SINC_PHASES; ++p) {
+            const float frac = (float)p / PAD_SINC_PHASES;
+            float sum = 0.0f;
+            for(int j = 0; j < PAD_SINC_TAPS; ++j) {
+                const float d = j - (PAD_SINC_TAPS / 2 - 1) - frac;
+                const float x = d / (PAD_SINC_TAPS / 2); //-1..1
+                const float win = 0.42f + 0.5f * cosf(PI * x)
+                                  + 0.08f * cosf(2.0f * PI * x);
+                row[p][j] = (fabsf(d) < 1e-6f ? 1.0f : sinf(PI * d) / (PI * d))
+                            * win;
+                sum += row[p][j];
+            }
+            for(int j = 0; j < PAD_SINC_TAPS; ++j)
+                row[p][j] /= sum; //unity gain at DC
+        }
+        for(int p = 0; p < PAD_SINC_PHASES; ++p)
+            for(int j = 0; j < PAD_SINC_TAPS; ++j) {
+                k[p][0][j] = row[p][j];
+                k[p][1][j] = row[p + 1][j] - row[p][j];
+            }
+    }
+};
+
+static const SincTable sinc_table;
+
+#ifdef __AVX2__
+static inline __m256 gather(const float *smps, __m256i pos)
 {
-    const float *smps = pars.sample[nsample].smp;
-    if(smps == NULL) {
-        finished_ = true;
-        return 1;
+    return _mm256_i32gather_ps(smps, pos, 4);
+}
+
+static inline __m256 gather(const short *smps, __m256i pos)
+{
+    //loads 32 bits per position and sign extends the lower half,
+    //the extra samples keep the upper half within the buffer
+    __m256i v = _mm256_i32gather_epi32((const int *)smps, pos, 2);
+    v = _mm256_srai_epi32(_mm256_slli_epi32(v, 16), 16);
+    return _mm256_cvtepi32_ps(v);
+}
+
+static inline __m256 load8(const float *smps)
+{
+    return _mm256_loadu_ps(smps);
+}
+
+static inline __m256 load8(const short *smps)
+{
+    const __m128i v = _mm_loadu_si128((const __m128i *)smps);
+    return _mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(v));
+}
+
+//sums of the elements of each of the 8 vectors
+static inline __m256 hsum8(const __m256 *v)
+{
+    const __m256 s01   = _mm256_hadd_ps(v[0], v[1]);
+    const __m256 s23   = _mm256_hadd_ps(v[2], v[3]);
+    const __m256 s45   = _mm256_hadd_ps(v[4], v[5]);
+    const __m256 s67   = _mm256_hadd_ps(v[6], v[7]);
+    const __m256 s0123 = _mm256_hadd_ps(s01, s23);
+    const __m256 s4567 = _mm256_hadd_ps(s45, s67);
+    return _mm256_add_ps(_mm256_permute2f128_ps(s0123, s4567, 0x20),
+                         _mm256_permute2f128_ps(s0123, s4567, 0x31));
+}
+#endif
+
+template<class T>
+static void linearKernel(const T *smps, const int *pos, const float *frac,
+                         float scale, float *out, int n)
+{
+    int i = 0;
+#ifdef __AVX2__
+    const __m256  vscale = _mm256_set1_ps(scale);
+    const __m256  fone   = _mm256_set1_ps(1.0f);
+    const __m256i one    = _mm256_set1_epi32(1);
+    for(; i + 8 <= n; i += 8) {
+        const __m256i p = _mm256_loadu_si256((const __m256i *)(pos + i));
+        const __m256  f = _mm256_loadu_ps(frac + i);
+        const __m256  a = gather(smps, p);
+        const __m256  b = gather(smps, _mm256_add_epi32(p, one));
+        const __m256  v = _mm256_add_ps(_mm256_mul_ps(a, _mm256_sub_ps(fone, f)),
+                                        _mm256_mul_ps(b, f));
+        _mm256_storeu_ps(out + i, _mm256_mul_ps(v, vscale));
     }
-    int size = pars.sample[nsample].size;
-    for(int i = 0; i < synth.buffersize; ++i) {
-        poshi_l += freqhi;
-        poshi_r += freqhi;
-        poslo   += freqlo;
-        if(poslo >= 1.0f) {
-            poshi_l += 1;
-            poshi_r += 1;
-            poslo   -= 1.0f;
-        }
-        if(poshi_l >= size)
-            poshi_l %= size;
-        if(poshi_r >= size)
-            poshi_r %= size;
+#endif
+    for(; i < n; ++i) {
+        const T *x = smps + pos[i];
+        out[i] = ((float)x[0] * (1.0f - frac[i]) + (float)x[1] * frac[i])
+                 * scale;
+    }
+}
 
-        outl[i] = smps[poshi_l] * (1.0f - poslo) + smps[poshi_l + 1] * poslo;
-        outr[i] = smps[poshi_r] * (1.0f - poslo) + smps[poshi_r + 1] * poslo;
+template<class T>
+static void cubicKernel(const T *smps, const int *pos, const float *frac,
+                        float scale, float *out, int n)
+{
+    int i = 0;
+#ifdef __AVX2__
+    const __m256  vscale = _mm256_set1_ps(scale);
+    const __m256  half   = _mm256_set1_ps(0.5f);
+    const __m256  two    = _mm256_set1_ps(2.0f);
+    const __m256  three  = _mm256_set1_ps(3.0f);
+    const __m256  five   = _mm256_set1_ps(5.0f);
+    const __m256i one    = _mm256_set1_epi32(1);
+    for(; i + 8 <= n; i += 8) {
+        const __m256i p   = _mm256_loadu_si256((const __m256i *)(pos + i));
+        const __m256  f   = _mm256_loadu_ps(frac + i);
+        const __m256  xm1 = gather(smps, p);
+        const __m256  x0  = gather(smps, _mm256_add_epi32(p, one));
+        const __m256  x1  = gather(smps, _mm256_add_epi32(p, _mm256_set1_epi32(2)));
+        const __m256  x2  = gather(smps, _mm256_add_epi32(p, _mm256_set1_epi32(3)));
+        const __m256  a   = _mm256_mul_ps(_mm256_add_ps(_mm256_sub_ps(
+                                _mm256_mul_ps(three, _mm256_sub_ps(x0, x1)),
+                                xm1), x2), half);
+        const __m256  b   = _mm256_sub_ps(_mm256_add_ps(_mm256_mul_ps(two, x1), xm1),
+                                _mm256_mul_ps(_mm256_add_ps(
+                                    _mm256_mul_ps(five, x0), x2), half));
+        const __m256  c   = _mm256_mul_ps(_mm256_sub_ps(x1, xm1), half);
+        __m256 v = _mm256_add_ps(_mm256_mul_ps(a, f), b);
+        v = _mm256_add_ps(_mm256_mul_ps(v, f), c);
+        v = _mm256_add_ps(_mm256_mul_ps(v, f), x0);
+        _mm256_storeu_ps(out + i, _mm256_mul_ps(v, vscale));
+    }
+#endif
+    for(; i < n; ++i) {
+        const T    *x   = smps + pos[i];
+        const float xm1 = x[0];
+        const float x0  = x[1];
+        const float x1  = x[2];
+        const float x2  = x[3];
+        const float a   = (3.0f * (x0 - x1) - xm1 + x2) * 0.5f;
+        const float b   = 2.0f * x1 + xm1 - (5.0f * x0 + x2) * 0.5f;
+        const float c   = (x1 - xm1) * 0.5f;
+        out[i] = ((((a * frac[i]) + b) * frac[i] + c) * frac[i] + x0) * scale;
     }
-    return 1;
 }
-int PADnote::Compute_Cubic(float *outl,
-                           float *outr,
-                           int freqhi,
-                           float freqlo)
+
+template<class T>
+static void sincKernel(const T *smps, const int *pos, const float *frac,
+                       float scale, float *out, int n)
 {
-    float *smps = pars.sample[nsample].smp;
-    if(smps == NULL) {
-        finished_ = true;
-        return 1;
+    int i = 0;
+#ifdef __AVX2__
+    //the taps of one output sample are contiguous, so they are plain loads
+    const __m256 vscale = _mm256_set1_ps(scale);
+    for(; i + 8 <= n; i += 8) {
+        __m256 v[8];
+        for(int j = 0; j < 8; ++j) {
+            const float  phase = frac[i + j] * PAD_SINC_PHASES;
+            const int    p     = std::min((int)phase, PAD_SINC_PHASES - 1);
+            const float *k     = sinc_table.k[p][0];
+            const __m256 kern  = _mm256_add_ps(_mm256_loadu_ps(k),
+                                     _mm256_mul_ps(_mm256_set1_ps(phase - p),
+                                                   _mm256_loadu_ps(k + PAD_SINC_TAPS)));
+            v[j] = _mm256_mul_ps(load8(smps + pos[i + j]), kern);
+        }
+        _mm256_storeu_ps(out + i, _mm256_mul_ps(hsum8(v), vscale));
     }
-    int   size = pars.sample[nsample].size;
-    float xm1, x0, x1, x2, a, b, c;
-    for(int i = 0; i < synth.buffersize; ++i) {
-        poshi_l += freqhi;
-        poshi_r += freqhi;
-        poslo   += freqlo;
-        if(poslo >= 1.0f) {
-            poshi_l += 1;
-            poshi_r += 1;
-            poslo   -= 1.0f;
+#endif
+    for(; i < n; ++i) {
+        const float phase = frac[i] * PAD_SINC_PHASES;
+        const int   p     = std::min((int)phase, PAD_SINC_PHASES - 1);
+        const float t     = phase - p;
+        const float *k    = sinc_table.k[p][0];
+        const T     *x    = smps + pos[i];
+        float sum = 0.0f;
+        for(int j = 0; j < PAD_SINC_TAPS; ++j)
+            sum += (float)x[j] * (k[j] + t * k[j + PAD_SINC_TAPS]);
+        out[i] = sum * scale;
+    }
+}
+
+template<class T>
+void PADnote::interpolate(const T *smps, float scale,
+                          float *outl, float *outr,
+                          int freqhi, float freqlo)
+{
+    const int size = pars.sample[nsample].size;
+    int   pos_l[PAD_CHUNK], pos_r[PAD_CHUNK];
+    float frac[PAD_CHUNK];
+    for(int off = 0; off < synth.buffersize; off += PAD_CHUNK) {
+        const int n = std::min(PAD_CHUNK, synth.buffersize - off);
+        for(int i = 0; i < n; ++i) {
+            poshi_l += freqhi;
+            poshi_r += freqhi;
+            poslo   += freqlo;
+            if(poslo >= 1.0f) {
+                poshi_l += 1;
+                poshi_r += 1;
+                poslo   -= 1.0f;
+            }
+            if(poshi_l >= size)
+                poshi_l %= size;
+            if(poshi_r >= size)
+                poshi_r %= size;
+            pos_l[i] = poshi_l;
+            pos_r[i] = poshi_r;
+            frac[i]  = poslo;
+        }
+
+        switch(interpolation) {
+            case 0:
+                linearKernel(smps, pos_l, frac, scale, outl + off, n);
+                linearKernel(smps, pos_r, frac, scale, outr + off, n);
+                break;
+            case 1:
+                cubicKernel(smps, pos_l, frac, scale, outl + off, n);
+                cubicKernel(smps, pos_r, frac, scale, outr + off, n);
+                break;
+            default:
+                sincKernel(smps, pos_l, frac, scale, outl + off, n);
+                sincKernel(smps, pos_r, frac, scale, outr + off, n);
+                break;
         }
-        if(poshi_l >= size)
-            poshi_l %= size;
-        if(poshi_r >= size)
-            poshi_r %= size;
-
-
-        //left
-        xm1     = smps[poshi_l];
-        x0      = smps[poshi_l + 1];
-        x1      = smps[poshi_l + 2];
-        x2      = smps[poshi_l + 3];
-        a       = (3.0f * (x0 - x1) - xm1 + x2) * 0.5f;
-        b       = 2.0f * x1 + xm1 - (5.0f * x0 + x2) * 0.5f;
-        c       = (x1 - xm1) * 0.5f;
-        outl[i] = (((a * poslo) + b) * poslo + c) * poslo + x0;
-        //right
-        xm1     = smps[poshi_r];
-        x0      = smps[poshi_r + 1];
-        x1      = smps[poshi_r + 2];
-        x2      = smps[poshi_r + 3];
-        a       = (3.0f * (x0 - x1) - xm1 + x2) * 0.5f;
-        b       = 2.0f * x1 + xm1 - (5.0f * x0 + x2) * 0.5f;
-        c       = (x1 - xm1) * 0.5f;
-        outr[i] = (((a * poslo) + b) * poslo + c) * poslo + x0;
     }
+}
+
+int PADnote::Compute(float *outl,
+                     float *outr,
+                     int freqhi,
+                     float freqlo)
+{
+    const PADnoteParameters::Sample &smp = pars.sample[nsample];
+    if(smp.smp16)
+        interpolate(smp.smp16, smp.scale, outl, outr, freqhi, freqlo);
+    else if(smp.smp)
+        interpolate(smp.smp, 1.0f, outl, outr, freqhi, freqlo);
+    else
+        finished_ = true;
     return 1;
 }
 
@@ -363,8 +546,7 @@ int PADnote::Compute_Cubic(float *outl,
 int PADnote::noteout(float *outl, float *outr)
 {
     computecurrentparameters();
-    float *smps = pars.sample[nsample].smp;
-    if(smps == NULL) {
+    if(!pars.sample[nsample].valid()) {
         for(int i = 0; i < synth.buffersize; ++i) {
             outl[i] = 0.0f;
             outr[i] = 0.0f;
@@ -379,10 +561,7 @@ int PADnote::noteout(float *outl, float *outr)
     float freqlo  = freqrap - floorf(freqrap);
 
 
-    if(interpolation)
-        Compute_Cubic(outl, outr, freqhi, freqlo);
-    else
-        Compute_Linear(outl, outr, freqhi, freqlo);
+    Compute(outl, outr, freqhi, freqlo);
 
     watch_int(outl,synth.buffersize);
 
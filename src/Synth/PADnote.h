@@ -57,14 +57,15 @@ class PADnote:public SynthNote
         int nsample;
         Portamento *portamento;
 
-        int Compute_Linear(float *outl,
-                           float *outr,
-                           int freqhi,
-                           float freqlo);
-        int Compute_Cubic(float *outl,
-                          float *outr,
-                          int freqhi,
-                          float freqlo);
+        int Compute(float *outl,
+                    float *outr,
+                    int freqhi,
+                    float freqlo);
+        //interpolation over float or compact (int16) samples
+        template<class T>
+        void interpolate(const T *smps, float scale,
+                         float *outl, float *outr,
+                         int freqhi, float freqlo);
 
 
         struct {
@@ -29,6 +29,7 @@
 #include "../Misc/Time.h"
 #include "../Misc/Util.h"
 #include "../Misc/Allocator.h"
+#include "../Misc/Denormal.h"
 
 #ifndef M_PI
 # define M_PI    3.14159265358979323846 /* pi */
@@ -208,7 +209,8 @@ void SUBnote::setup(float velocity_,
 SynthNote *SUBnote::cloneLegato(void)
 {
     SynthParams sp{memory, ctl, synth, time, velocity,
-                   portamento, legato.param.note_log2_freq, true, legato.param.seed};
+                   portamento, legato.param.note_log2_freq, true, legato.param.seed,
+                   modbank};
     return memory.alloc<SUBnote>(&pars, sp);
 }
 
@@ -373,20 +375,20 @@ void SUBnote::initparameters(float freq, WatchManager *wm, const char *prefix)
 {
     ScratchString pre = prefix;
     AmpEnvelope = memory.alloc<Envelope>(*pars.AmpEnvelope, freq,
-            synth.dt(), wm, (pre+"AmpEnvelope/").c_str);
+            synth, wm, (pre+"AmpEnvelope/").c_str, modbank);
 
     if(pars.PFreqEnvelopeEnabled)
         FreqEnvelope = memory.alloc<Envelope>(*pars.FreqEnvelope, freq,
-            synth.dt(), wm, (pre+"FreqEnvelope/").c_str);
+            synth, wm, (pre+"FreqEnvelope/").c_str, modbank);
 
     if(pars.PBandWidthEnvelopeEnabled)
         BandWidthEnvelope = memory.alloc<Envelope>(*pars.BandWidthEnvelope,
-                freq, synth.dt(), wm, (pre+"BandWidthEnvelope/").c_str);
+                freq, synth, wm, (pre+"BandWidthEnvelope/").c_str, modbank);
 
     if(pars.PGlobalFilterEnabled) {
         GlobalFilterEnvelope =
             memory.alloc<Envelope>(*pars.GlobalFilterEnvelope, freq,
-                    synth.dt(), wm, (pre+"GlobalFilterEnvelope/").c_str);
+                    synth, wm, (pre+"GlobalFilterEnvelope/").c_str, modbank);
 
         GlobalFilter = memory.alloc<ModFilter>(*pars.GlobalFilter, synth, time, memory, stereo, freq);
 
@@ -464,7 +466,7 @@ void SUBnote::computecurrentparameters()
         }
 
         envfreq *=
-            powf(ctl.pitchwheel.relfreq, BendAdjust); //pitch wheel
+            fast_exp2f(ctl.pitchwheel.relfreq_log2 * BendAdjust); //pitch wheel
 
         //Update frequency while portamento is converging
         if(portamento) {
@@ -545,8 +547,13 @@ void SUBnote::chanOutput(float *out, bpfilter *bp, int buffer_size)
  */
 int SUBnote::noteout(float *outl, float *outr)
 {
+#if FLUSH_DENORMALS
+    memset(outl, 0, synth.bufferbytes);
+    memset(outr, 0, synth.bufferbytes);
+#else
     memcpy(outl, synth.denormalkillbuf, synth.bufferbytes);
     memcpy(outr, synth.denormalkillbuf, synth.bufferbytes);
+#endif
 
     if(!NoteEnabled)
         return 0;
@@ -12,6 +12,8 @@
 #include "SynthNote.h"
 #include "../Params/Controller.h"
 #include "../Misc/Util.h"
+#include "../Misc/Allocator.h"
+#include "../Misc/Time.h"
 #include "../globals.h"
 #include <cstring>
 #include <new>
@@ -22,8 +24,52 @@ namespace zyn {
 SynthNote::SynthNote(const SynthParams &pars)
     :memory(pars.memory),
     legato(pars.synth, pars.velocity, pars.portamento,
-            pars.note_log2_freq, pars.quiet, pars.seed), ctl(pars.ctl), synth(pars.synth), time(pars.time)
-{}
+            pars.note_log2_freq, pars.quiet, pars.seed),
+    startoffset(pars.time.sampleOffset()), startpos(0),
+    startleft(startoffset), startbufl(NULL), startbufr(NULL),
+    ctl(pars.ctl), synth(pars.synth), time(pars.time),
+    modbank(pars.modbank)
+{
+    if(startoffset) {
+        startbufl = memory.valloc<float>(startoffset);
+        startbufr = memory.valloc<float>(startoffset);
+        memset(startbufl, 0, startoffset * sizeof(float));
+        memset(startbufr, 0, startoffset * sizeof(float));
+    }
+}
+
+SynthNote::~SynthNote()
+{
+    memory.devalloc(startbufl);
+    memory.devalloc(startbufr);
+}
+
+void SynthNote::applyStartOffset(float *outl, float *outr)
+{
+    if(!startoffset)
+        return;
+
+    //each sample is swapped with the one delayed the longest
+    for(int i = 0; i < synth.buffersize; ++i) {
+        const float l = outl[i], r = outr[i];
+        outl[i] = startbufl[startpos];
+        outr[i] = startbufr[startpos];
+        startbufl[startpos] = l;
+        startbufr[startpos] = r;
+        if(++startpos == startoffset)
+            startpos = 0;
+    }
+}
+
+void SynthNote::flushStartOffset(float *outl, float *outr)
+{
+    memset(outl, 0, synth.bufferbytes);
+    memset(outr, 0, synth.bufferbytes);
+    applyStartOffset(outl, outr);
+    startleft -= synth.buffersize;
+    if(startleft <= 0)
+        startoffset = 0;
+}
 
 SynthNote::Legato::Legato(const SYNTH_T &synth_, float vel,
                           Portamento *portamento,
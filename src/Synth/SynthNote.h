@@ -32,6 +32,7 @@ struct SynthParams
     float     note_log2_freq; //Floating point value of the note
     bool      quiet;     //Initial output condition for legato notes
     prng_t    seed;      //Random seed
+    ModulatorBank *modbank; //Envelopes and LFOs of the part, may be NULL
 };
 
 struct LegatoParams
@@ -47,7 +48,7 @@ class SynthNote
 {
     public:
         SynthNote(const SynthParams &pars);
-        virtual ~SynthNote() {}
+        virtual ~SynthNote();
 
         /**Compute Output Samples
          * @return 0 if note is finished*/
@@ -68,6 +69,17 @@ class SynthNote
 
         virtual SynthNote *cloneLegato(void) = 0;
 
+        /**Delay the output of noteout() by the sample offset the note was
+         * started at, so it begins on that sample rather than on the start
+         * of the frame (see AbsTime). To be applied to every noteout()
+         * buffer, the offset may be longer than a buffer.*/
+        void applyStartOffset(float *outl, float *outr);
+        /**True while applyStartOffset() holds back samples of the note*/
+        bool hasDelayedSamples(void) const { return startoffset; }
+        /**Output the samples held back by applyStartOffset(), once the note
+         * finished, instead of another noteout() buffer*/
+        void flushStartOffset(float *outl, float *outr);
+
         /* For polyphonic aftertouch needed */
         void setVelocity(float velocity_);
 
@@ -126,12 +138,20 @@ class SynthNote
                 void setDecounter(int decounter_) {decounter = decounter_; }
         } legato;
 
+        //Start offset within the first frame and a ring of the delayed
+        //samples, where startpos is the oldest one
+        int    startoffset;
+        int    startpos;
+        int    startleft; //samples left to flush
+        float *startbufl, *startbufr;
+
         prng_t initial_seed;
         prng_t current_prng_state;
         const Controller &ctl;
         const SYNTH_T    &synth;
         const AbsTime    &time;
         WatchManager     *wm;
+        ModulatorBank    *modbank;
         smooth_float     filtercutoff_relfreq;
 };
 
@@ -16,10 +16,12 @@
 #include <fstream>
 #include <ctime>
 #include <string>
+#include <vector>
 #include "../Misc/Master.h"
 #include "../Misc/Util.h"
 #include "../Misc/Allocator.h"
 #include "../Synth/ADnote.h"
+#include "../Synth/ModulatorBank.h"
 #include "../Params/Presets.h"
 #include "../DSP/FFTwrapper.h"
 #include "../Synth/LFO.h"
@@ -235,6 +237,121 @@ class AdNoteTest
 
         }
 
+        //Render a fresh note started at the given offset until it is
+        //finished and has output all of its samples, like Part does
+        //the note renders buffers of notes.buffersize, the offset is
+        //within a frame of synth->buffersize
+        void renderFromOffset(const SYNTH_T &notes, int offset,
+                              vector<float> &out)
+        {
+            time->setSampleOffset(offset);
+            sprng(0);
+            SynthParams pars{memory, *controller, notes, *time, 120, 0,
+                             test_freq_log2, false, 1234};
+            ADnote *n = new ADnote(defaultPreset, pars, w);
+            time->setSampleOffset(0);
+            const int release = 4 * synth->buffersize / notes.buffersize;
+            for(int i = 0; !n->finished() || n->hasDelayedSamples(); ++i) {
+                if(i == release)
+                    n->releasekey();
+                if(n->finished())
+                    n->flushStartOffset(outL, outR);
+                else {
+                    n->noteout(outL, outR);
+                    n->applyStartOffset(outL, outR);
+                }
+                out.insert(out.end(), outL, outL + notes.buffersize);
+            }
+            delete n;
+        }
+
+        void testStartOffset() {
+            //notes rendered in blocks shorter than the offset, like Part
+            //does with a control period
+            SYNTH_T blocks;
+            blocks.buffersize = 32;
+            blocks.alias(false);
+
+            const SYNTH_T *notes[] = {synth, &blocks};
+            const int offsets[]    = {37, 200};
+            for(const SYNTH_T *ns:notes)
+                for(int offset:offsets) {
+                    vector<float> ref, shifted;
+
+                    renderFromOffset(*ns, 0, ref);
+                    renderFromOffset(*ns, offset, shifted);
+
+                    //silent until the start offset, then the same note up
+                    //to its last sample
+                    TS_ASSERT(shifted.size() >= ref.size() + offset);
+                    for(int i = 0; i < offset; ++i)
+                        TS_ASSERT(shifted[i] == 0.0f);
+                    int mismatches = 0;
+                    for(size_t i = 0; i < ref.size(); ++i)
+                        if(fabsf(shifted[i + offset] - ref[i]) > 1e-6f)
+                            mismatches++;
+                    for(size_t i = ref.size() + offset; i < shifted.size(); ++i)
+                        if(shifted[i] != 0.0f)
+                            mismatches++;
+                    TS_ASSERT_EQUAL_INT(mismatches, 0);
+                }
+        }
+
+        //Render a note in frames of the given synth until it is finished,
+        //in blocks of the control period like Part does, with the
+        //envelopes and LFOs in a ModulatorBank or on their own
+        void renderFrames(const SYNTH_T &frame, bool banked,
+                          vector<float> &out)
+        {
+            const SYNTH_T notes = frame.noteSynth();
+            AbsTime       frames(frame);
+            ModulatorBank bank(notes, memory);
+            sprng(0);
+            SynthParams pars{memory, *controller, notes, frames, 120, 0,
+                             test_freq_log2, false, 1234,
+                             banked ? &bank : NULL};
+            ADnote *n = new ADnote(defaultPreset, pars, w);
+            const int blocks  = frame.buffersize / notes.buffersize;
+            const int release = 4 * synth->buffersize / frame.buffersize;
+            for(int i = 0; !n->finished(); ++i) {
+                if(i == release)
+                    n->releasekey();
+                for(int k = 0; k < blocks && !n->finished(); ++k) {
+                    bank.tick();
+                    n->noteout(outL, outR);
+                    out.insert(out.end(), outL, outL + notes.buffersize);
+                }
+                frames++;
+            }
+            delete n;
+        }
+
+        void testModulatorBank() {
+            //the parameters were set before the notes start, so the bank
+            //computes the LFOs too (see LFO::lfoout())
+            (*time)++;
+
+            //one update per block, less than one, and a fraction of one
+            const int setups[][2] = {{256, 0}, {256, 32}, {16, 32}, {37, 32}};
+            for(const int *setup:setups) {
+                SYNTH_T frame;
+                frame.buffersize    = setup[0];
+                frame.controlperiod = setup[1];
+                frame.alias(false);
+
+                vector<float> alone, banked;
+                renderFrames(frame, false, alone);
+                renderFrames(frame, true, banked);
+
+                TS_ASSERT_EQUAL_INT(banked.size(), alone.size());
+                int mismatches = 0;
+                for(size_t i = 0; i < alone.size() && i < banked.size(); ++i)
+                    if(fabsf(banked[i] - alone[i]) > 1e-6f)
+                        mismatches++;
+                TS_ASSERT_EQUAL_INT(mismatches, 0);
+            }
+        }
+
 #define OUTPUT_PROFILE
 #ifdef OUTPUT_PROFILE
         void testSpeed() {
@@ -258,5 +375,11 @@ int main()
     test.setUp();
     test.testDefaults();
     test.tearDown();
+    test.setUp();
+    test.testStartOffset();
+    test.tearDown();
+    test.setUp();
+    test.testModulatorBank();
+    test.tearDown();
     return test_summary();
 }
@@ -0,0 +1,214 @@
+/*
+  ZynAddSubFX - a software synthesizer
+
+  CombFilterBankTest.cpp - CxxTest for Effect/CombFilterBank
+
+  This program is free software; you can redistribute it and/or
+  modify it under the terms of the GNU General Public License
+  as published by the Free Software Foundation; either version 2
+  of the License, or (at your option) any later version.
+*/
+#include "test-suite.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include "../Effects/CombFilterBank.h"
+#include "../Misc/Allocator.h"
+#include "../globals.h"
+
+using namespace std;
+using namespace zyn;
+
+#define SRATE 48000
+#define BUF   256
+
+/*
+ * The bank as it was before the strings were interleaved: one buffer per
+ * string and an fmodf per string and sample. Kept as the reference for the
+ * output and the speed of CombFilterBank.
+ */
+class ReferenceBank
+{
+    public:
+        ReferenceBank(unsigned int nr, float basefreq, const float *delays_)
+            :delays(delays_), nrOfStrings(nr), pos_writer(0)
+        {
+            mem_size = (int)ceilf(((float)SRATE/basefreq*1.03f + BUF + 2)/16) * 16;
+            for(unsigned int j = 0; j < nrOfStrings; ++j) {
+                string_smps[j] = new float[mem_size];
+                memset(string_smps[j], 0, mem_size*sizeof(float));
+            }
+        }
+
+        ~ReferenceBank()
+        {
+            for(unsigned int j = 0; j < nrOfStrings; ++j)
+                delete[] string_smps[j];
+        }
+
+        static float tanhX(const float x)
+        {
+            const float x2 = x*x;
+            return (x*(105.0f+10.0f*x2)/(105.0f+(45.0f+x2)*x2));
+        }
+
+        float sampleLerp(const float *smp, const float pos) const
+        {
+            int poshi = (int)pos;
+            float poslo = pos - (float) poshi;
+            return smp[poshi] + poslo * (smp[(poshi+1)%mem_size]-smp[poshi]);
+        }
+
+        void filterout(float *smp, float gain, float inputgain, float outgain)
+        {
+            for(unsigned int i = 0; i < BUF; ++i) {
+                const float input_smp = smp[i]*inputgain;
+                for(unsigned int j = 0; j < nrOfStrings; ++j) {
+                    const float pos_reader = fmodf(float(pos_writer+mem_size) - delays[j], float(mem_size));
+                    const float sample = sampleLerp(string_smps[j], pos_reader);
+                    string_smps[j][pos_writer] = input_smp + tanhX(sample*gain);
+                }
+                smp[i] = 0.0f;
+                for(unsigned int j = 0; j < nrOfStrings; ++j)
+                    smp[i] += string_smps[j][pos_writer];
+                smp[i] *= outgain / (float)nrOfStrings;
+                ++pos_writer %= mem_size;
+            }
+        }
+
+    private:
+        const float *delays;
+        float *string_smps[NUM_SYMPATHETIC_STRINGS];
+        unsigned int nrOfStrings;
+        unsigned int mem_size;
+        unsigned int pos_writer;
+};
+
+class CombFilterBankTest
+{
+    public:
+        void setUp() {
+            bank = new CombFilterBank(&alloc, SRATE, BUF, 0.938f);
+            bank->inputgain = 1.2f;
+            bank->outgain   = 0.9f;
+            //strings of a piano like tuning above 40Hz, slightly detuned
+            for(unsigned int j = 0; j < NUM_SYMPATHETIC_STRINGS; ++j)
+                bank->delays[j] = SRATE / (40.0f * powf(2.0f, (j / 3) / 12.0f)
+                                           * (1.0f + (j % 3) * 0.001f));
+        }
+
+        void tearDown() {
+            delete bank;
+        }
+
+        void fill(float *smp, int seed) {
+            srand(seed);
+            for(int i = 0; i < BUF; ++i)
+                smp[i] = (rand() / (float)RAND_MAX - 0.5f) * ((seed % 4) ? 0.0f : 1.0f);
+        }
+
+        void compare(unsigned int strings) {
+            bank->setStrings(strings, 40.0f);
+            ReferenceBank ref(strings, 40.0f, bank->delays);
+
+            float out[BUF], expected[BUF];
+            float maxerr = 0.0f, maxval = 0.0f;
+            for(int b = 0; b < 200; ++b) {
+                fill(out, b);
+                memcpy(expected, out, sizeof(out));
+                bank->filterout(out);
+                ref.filterout(expected, bank->gainbwd, bank->inputgain,
+                              bank->outgain);
+                for(int i = 0; i < BUF; ++i) {
+                    maxerr = max(maxerr, fabsf(out[i] - expected[i]));
+                    maxval = max(maxval, fabsf(expected[i]));
+                }
+            }
+            TS_ASSERT(maxval > 0.01f);
+            TS_ASSERT(maxerr < 1e-4f * maxval);
+        }
+
+        void testMatchesReference() {
+            compare(NUM_SYMPATHETIC_STRINGS);
+        }
+
+        void testPartialBlock() {
+            //a number of strings that does not fill the last block
+            compare(13);
+        }
+
+        void testStringChange() {
+            //the strings are independent, so after 16 strings are reduced
+            //to 8 and increased to 24 again, the bank plays the first 8
+            //strings of a bank which always had 8 of them
+            CombFilterBank other(&alloc, SRATE, BUF, 0.938f);
+            other.inputgain = bank->inputgain;
+            other.outgain   = bank->outgain;
+            memcpy(other.delays, bank->delays, sizeof(other.delays));
+            bank->setStrings(16, 40.0f);
+            other.setStrings(8, 40.0f);
+
+            float out[BUF], expected[BUF];
+            for(int b = 0; b < 20; ++b) {
+                fill(out, b);
+                memcpy(expected, out, sizeof(out));
+                bank->filterout(out);
+                other.filterout(expected);
+            }
+            bank->setStrings(8, 40.0f);
+            bank->setStrings(24, 40.0f);
+
+            //the added strings start silent, so the mean is 8/24 of other
+            memset(out, 0, sizeof(out));
+            memset(expected, 0, sizeof(expected));
+            bank->filterout(out);
+            other.filterout(expected);
+            float energy = 0.0f;
+            for(int i = 0; i < BUF; ++i) {
+                energy += expected[i] * expected[i];
+                TS_ASSERT_DELTA(out[i] * 24.0f, expected[i] * 8.0f, 1e-5f);
+            }
+            TS_ASSERT(energy > 0.0f);
+        }
+
+        void testSpeed() {
+            const int buffers = 2000;
+            bank->setStrings(NUM_SYMPATHETIC_STRINGS, 40.0f);
+            ReferenceBank ref(NUM_SYMPATHETIC_STRINGS, 40.0f, bank->delays);
+            float smp[BUF];
+
+            int t_on = clock();
+            for(int b = 0; b < buffers; ++b) {
+                fill(smp, b);
+                ref.filterout(smp, bank->gainbwd, bank->inputgain,
+                              bank->outgain);
+            }
+            int t_mid = clock();
+            for(int b = 0; b < buffers; ++b) {
+                fill(smp, b);
+                bank->filterout(smp);
+            }
+            int t_off = clock();
+
+            printf("CombFilterBankTest: %f seconds for %d buffers with the reference bank.\n",
+                   (static_cast<float>(t_mid - t_on)) / CLOCKS_PER_SEC, buffers);
+            printf("CombFilterBankTest: %f seconds for %d buffers with the interleaved bank.\n",
+                   (static_cast<float>(t_off - t_mid)) / CLOCKS_PER_SEC, buffers);
+        }
+
+    private:
+        Alloc           alloc;
+        CombFilterBank *bank;
+};
+
+int main()
+{
+    CombFilterBankTest test;
+    RUN_TEST(testMatchesReference);
+    RUN_TEST(testPartialBlock);
+    RUN_TEST(testStringChange);
+    RUN_TEST(testSpeed);
+    return test_summary();
+}
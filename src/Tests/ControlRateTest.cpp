@@ -0,0 +1,239 @@
+/*
+  ZynAddSubFX - a software synthesizer
+
+  ControlRateTest.cpp - CxxTest for the control rate of Envelope and LFO
+                        and the ModulatorBank
+
+  This program is free software; you can redistribute it and/or
+  modify it under the terms of the GNU General Public License
+  as published by the Free Software Foundation; either version 2
+  of the License, or (at your option) any later version.
+*/
+#include "test-suite.h"
+#include <cmath>
+#include "../Misc/Allocator.h"
+#include "../Misc/Time.h"
+#include "../Params/EnvelopeParams.h"
+#include "../Params/LFOParams.h"
+#include "../Synth/Envelope.h"
+#include "../Synth/LFO.h"
+#include "../Synth/ModulatorBank.h"
+#include "../globals.h"
+
+using namespace std;
+using namespace zyn;
+
+#define SRATE   48000
+#define PERIOD  1024 //samples between two compared values
+#define VALUES  64
+
+class ControlRateTest
+{
+    public:
+        void setUp() {}
+        void tearDown() {}
+
+        void setSynth(SYNTH_T &synth, int buffersize, int controlperiod) {
+            synth.samplerate    = SRATE;
+            synth.buffersize    = buffersize;
+            synth.controlperiod = controlperiod;
+            synth.alias(false);
+        }
+
+        //envelope values every PERIOD samples, released half way, read
+        //once per block of the notes like Part does
+        void traceEnvelope(int buffersize, int controlperiod,
+                           consumer_location_t loc, bool dB, float *out,
+                           bool banked = false) {
+            SYNTH_T synth;
+            setSynth(synth, buffersize, controlperiod);
+            const SYNTH_T notes = synth.noteSynth();
+            EnvelopeParams pars(0, 0);
+            pars.init(loc);
+            AllocatorClass memory;
+            ModulatorBank  bank(notes, memory);
+            Envelope env(pars, 440.0f, notes, 0, 0, banked ? &bank : 0);
+
+            const int step   = PERIOD / buffersize;
+            const int blocks = buffersize / notes.buffersize;
+            for(int i = 0; i < VALUES * step; ++i) {
+                if(i == VALUES * step / 2)
+                    env.releasekey();
+                for(int k = 0; k < blocks; ++k) {
+                    bank.tick();
+                    const float v = dB ? env.envout_dB() : env.envout(false);
+                    if(i % step == 0 && k == 0)
+                        out[i / step] = v;
+                }
+            }
+        }
+
+        void traceLfo(int buffersize, int controlperiod, float *out,
+                      bool banked = false) {
+            SYNTH_T synth;
+            setSynth(synth, buffersize, controlperiod);
+            const SYNTH_T notes = synth.noteSynth();
+            AbsTime   time(synth);
+            LFOParams pars(ad_global_freq, &time);
+            pars.Pintensity = 64;
+            AllocatorClass memory;
+            ModulatorBank  bank(notes, memory);
+            LFO lfo(pars, 440.0f, time, 0, 0, banked ? &bank : 0);
+
+            const int step   = PERIOD / buffersize;
+            const int blocks = buffersize / notes.buffersize;
+            for(int i = 0; i < VALUES * step; ++i) {
+                for(int k = 0; k < blocks; ++k) {
+                    bank.tick();
+                    const float v = lfo.lfoout();
+                    if(i % step == 0 && k == 0)
+                        out[i / step] = v;
+                }
+                time++;
+            }
+        }
+
+        void compare(const float *a, const float *b) {
+            float maxval = 0.0f;
+            for(int i = 0; i < VALUES; ++i) {
+                maxval = max(maxval, fabsf(a[i]));
+                TS_ASSERT_DELTA(a[i], b[i], 1e-5f * (1.0f + fabsf(a[i])));
+            }
+            TS_ASSERT(maxval > 0.0f);
+        }
+
+        //longer buffers are rendered in blocks of the control period, so
+        //a buffer of 1024 samples is modulated like one of 32
+        void testEnvelopeBufferSize() {
+            const consumer_location_t locs[] = {ad_voice_freq, ad_voice_filter,
+                                                ad_global_amp, ad_voice_amp};
+            for(consumer_location_t loc:locs) {
+                const bool dB = loc == ad_global_amp || loc == ad_voice_amp;
+                float ref[VALUES], out[VALUES];
+                traceEnvelope(32, 32, loc, dB, ref);
+                for(int bs = 64; bs <= PERIOD; bs *= 2) {
+                    traceEnvelope(bs, 32, loc, dB, out);
+                    compare(ref, out);
+                }
+            }
+        }
+
+        //the modulation does not depend on the buffer size, whether it is
+        //shorter or longer than the control period
+        void testLfoBufferSize() {
+            float ref[VALUES], out[VALUES];
+            traceLfo(64, 64, ref);
+            for(int bs = 8; bs <= PERIOD; bs *= 2) {
+                traceLfo(bs, 64, out);
+                compare(ref, out);
+            }
+        }
+
+        //buffer sizes which the control period does not divide
+        void testNoteBufferSize() {
+            SYNTH_T synth;
+            setSynth(synth, 1000, 32);
+            TS_ASSERT_EQUAL_INT(synth.notebuffersize(), 25);
+            setSynth(synth, 1021, 32);
+            TS_ASSERT_EQUAL_INT(synth.notebuffersize(), 1021);
+            setSynth(synth, 1024, 0);
+            TS_ASSERT_EQUAL_INT(synth.notebuffersize(), 1024);
+            setSynth(synth, 16, 32);
+            TS_ASSERT_EQUAL_INT(synth.notebuffersize(), 16);
+            TS_ASSERT_EQUAL_INT(synth.noteSynth().buffersize, 16);
+        }
+
+        //without a control period there is one update per buffer, which is
+        //the same as a control period of one buffer
+        void testPerBuffer() {
+            float ref[VALUES], out[VALUES];
+            traceEnvelope(64, 64, ad_voice_filter, false, ref);
+            traceEnvelope(64, 0, ad_voice_filter, false, out);
+            compare(ref, out);
+        }
+
+        //the ModulatorBank computes the same values as the modulators alone,
+        //with less than one, one, and a fractional number of updates per
+        //block of the notes
+        void testBank() {
+            const consumer_location_t locs[] = {ad_voice_freq, ad_voice_filter,
+                                                ad_global_amp, ad_voice_amp};
+            const int setups[][2] = {{8, 32}, {64, 48}, {512, 32}, {1021, 32},
+                                     {1024, 0}};
+            for(const int *setup:setups) {
+                const int bs = setup[0], period = setup[1];
+                for(consumer_location_t loc:locs) {
+                    const bool dB = loc == ad_global_amp || loc == ad_voice_amp;
+                    float ref[VALUES], out[VALUES];
+                    traceEnvelope(bs, period, loc, dB, ref);
+                    traceEnvelope(bs, period, loc, dB, out, true);
+                    compare(ref, out);
+                }
+                float ref[VALUES], out[VALUES];
+                traceLfo(bs, period, ref);
+                traceLfo(bs, period, out, true);
+                compare(ref, out);
+            }
+        }
+
+        //the bank grows with the modulators and keeps them apart when some
+        //of them go away
+        void testBankGrows() {
+            SYNTH_T synth;
+            setSynth(synth, 256, 32);
+            const SYNTH_T notes = synth.noteSynth();
+            EnvelopeParams pars(0, 0);
+            pars.init(ad_voice_filter);
+            AllocatorClass memory;
+            ModulatorBank  bank(notes, memory);
+
+            const int n = 200;
+            Envelope *alone[n], *banked[n];
+            for(int i = 0; i < n; ++i) {
+                alone[i]  = new Envelope(pars, 100.0f + i, notes);
+                banked[i] = new Envelope(pars, 100.0f + i, notes, 0, 0, &bank);
+            }
+            TS_ASSERT_EQUAL_INT(bank.envelopes(), n);
+
+            float maxdiff = 0.0f;
+            for(int k = 0; k < 400; ++k) {
+                if(k == 100)
+                    for(int i = 0; i < n; i += 3) {
+                        delete alone[i];
+                        delete banked[i];
+                        alone[i] = banked[i] = NULL;
+                    }
+                if(k == 200)
+                    for(int i = 0; i < n; ++i)
+                        if(banked[i]) {
+                            alone[i]->releasekey();
+                            banked[i]->releasekey();
+                        }
+                bank.tick();
+                for(int i = 0; i < n; ++i)
+                    if(banked[i])
+                        maxdiff = max(maxdiff, fabsf(alone[i]->envout(false)
+                                                     - banked[i]->envout(false)));
+            }
+            TS_ASSERT_DELTA(maxdiff, 0.0f, 1e-5f);
+            TS_ASSERT_EQUAL_INT(bank.envelopes(), n - (n + 2) / 3);
+
+            for(int i = 0; i < n; ++i) {
+                delete alone[i];
+                delete banked[i];
+            }
+            TS_ASSERT_EQUAL_INT(bank.envelopes(), 0);
+        }
+};
+
+int main()
+{
+    ControlRateTest test;
+    RUN_TEST(testEnvelopeBufferSize);
+    RUN_TEST(testLfoBufferSize);
+    RUN_TEST(testNoteBufferSize);
+    RUN_TEST(testPerBuffer);
+    RUN_TEST(testBank);
+    RUN_TEST(testBankGrows);
+    return test_summary();
+}
@@ -13,6 +13,7 @@
 #include "test-suite.h"
 #include <cmath>
 #include <cstdlib>
+#include <ctime>
 #include <iostream>
 #include <fstream>
 #include <string>
@@ -25,6 +26,8 @@
 #include "../Misc/PresetExtractor.h"
 #include "../Misc/PresetExtractor.cpp"
 #include "../Misc/Util.h"
+#include "../Params/ADnoteParameters.h"
+#include "../Params/LFOParams.h"
 #include "../globals.h"
 #include "../UI/NSM.H"
 using namespace std;
@@ -106,7 +109,7 @@ class MessageTest
 
             TS_ASSERT_EQUAL_STR("Poscilgen", mw->getPresetsStore().clipboard.type.c_str());
             // a regex would be better here...
-            // hopefully, mxml will not change its whitespace behavior
+            // hopefully, XMLwrapper will not change its whitespace behavior
             assert_non_null(strstr(mw->getPresetsStore().clipboard.data.c_str(), "<par name=\"base_function_par\" value=\"32\" />"),
                     "base_function_par at right value", __LINE__);
 
@@ -356,6 +359,142 @@ class MessageTest
             }
         }
 
+        void drainBackend(void)
+        {
+            while(ms->bToU->hasNext()) {
+                const char *msg = ms->bToU->read();
+                if(!strcmp(msg, "/free")
+                   && !strcmp(rtosc_argument(msg, 0).s, "Part"))
+                    delete *(Part**)rtosc_argument(msg, 1).b.data;
+            }
+        }
+
+        void testDispatchCache(void)
+        {
+            char buf[256];
+            //the first write walks the port tree, the second is cached
+            for(int val : {10, 20}) {
+                rtosc_message(buf, sizeof(buf), "/part0/Ppanning", "i", val);
+                ms->applyOscEvent(buf);
+                TS_ASSERT_EQUAL_INT(ms->part[0]->Ppanning, val);
+            }
+
+            //swapping the part must not leave entries for the old one
+            Part *p = new Part(*ms->memory, ms->synth, ms->time,
+                               config.cfg.GzipCompression,
+                               config.cfg.Interpolation,
+                               &ms->microtonal, ms->fft, &ms->watcher,
+                               "/part0/");
+            rtosc_message(buf, sizeof(buf), "/load-part", "ib", 0,
+                          sizeof(Part*), &p);
+            ms->applyOscEvent(buf);
+            TS_ASSERT(ms->part[0] == p);
+
+            rtosc_message(buf, sizeof(buf), "/part0/Ppanning", "i", 30);
+            ms->applyOscEvent(buf);
+            TS_ASSERT_EQUAL_INT(p->Ppanning, 30);
+            drainBackend();
+        }
+
+        //cached paths below array ports (slot#, param#) are called with
+        //their own indices, not with those of the last tree walk
+        void testDispatchCacheIndices(void)
+        {
+            char path[128], buf[256];
+            const unsigned hits = ms->dispatch_cache.hits;
+            for(int round = 0; round < 3; ++round)
+                for(int slot : {1, 2})
+                    for(int param : {0, 3}) {
+                        snprintf(path, sizeof(path),
+                                 "/automate/slot%d/param%d/mapping/offset",
+                                 slot, param);
+                        rtosc_message(buf, sizeof(buf), path, "f",
+                                      round * 10.0f + slot + param * 0.25f);
+                        ms->applyOscEvent(buf);
+                    }
+            drainBackend();
+            for(int slot : {1, 2})
+                for(int param : {0, 3})
+                    TS_ASSERT_DELTA(ms->automate.getSlotSubOffset(slot, param),
+                                    20.0f + slot + param * 0.25f, 1e-4);
+            TS_ASSERT_EQUAL_INT(ms->dispatch_cache.hits - hits, 8);
+
+            //a write which replaces no object keeps the cached paths
+            rtosc_message(buf, sizeof(buf), "/automate/learn-binding-same-slot",
+                          "s", "/part0/Ppanning");
+            ms->applyOscEvent(buf);
+            rtosc_message(buf, sizeof(buf), "/automate/slot1/param0/mapping/offset",
+                          "f", 5.0f);
+            ms->applyOscEvent(buf);
+            drainBackend();
+            TS_ASSERT_EQUAL_INT(ms->dispatch_cache.hits - hits, 9);
+            TS_ASSERT_DELTA(ms->automate.getSlotSubOffset(1, 0), 5.0f, 1e-4);
+        }
+
+        void testDispatchSpeed(void)
+        {
+            const char *path = "/part0/kit0/adpars/GlobalPar/AmpLfo/Pintensity";
+            const int   N    = 100000;
+            char write[256], read[256];
+            rtosc_message(read, sizeof(read), path, "");
+
+            //reads are never cached, they show the cost of the tree walk
+            int t_on = clock();
+            for(int i = 0; i < N; ++i) {
+                ms->applyOscEvent(read);
+                if(i % 64 == 63)
+                    drainBackend();
+            }
+            int t_walk = clock() - t_on;
+
+            t_on = clock();
+            for(int i = 0; i < N; ++i) {
+                rtosc_message(write, sizeof(write), path, "i", i % 128);
+                ms->applyOscEvent(write);
+                if(i % 64 == 63)
+                    drainBackend();
+            }
+            int t_cached = clock() - t_on;
+            drainBackend();
+
+            TS_ASSERT_EQUAL_INT(ms->part[0]->kit[0].adpars->GlobalPar.AmpLfo->Pintensity,
+                                (N - 1) % 128);
+            printf("MessageTest: %f us per tree walk, %f us per cached write\n",
+                   t_walk * 1e6 / CLOCKS_PER_SEC / N,
+                   t_cached * 1e6 / CLOCKS_PER_SEC / N);
+        }
+
+        void testOscBudget(void)
+        {
+            //without a budget, each cycle applies a single message and the
+            //next cycle continues with the rest
+            const int budget = config.cfg.OscBudget;
+            config.cfg.OscBudget = 0;
+            for(int i = 0; i < 3; ++i)
+                ms->uToB->write("/part0/Ppanning", "i", 10 + i);
+            for(int cycle = 1; cycle <= 3; ++cycle) {
+                ms->runOSC(NULL, NULL);
+                drainBackend();
+                TS_ASSERT_EQUAL_INT(ms->osc_stats.events, 1);
+                TS_ASSERT_EQUAL_INT(ms->part[0]->Ppanning, 9 + cycle);
+                TS_ASSERT_EQUAL_INT(ms->osc_stats.backlog,
+                                    cycle < 3 ? cycle : 0);
+            }
+            TS_ASSERT(!ms->uToB->hasNext());
+            TS_ASSERT_EQUAL_INT(ms->osc_stats.max_backlog, 2);
+
+            //offline processing drains a burst larger than the old limit of
+            //100 messages per cycle, however long it takes
+            for(int i = 0; i < 300; ++i)
+                ms->uToB->write("/part0/Ppanning", "i", i % 128);
+            ms->runOSC(NULL, NULL, true);
+            drainBackend();
+            TS_ASSERT(!ms->uToB->hasNext());
+            TS_ASSERT_EQUAL_INT(ms->osc_stats.events, 300);
+            TS_ASSERT_EQUAL_INT(ms->osc_stats.backlog, 0);
+            TS_ASSERT_EQUAL_INT(ms->part[0]->Ppanning, 299 % 128);
+            config.cfg.OscBudget = budget;
+        }
 
     private:
         SYNTH_T     *synth;
@@ -376,5 +515,9 @@ int main()
     RUN_TEST(testLfoPaste);
     RUN_TEST(testPadPaste);
     RUN_TEST(testFilterDepricated);
+    RUN_TEST(testDispatchCache);
+    RUN_TEST(testDispatchCacheIndices);
+    RUN_TEST(testDispatchSpeed);
+    RUN_TEST(testOscBudget);
     return test_summary();
 }
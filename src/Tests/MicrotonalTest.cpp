@@ -11,6 +11,7 @@
   of the License, or (at your option) any later version.
 */
 #include "test-suite.h"
+#include <cmath>
 #include <iostream>
 #include "../Misc/Microtonal.h"
 #include "../Misc/XMLwrapper.h"
@@ -98,6 +99,52 @@ class MicrotonalTest
             free(tmpo);
         }
 
+        //the NoteTable maps all notes like the scale and the mapping do
+        void testNoteTable() {
+            testMicro->Penabled = 1;
+            testMicro->texttotunings("9/8\n5/4\n4/3\n3/2\n5/3\n15/8\n2/1");
+            testMicro->texttomapping("0\nx\n1\nx\n2\n3\nx\n4\nx\n5\nx\n6");
+            testMicro->Pmappingenabled = 1;
+            testMicro->Pscaleshift = 66;
+            testMicro->changed();
+
+            float ref[128][5];
+            bool  mapped[128][5];
+            for(int note = 0; note < 128; ++note)
+                for(int k = 0; k < 5; ++k) {
+                    ref[note][k]    = note / 12.0f;
+                    mapped[note][k] = testMicro->updatenotefreq_log2(
+                            ref[note][k], k * 13 - 26);
+                }
+
+            delete testMicro->setTable(testMicro->buildTable());
+            TS_ASSERT(testMicro->buildTable() == NULL); //up to date
+            TS_ASSERT(!testMicro->tableOutdated());
+            int unmapped = 0;
+            for(int note = 0; note < 128; ++note)
+                for(int k = 0; k < 5; ++k) {
+                    float freq_log2 = note / 12.0f;
+                    TS_ASSERT_EQUAL_INT(mapped[note][k],
+                            testMicro->updatenotefreq_log2(freq_log2, k * 13 - 26));
+                    if(mapped[note][k])
+                        TS_ASSERT_DELTA(freq_log2, ref[note][k], 1e-5f);
+                    else
+                        unmapped++;
+                }
+            TS_ASSERT(unmapped > 0);
+
+            //a changed tuning does not use the outdated table
+            testMicro->PAfreq = 220.0f;
+            testMicro->Pmappingenabled = 0;
+            testMicro->Pscaleshift = 64;
+            testMicro->changed();
+            TS_ASSERT(testMicro->tableOutdated());
+            float freq_log2 = 69 / 12.0f;
+            TS_ASSERT(testMicro->updatenotefreq_log2(freq_log2, 0));
+            TS_ASSERT_DELTA(freq_log2, log2f(220.0f), 1e-5f);
+            delete testMicro->setTable(NULL);
+        }
+
 #if 0
         /**\todo Test Saving/loading from file*/
 
@@ -134,5 +181,6 @@ int main()
     MicrotonalTest test;
     RUN_TEST(testinit);
     RUN_TEST(testXML);
+    RUN_TEST(testNoteTable);
     return test_summary();
 }
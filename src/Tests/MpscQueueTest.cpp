@@ -0,0 +1,145 @@
+/*
+  ZynAddSubFX - a software synthesizer
+
+  MpscQueueTest.cpp - CxxTest for Nio/MpscQueue
+
+  This program is free software; you can redistribute it and/or
+  modify it under the terms of the GNU General Public License
+  as published by the Free Software Foundation; either version 2
+  of the License, or (at your option) any later version.
+*/
+#include "test-suite.h"
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include "../Nio/MpscQueue.h"
+
+using namespace std;
+using namespace zyn;
+
+#define WRITERS 4
+#define EVENTS  100000 //per writer
+
+struct Event {
+    int writer;
+    int num;
+};
+
+class MpscQueueTest
+{
+    public:
+        void setUp() {}
+        void tearDown() {}
+
+        void testBasic() {
+            MpscQueue<int> q(4, 4);
+            int v;
+            TS_ASSERT(q.empty());
+            TS_ASSERT_EQUAL_INT(q.pop(v), -1);
+            for(int i = 0; i < 4; ++i)
+                TS_ASSERT_EQUAL_INT(q.push(i), 0);
+            //full, the element is dropped
+            TS_ASSERT_EQUAL_INT(q.push(4), -1);
+            TS_ASSERT_EQUAL_INT((int)q.dropped(), 1);
+            for(int i = 0; i < 4; ++i) {
+                TS_ASSERT_EQUAL_INT(q.pop(v), 0);
+                TS_ASSERT_EQUAL_INT(v, i);
+            }
+            TS_ASSERT(q.empty());
+            //at the capacity limit the queue does not grow
+            TS_ASSERT(!q.grow());
+        }
+
+        void testBatch() {
+            MpscQueue<int> q(8, 8);
+            for(int i = 0; i < 6; ++i)
+                q.push(i);
+            int out[8];
+            TS_ASSERT_EQUAL_INT((int)q.read(out, 4), 4);
+            TS_ASSERT_EQUAL_INT(out[3], 3);
+            TS_ASSERT_EQUAL_INT((int)q.read(out, 8), 2);
+            TS_ASSERT_EQUAL_INT(out[1], 5);
+            TS_ASSERT_EQUAL_INT((int)q.read(out, 8), 0);
+        }
+
+        //the elements of the old ring are read before the ones of the new
+        void testGrow() {
+            MpscQueue<int> q(4, 64);
+            for(int i = 0; i < 5; ++i)
+                q.push(i);
+            TS_ASSERT(q.grow());
+            TS_ASSERT_EQUAL_INT((int)q.capacity(), 8);
+            for(int i = 5; i < 13; ++i)
+                TS_ASSERT_EQUAL_INT(q.push(i), 0);
+            int v;
+            for(int i = 0; i < 13; ++i) {
+                if(i == 4) //the dropped one
+                    continue;
+                TS_ASSERT_EQUAL_INT(q.pop(v), 0);
+                TS_ASSERT_EQUAL_INT(v, i);
+            }
+            TS_ASSERT(q.empty());
+            TS_ASSERT(!q.grow());
+        }
+
+        //writers, one reader and the growing thread at the same time: all
+        //elements which were not dropped arrive, in order per writer
+        void testThreads() {
+            MpscQueue<Event> q(16, 4096);
+            atomic<int> running(WRITERS);
+            vector<thread> writers;
+            for(int w = 0; w < WRITERS; ++w)
+                writers.push_back(thread([&q, &running, w]() {
+                    for(int i = 0; i < EVENTS; ++i) {
+                        Event ev = {w, i};
+                        q.push(ev);
+                        if(i % 32 == 0) //in bursts, like MIDI input
+                            this_thread::sleep_for(chrono::microseconds(10));
+                    }
+                    running--;
+                }));
+
+            int received = 0, misordered = 0;
+            thread reader([&]() {
+                int last[WRITERS];
+                for(int w = 0; w < WRITERS; ++w)
+                    last[w] = -1;
+                Event batch[64];
+                for(;;) {
+                    const bool done = running.load() == 0;
+                    size_t n = q.read(batch, 64);
+                    for(size_t i = 0; i < n; ++i) {
+                        if(batch[i].num <= last[batch[i].writer])
+                            misordered++;
+                        last[batch[i].writer] = batch[i].num;
+                    }
+                    received += n;
+                    if(done && !n && q.empty())
+                        break;
+                }
+            });
+
+            while(running.load())
+                q.grow();
+            for(auto &t:writers)
+                t.join();
+            reader.join();
+
+            TS_ASSERT_EQUAL_INT(misordered, 0);
+            TS_ASSERT_EQUAL_INT(received + (int)q.dropped(), WRITERS * EVENTS);
+            TS_ASSERT(received > 0);
+            printf("MpscQueueTest: %d elements received, %u dropped, capacity %d\n",
+                   received, q.dropped(), (int)q.capacity());
+        }
+};
+
+int main()
+{
+    MpscQueueTest test;
+    RUN_TEST(testBasic);
+    RUN_TEST(testBatch);
+    RUN_TEST(testGrow);
+    RUN_TEST(testThreads);
+    return test_summary();
+}
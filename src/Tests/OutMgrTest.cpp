@@ -0,0 +1,156 @@
+/*
+  ZynAddSubFX - a software synthesizer
+
+  OutMgrTest.cpp - CxxTest for the output ring of Nio/OutMgr
+
+  This program is free software; you can redistribute it and/or
+  modify it under the terms of the GNU General Public License
+  as published by the Free Software Foundation; either version 2
+  of the License, or (at your option) any later version.
+*/
+#include "test-suite.h"
+#include <cmath>
+#include <cstdlib>
+#include <vector>
+#include "../Misc/Config.h"
+#include "../Misc/Master.h"
+#include "../Misc/MiddleWare.h"
+#include "../Misc/Util.h"
+#include "../Nio/AudioOut.h"
+#include "../Nio/EngineMgr.h"
+#include "../Nio/OutMgr.h"
+#include "../globals.h"
+
+using namespace std;
+using namespace zyn;
+
+class NSM_Client *nsm = 0;
+MiddleWare *middleware = 0;
+char *instance_name=(char*)"";
+
+#define PERIODS 100
+
+//driver which is ticked by the test instead of a device
+class TestOut:public AudioOut
+{
+    public:
+        TestOut(const SYNTH_T &synth) :AudioOut(synth) {name = "TEST";}
+        bool Start() {return true;}
+        void Stop() {}
+        void setAudioEn(bool) {}
+        bool getAudioEn() const {return true;}
+};
+
+class OutMgrTest
+{
+    public:
+        void setUp() {
+            synth.buffersize = 256;
+            synth.samplerate = 48000;
+            synth.alias();
+
+            EngineMgr &eng = EngineMgr::getInstance(&synth);
+            if(!eng.getEng("TEST"))
+                eng.engines.push_back(new TestOut(synth));
+            out = dynamic_cast<TestOut *>(eng.getEng("TEST"));
+            out->setSamplerate(synth.samplerate);
+            OutMgr::getInstance(&synth).setSink("TEST");
+        }
+
+        void tearDown() {}
+
+        //random period length, also longer than the ring was before
+        static unsigned randomPeriod(void)
+        {
+            return 37 + rand() % (OUTMGR_MAX_PERIOD - 37 + 1);
+        }
+
+        //periods of any size give the same stream as the synth buffers
+        //rendered one after the other, delayed by less than one buffer
+        void testGapless() {
+            srand(0);
+            vector<unsigned> periods;
+            size_t total = 0;
+            for(int i = 0; i < PERIODS; ++i) {
+                periods.push_back(randomPeriod());
+                total += periods.back();
+            }
+
+            //the reference: the same note, rendered buffer by buffer
+            Master ref(synth, &config);
+            sprng(0);
+            ref.noteOn(0, 64, 100);
+            vector<float> refl(total + synth.buffersize);
+            vector<float> refr(total + synth.buffersize);
+            for(size_t i = 0; i + synth.buffersize <= refl.size();
+                i += synth.buffersize)
+                ref.AudioOut(&refl[i], &refr[i]);
+
+            Master master(synth, &config);
+            sprng(0);
+            master.noteOn(0, 64, 100);
+            OutMgr &outmgr = OutMgr::getInstance();
+            outmgr.setMaster(&master);
+
+            size_t pos = 0;
+            int mismatches = 0;
+            unsigned maxlatency = 0;
+            float peak = 0.0f;
+            for(unsigned n:periods) {
+                const Stereo<float *> smps = outmgr.tick(n);
+                for(unsigned i = 0; i < n; ++i, ++pos) {
+                    if(smps.l[i] != refl[pos] || smps.r[i] != refr[pos])
+                        mismatches++;
+                    peak = max(peak, fabsf(smps.l[i]));
+                }
+                maxlatency = max(maxlatency, outmgr.getLatency());
+            }
+            outmgr.setMaster(NULL);
+
+            TS_ASSERT_EQUAL_INT(mismatches, 0);
+            TS_ASSERT(peak > 0.01f);
+            TS_ASSERT(maxlatency < (unsigned)synth.buffersize);
+            printf("OutMgrTest: %d samples, latency up to %u\n",
+                   (int)total, maxlatency);
+        }
+
+        //a driver at 10 times the synth rate gets its periods in full and
+        //the ring does not overrun
+        void testResampled() {
+            const int ratio = 10;
+            out->setSamplerate(synth.samplerate * ratio);
+
+            Master master(synth, &config);
+            master.noteOn(0, 64, 100);
+            OutMgr &outmgr = OutMgr::getInstance();
+            outmgr.setMaster(&master);
+
+            unsigned maxlatency = 0;
+            float peak = 0.0f;
+            for(int p = 0; p < PERIODS; ++p) {
+                const unsigned n = randomPeriod();
+                const Stereo<float *> smps = outmgr.tick(n);
+                for(unsigned i = 0; i < n; ++i)
+                    peak = max(peak, fabsf(smps.l[i]));
+                maxlatency = max(maxlatency, outmgr.getLatency());
+            }
+            outmgr.setMaster(NULL);
+            out->setSamplerate(synth.samplerate);
+
+            TS_ASSERT(peak > 0.01f);
+            TS_ASSERT(maxlatency < (unsigned)(synth.buffersize * ratio));
+        }
+
+    private:
+        SYNTH_T  synth;
+        Config   config;
+        TestOut *out;
+};
+
+int main()
+{
+    OutMgrTest test;
+    RUN_TEST(testGapless);
+    RUN_TEST(testResampled);
+    return test_summary();
+}
@@ -0,0 +1,131 @@
+/*
+  ZynAddSubFX - a software synthesizer
+
+  OversamplerTest.cpp - CxxTest for DSP/Oversampler
+
+  This program is free software; you can redistribute it and/or
+  modify it under the terms of the GNU General Public License
+  as published by the Free Software Foundation; either version 2
+  of the License, or (at your option) any later version.
+*/
+#include "test-suite.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include "../DSP/Oversampler.h"
+#include "../Misc/Allocator.h"
+#include "../globals.h"
+
+using namespace std;
+using namespace zyn;
+
+#define SRATE  48000
+#define BUF    240
+#define BLOCKS 20 //4800 samples are analysed, a 10Hz resolution
+
+class OversamplerTest
+{
+    public:
+        void setUp() {}
+        void tearDown() {}
+
+        //sine at freq Hz, from sample start on
+        static void sine(float *smps, int n, float freq, int start)
+        {
+            for(int i = 0; i < n; ++i)
+                smps[i] = sinf(2.0f * PI * freq * (start + i) / SRATE);
+        }
+
+        static float clip(float x)
+        {
+            return x > 0.5f ? 0.5f : (x < -0.5f ? -0.5f : x);
+        }
+
+        //power of the signal at freq Hz
+        static float power(const float *smps, int n, float freq)
+        {
+            double re = 0.0, im = 0.0;
+            for(int i = 0; i < n; ++i) {
+                const double ph = 2.0 * M_PI * freq * i / SRATE;
+                re += smps[i] * cos(ph);
+                im += smps[i] * sin(ph);
+            }
+            return (re * re + im * im) / ((double)n * n);
+        }
+
+        //the round trip is a delay of getLatency() whole samples with a
+        //flat passband, so a dry signal can be aligned with it
+        void testLatency() {
+            const int expected[4] = {0, 31, 36, 39};
+            for(int o = 0; o < 4; ++o) {
+                Oversampler os(memory, 1 << o, BUF);
+                TS_ASSERT_EQUAL_INT(os.getFactor(), 1 << o);
+                TS_ASSERT_EQUAL_INT(os.getLatency(), expected[o]);
+
+                for(float freq : {1000.0f, 10000.0f, 18000.0f}) {
+                    os.cleanup();
+                    float smps[BUF], err = 0.0f;
+                    for(int b = 0; b < BLOCKS; ++b) {
+                        sine(smps, BUF, freq, b * BUF);
+                        os.up(smps, BUF);
+                        os.down(smps, BUF);
+                        if(b < 2)
+                            continue;
+                        float ref[BUF];
+                        sine(ref, BUF, freq, b * BUF - os.getLatency());
+                        for(int i = 0; i < BUF; ++i)
+                            err = max(err, fabsf(smps[i] - ref[i]));
+                    }
+                    TS_ASSERT(err < 0.02f);
+                }
+            }
+        }
+
+        //harmonics of a clipped 2010Hz sine above 24kHz fold back without
+        //oversampling, with it they are mostly filtered out first
+        void testAliasing() {
+            float alias[4];
+            for(int o = 0; o < 4; ++o) {
+                Oversampler os(memory, 1 << o, BUF);
+                float out[BUF * BLOCKS];
+                for(int b = 0; b < BLOCKS + 1; ++b) {
+                    float smps[BUF];
+                    sine(smps, BUF, 2010.0f, b * BUF);
+                    float *hi = os.up(smps, BUF);
+                    for(int i = 0; i < BUF * os.getFactor(); ++i)
+                        hi[i] = clip(hi[i]);
+                    os.down(smps, BUF);
+                    if(b) //skip the settling of the filters
+                        memcpy(out + (b - 1) * BUF, smps, sizeof(smps));
+                }
+
+                //power in the passband which is not at a harmonic, the
+                //half-band filters let some alias into 18-24kHz
+                const int n = BUF * BLOCKS;
+                float total = 0.0f, folded = 0.0f;
+                for(int i = 0; i < n; ++i)
+                    total += out[i] * out[i] / n;
+                for(int f = 10; f < 18000; f += 10)
+                    if(f % 2010)
+                        folded += 2.0f * power(out, n, f);
+                alias[o] = 10.0f * log10f(folded / total);
+                printf("OversamplerTest: %dx aliasing %.1f dB\n",
+                       1 << o, alias[o]);
+            }
+            TS_ASSERT(alias[0] > -40.0f);
+            for(int o = 1; o < 4; ++o)
+                TS_ASSERT(alias[o] < alias[o - 1]);
+            TS_ASSERT(alias[3] < alias[0] - 30.0f);
+        }
+
+    private:
+        AllocatorClass memory;
+};
+
+int main()
+{
+    OversamplerTest test;
+    RUN_TEST(testLatency);
+    RUN_TEST(testAliasing);
+    return test_summary();
+}
@@ -17,6 +17,7 @@
 #include <complex>
 #include <ctime>
 #include <string>
+#include <vector>
 #define private public
 #include "../Synth/PADnote.h"
 #undef private
@@ -27,6 +28,7 @@
 #include "../Synth/PADnote.h"
 #include "../Synth/OscilGen.h"
 #include "../Params/PADnoteParameters.h"
+#include "../Params/PADsampleStore.h"
 #include "../Params/Presets.h"
 #include "../DSP/FFTwrapper.h"
 #include "../globals.h"
@@ -83,19 +85,7 @@ class PadNoteTest
             //Assert defaults
             ///TS_ASSERT(!defaultPreset->VoicePar[1].Enabled);
 
-            XMLwrapper wrap;
-            //cout << string(SOURCE_DIR) + string("/guitar-adnote.xmz")
-            //     << endl;
-            wrap.loadXMLfile(string(SOURCE_DIR)
-                              + string("/guitar-adnote.xmz"));
-            TS_ASSERT(wrap.enterbranch("MASTER"));
-            TS_ASSERT(wrap.enterbranch("PART", 2));
-            TS_ASSERT(wrap.enterbranch("INSTRUMENT"));
-            TS_ASSERT(wrap.enterbranch("INSTRUMENT_KIT"));
-            TS_ASSERT(wrap.enterbranch("INSTRUMENT_KIT_ITEM", 0));
-            TS_ASSERT(wrap.enterbranch("PAD_SYNTH_PARAMETERS"));
-            pars->getfromXML(wrap);
-
+            loadParameters(pars);
 
             //defaultPreset->defaults();
             pars->applyparameters([]{return false;}, 1);
@@ -114,6 +104,21 @@ class PadNoteTest
             note = new PADnote(pars, pars_, interpolation);
         }
 
+        void loadParameters(PADnoteParameters *p) {
+            XMLwrapper wrap;
+            //cout << string(SOURCE_DIR) + string("/guitar-adnote.xmz")
+            //     << endl;
+            wrap.loadXMLfile(string(SOURCE_DIR)
+                              + string("/guitar-adnote.xmz"));
+            TS_ASSERT(wrap.enterbranch("MASTER"));
+            TS_ASSERT(wrap.enterbranch("PART", 2));
+            TS_ASSERT(wrap.enterbranch("INSTRUMENT"));
+            TS_ASSERT(wrap.enterbranch("INSTRUMENT_KIT"));
+            TS_ASSERT(wrap.enterbranch("INSTRUMENT_KIT_ITEM", 0));
+            TS_ASSERT(wrap.enterbranch("PAD_SYNTH_PARAMETERS"));
+            p->getfromXML(wrap);
+        }
+
         void tearDown() {
             delete note;
             delete controller;
@@ -276,8 +281,147 @@ class PadNoteTest
 
         }
 
+        //rms of the first buffers of a note with the given interpolation
+        float noteRms(PADnoteParameters *p, const int &mode) {
+            sprng(0);
+            SynthParams pars_{memory, *controller, *synth, *time, 120, 0,
+                              test_freq_log2, false, prng()};
+            PADnote *n = new PADnote(p, pars_, mode);
+            float sum = 0.0f;
+            for(int i = 0; i < 20; ++i) {
+                n->noteout(outL, outR);
+                for(int j = 0; j < synth->buffersize; ++j)
+                    sum += outL[j] * outL[j] + outR[j] * outR[j];
+            }
+            delete n;
+            return sqrtf(sum / (40 * synth->buffersize));
+        }
+
+        void testSincInterpolation() {
+            //all modes play the same smooth sample at the same level
+            const int linear = 0, cubic = 1, sinc = 2;
+            const float rms = noteRms(pars, cubic);
+            TS_ASSERT(rms > 0.0f);
+            TS_ASSERT_DELTA(noteRms(pars, linear) / rms, 1.0f, 0.05f);
+            TS_ASSERT_DELTA(noteRms(pars, sinc) / rms, 1.0f, 0.05f);
+        }
+
 #define OUTPUT_PROFILE
 #ifdef OUTPUT_PROFILE
+        void testSharedSamples() {
+            size_t buffers, bytes;
+            PADsampleStore::stats(buffers, bytes);
+            TS_ASSERT_EQUAL_INT(buffers, 8);
+
+            //another instance with the same spectra reuses all samples
+            PADnoteParameters *other = new PADnoteParameters(*synth, fft, time);
+            loadParameters(other);
+            other->applyparameters([]{return false;}, 1);
+            for(int i = 0; i < PAD_MAX_SAMPLES; ++i)
+                TS_ASSERT(other->sample[i].smp == pars->sample[i].smp);
+
+            size_t shared_buffers, shared_bytes;
+            PADsampleStore::stats(shared_buffers, shared_bytes);
+            TS_ASSERT_EQUAL_INT(shared_buffers, buffers);
+            TS_ASSERT_EQUAL_INT(shared_bytes, bytes);
+
+            //a changed spectrum gets samples of its own
+            other->Pbandwidth = pars->Pbandwidth > 500 ? 100 : 900;
+            other->applyparameters([]{return false;}, 1);
+            TS_ASSERT(other->sample[0].smp != pars->sample[0].smp);
+            PADsampleStore::stats(shared_buffers, shared_bytes);
+            TS_ASSERT_EQUAL_INT(shared_buffers, 2 * buffers);
+
+            //and the samples of pars outlive the other instance
+            const float first = pars->sample[0].smp[1];
+            delete other;
+            PADsampleStore::stats(shared_buffers, shared_bytes);
+            TS_ASSERT_EQUAL_INT(shared_buffers, buffers);
+            TS_ASSERT_EQUAL_FLT(pars->sample[0].smp[1], first);
+        }
+
+        //first samples of two instances computed in parallel, with
+        //spectra of their own
+        void parallelSamples(float *smps, int n) {
+            std::vector<PADnoteParameters *> two;
+            for(int i = 0; i < 2; ++i) {
+                two.push_back(new PADnoteParameters(*synth, fft, time));
+                loadParameters(two[i]);
+                two[i]->Pbandwidth = pars->Pbandwidth > 500 ? 100 + i
+                                                            : 900 + i;
+            }
+            sprng(42);
+            PADnoteParameters::applyparameters(two, []{return false;});
+            for(int i = 0; i < 2; ++i) {
+                TS_NON_NULL(two[i]->sample[0].smp);
+                memcpy(smps + i * n, two[i]->sample[0].smp,
+                       n * sizeof(float));
+                delete two[i];
+            }
+        }
+
+        //the instances draw from generators of their own, so the result
+        //does not depend on the order in which the workers run
+        void testParallelDeterministic() {
+            const int n = 64;
+            float first[2 * n], again[2 * n];
+            parallelSamples(first, n);
+            parallelSamples(again, n);
+            int mismatches = 0;
+            for(int i = 0; i < 2 * n; ++i)
+                mismatches += first[i] != again[i];
+            TS_ASSERT_EQUAL_INT(mismatches, 0);
+        }
+
+        void testCompactSamples() {
+            size_t buffers, bytes;
+            PADsampleStore::stats(buffers, bytes);
+
+            PADsampleStore::setCompact(true);
+            PADnoteParameters *compact = new PADnoteParameters(*synth, fft, time);
+            loadParameters(compact);
+            compact->applyparameters([]{return false;}, 1);
+            PADsampleStore::setCompact(false);
+
+            //same layout as the float samples at half the size
+            for(int i = 0; i < PAD_MAX_SAMPLES; ++i) {
+                TS_ASSERT(!compact->sample[i].smp);
+                TS_ASSERT_EQUAL_INT(compact->sample[i].valid(),
+                                    pars->sample[i].valid());
+                TS_ASSERT_EQUAL_INT(compact->sample[i].size,
+                                    pars->sample[i].size);
+            }
+            size_t compact_buffers, compact_bytes;
+            PADsampleStore::stats(compact_buffers, compact_bytes);
+            TS_ASSERT_EQUAL_INT(compact_buffers, 2 * buffers);
+            TS_ASSERT_EQUAL_INT(2 * compact_bytes, 3 * bytes);
+
+            //the peak is at full scale
+            const PADnoteParameters::Sample &smp = compact->sample[0];
+            int peak = 0;
+            for(int i = 0; i < smp.size; ++i)
+                peak = std::max(peak, abs(smp.smp16[i]));
+            TS_ASSERT_EQUAL_INT(peak, 32767);
+            TS_ASSERT_DELTA(smp.value(1), smp.smp16[1] * smp.scale, 1e-6f);
+
+            //and notes play from the compact samples
+            SynthParams pars_{memory, *controller, *synth, *time, 120, 0,
+                              test_freq_log2, false, prng()};
+            PADnote *compact_note = new PADnote(compact, pars_, interpolation);
+            float sum = 0.0f;
+            for(int i = 0; i < 10; ++i) {
+                compact_note->noteout(outL, outR);
+                for(int j = 0; j < synth->buffersize; ++j)
+                    sum += fabsf(outL[j]) + fabsf(outR[j]);
+            }
+            TS_ASSERT(sum > 0.0f);
+
+            delete compact_note;
+            delete compact;
+            PADsampleStore::stats(compact_buffers, compact_bytes);
+            TS_ASSERT_EQUAL_INT(compact_buffers, buffers);
+        }
+
         void testSpeed() {
             const int samps = 15000;
 
@@ -289,6 +433,35 @@ class PadNoteTest
             printf("PadNoteTest: %f seconds for %d Samples to be generated.\n",
                    (static_cast<float>(t_off - t_on)) / CLOCKS_PER_SEC, samps);
         }
+
+        void testInterpolationSpeed() {
+            const int   samps    = 15000;
+            const char *modes[3] = {"linear", "cubic", "sinc"};
+
+            PADsampleStore::setCompact(true);
+            PADnoteParameters *compact = new PADnoteParameters(*synth, fft, time);
+            loadParameters(compact);
+            compact->applyparameters([]{return false;}, 1);
+            PADsampleStore::setCompact(false);
+
+            for(int mode = 0; mode < 3; ++mode)
+                for(int c = 0; c < 2; ++c) {
+                    SynthParams pars_{memory, *controller, *synth, *time, 120,
+                                      0, test_freq_log2, false, prng()};
+                    PADnote *n = new PADnote(c ? compact : pars, pars_, mode);
+
+                    int t_on = clock();
+                    for(int i = 0; i < samps; ++i)
+                        n->noteout(outL, outR);
+                    int t_off = clock();
+
+                    printf("PadNoteTest: %f seconds for %d %s %s buffers.\n",
+                           (static_cast<float>(t_off - t_on)) / CLOCKS_PER_SEC,
+                           samps, modes[mode], c ? "int16" : "float");
+                    delete n;
+                }
+            delete compact;
+        }
 #endif
 };
 
@@ -297,6 +470,11 @@ int main()
     PadNoteTest test;
     RUN_TEST(testDefaults);
     RUN_TEST(testInitialization);
+    RUN_TEST(testSharedSamples);
+    RUN_TEST(testCompactSamples);
+    RUN_TEST(testParallelDeterministic);
+    RUN_TEST(testSincInterpolation);
     RUN_TEST(testSpeed);
+    RUN_TEST(testInterpolationSpeed);
     return test_summary();
 }
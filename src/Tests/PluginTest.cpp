@@ -13,14 +13,18 @@
 #include "test-suite.h"
 #include <cmath>
 #include <cstdlib>
+#include <cstring>
 #include <iostream>
 #include <fstream>
 #include <string>
 #include "../Misc/MiddleWare.h"
 #include "../Misc/Master.h"
+#include "../Misc/Part.h"
 #include "../Misc/PresetExtractor.h"
 #include "../Misc/PresetExtractor.cpp"
 #include "../Misc/Util.h"
+#include "../Effects/Chorus.h"
+#include "../Plugin/BlockFifo.hpp"
 #include "../globals.h"
 #include "../UI/NSM.H"
 
@@ -217,6 +221,65 @@ class PluginTest
             TS_ASSERT(0.1f < sum);
         }
 
+        //the parts render into the given buffers, their own stay untouched
+        void testPartOutputs()
+        {
+            float *ownl = master[0]->part[0]->partoutl;
+            float *ownr = master[0]->part[0]->partoutr;
+            float *partl[NUM_MIDI_PARTS], *partr[NUM_MIDI_PARTS];
+            for(int i = 0; i < NUM_MIDI_PARTS; ++i) {
+                partl[i] = new float[synth->buffersize];
+                partr[i] = new float[synth->buffersize];
+            }
+
+            master[0]->noteOn(0,64,64);
+            master[0]->AudioOut(outL, outR);
+            memset(ownl, 0, synth->bufferbytes);
+            master[0]->AudioOut(outL, outR, partl, partr);
+
+            TS_ASSERT(master[0]->part[0]->partoutl == ownl);
+            TS_ASSERT(master[0]->part[0]->partoutr == ownr);
+            float peak = 1.0e-12f, own = 0.0f;
+            for(int i = 0; i < synth->buffersize; ++i) {
+                peak = max(peak, fabsf(partl[0][i]));
+                own += fabsf(ownl[i]);
+            }
+            TS_ASSERT(peak > 0.01f);
+            TS_ASSERT_DELTA(peak, master[0]->vuoutpeakpartl[0], 1e-7f);
+            TS_ASSERT(own == 0.0f);
+
+            for(int i = 0; i < NUM_MIDI_PARTS; ++i) {
+                delete [] partl[i];
+                delete [] partr[i];
+            }
+        }
+
+        //disabled parts give silence, whatever was in the given buffers
+        void testDisabledPartOutputs()
+        {
+            float *partl[NUM_MIDI_PARTS], *partr[NUM_MIDI_PARTS];
+            for(int i = 0; i < NUM_MIDI_PARTS; ++i) {
+                partl[i] = new float[synth->buffersize];
+                partr[i] = new float[synth->buffersize];
+            }
+
+            TS_ASSERT(!master[0]->part[1]->Penabled);
+            for(int cycle = 0; cycle < 3; ++cycle) {
+                for(int i = 0; i < synth->buffersize; ++i)
+                    partl[1][i] = partr[1][i] = 1.0f;
+                master[0]->AudioOut(outL, outR, partl, partr);
+                float sum = 0.0f;
+                for(int i = 0; i < synth->buffersize; ++i)
+                    sum += fabsf(partl[1][i]) + fabsf(partr[1][i]);
+                TS_ASSERT(sum == 0.0f);
+            }
+
+            for(int i = 0; i < NUM_MIDI_PARTS; ++i) {
+                delete [] partl[i];
+                delete [] partr[i];
+            }
+        }
+
         string loadfile(string fname) const
         {
             std::ifstream t(fname.c_str());
@@ -243,6 +306,96 @@ class PluginTest
         }
 
 
+        //Run a chorus like the DPF effect plugins do (see AbstractFX.hpp),
+        //with host blocks of the given sizes, repeated up to frames
+        //@returns the latency after each host block
+        vector<uint32_t> runEffectPlugin(const vector<uint32_t> &sizes,
+                                         const float *inl, const float *inr,
+                                         float *outl, float *outr,
+                                         uint32_t frames)
+        {
+            const uint32_t block = 64;
+            float efxoutl[block], efxoutr[block];
+            AllocatorClass alloc;
+            EffectParams pars{alloc, false, efxoutl, efxoutr, 0, 48000,
+                              (int)block, nullptr};
+            Chorus    chorus(pars);
+            BlockFifo fifo(block);
+            auto processBlock = [&](const float *il, const float *ir,
+                                    float *ol, float *orr) {
+                chorus.out(Stereo<float *>((float *)il, (float *)ir));
+                for(uint32_t i = 0; i < block; ++i) {
+                    ol[i]  = (il[i] + efxoutl[i]) * 0.5f;
+                    orr[i] = (ir[i] + efxoutr[i]) * 0.5f;
+                }
+            };
+
+            vector<uint32_t> latency;
+            for(uint32_t pos = 0, k = 0; pos < frames; ++k) {
+                const uint32_t n = min(sizes[k % sizes.size()], frames - pos);
+                const float *in[2] = {inl + pos, inr + pos};
+                float *out[2]      = {outl + pos, outr + pos};
+                fifo.process(in, out, n, processBlock);
+                latency.push_back(fifo.getLatency());
+                pos += n;
+            }
+            TS_ASSERT_EQUAL_INT(fifo.getBlockSize(), block);
+            fifo.reset();
+            TS_ASSERT_EQUAL_INT(fifo.getLatency(), 0);
+            return latency;
+        }
+
+        //odd and varying host block sizes give the output of one whole
+        //block, delayed by the reported latency from the first odd block
+        void testEffectPluginBlocks()
+        {
+            const uint32_t frames = 64 * 100;
+            vector<float> inl(frames), inr(frames);
+            for(uint32_t i = 0; i < frames; ++i) {
+                inl[i] = sinf(i * 0.05f) + 0.3f * sinf(i * 0.71f);
+                inr[i] = cosf(i * 0.03f);
+            }
+
+            vector<float> refl(frames), refr(frames);
+            vector<uint32_t> whole = runEffectPlugin({frames}, &inl[0],
+                                                     &inr[0], &refl[0],
+                                                     &refr[0], frames);
+            TS_ASSERT_EQUAL_INT(whole[0], 0);
+            float wet = 0.0f;
+            for(uint32_t i = 0; i < frames; ++i)
+                wet += fabsf(refl[i] - inl[i] * 0.5f);
+            TS_ASSERT(wet > 1.0f);
+
+            //multiples of the effect block stay in place
+            vector<float> outl(frames), outr(frames);
+            vector<uint32_t> latency = runEffectPlugin({64, 128, 192}, &inl[0],
+                                                       &inr[0], &outl[0],
+                                                       &outr[0], frames);
+            int mismatches = 0;
+            for(uint32_t l:latency)
+                mismatches += l != 0;
+            for(uint32_t i = 0; i < frames; ++i)
+                mismatches += outl[i] != refl[i] || outr[i] != refr[i];
+            TS_ASSERT_EQUAL_INT(mismatches, 0);
+
+            //the first odd block switches to the FIFO for good
+            const vector<uint32_t> sizes = {64, 128, 100, 37, 1, 256, 63};
+            latency = runEffectPlugin(sizes, &inl[0], &inr[0], &outl[0],
+                                      &outr[0], frames);
+            const uint32_t odd = 64 + 128, delay = 64;
+            mismatches = 0;
+            for(size_t k = 0; k < latency.size(); ++k)
+                mismatches += latency[k] != (k < 2 ? 0 : delay);
+            for(uint32_t i = 0; i < odd; ++i)
+                mismatches += outl[i] != refl[i] || outr[i] != refr[i];
+            for(uint32_t i = odd; i < odd + delay; ++i)
+                mismatches += outl[i] != 0.0f || outr[i] != 0.0f;
+            for(uint32_t i = odd + delay; i < frames; ++i)
+                mismatches += outl[i] != refl[i - delay]
+                              || outr[i] != refr[i - delay];
+            TS_ASSERT_EQUAL_INT(mismatches, 0);
+        }
+
     private:
         float *outR, *outL;
         Master *master[16];
@@ -253,6 +406,9 @@ int main()
     PluginTest test;
     RUN_TEST(testInit);
     RUN_TEST(testPanic);
+    RUN_TEST(testPartOutputs);
+    RUN_TEST(testDisabledPartOutputs);
     RUN_TEST(testLoadSave);
+    RUN_TEST(testEffectPluginBlocks);
     return test_summary();
 }
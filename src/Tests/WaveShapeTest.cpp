@@ -0,0 +1,250 @@
+/*
+  ZynAddSubFX - a software synthesizer
+
+  WaveShapeTest.cpp - CxxTest for the approximations of Misc/WaveShapeSmps
+
+  This program is free software; you can redistribute it and/or
+  modify it under the terms of the GNU General Public License
+  as published by the Free Software Foundation; either version 2
+  of the License, or (at your option) any later version.
+*/
+#include "test-suite.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <limits>
+#include "../Misc/WaveShapeSmps.h"
+#include "../Misc/Util.h"
+
+using namespace std;
+using namespace zyn;
+
+#define STEPS 1000000
+
+class WaveShapeTest
+{
+    public:
+        void setUp() {}
+        void tearDown() {}
+
+        //x from lo to hi in STEPS steps
+        static float at(float lo, float hi, int i)
+        {
+            return lo + (hi - lo) * i / STEPS;
+        }
+
+        //the error bounds which are documented in WaveShapeSmps.h and Util.h
+        void testExp2() {
+            double err = 0.0;
+            for(int i = 0; i <= STEPS; ++i) {
+                const float  x   = at(-126.0f, 126.0f, i);
+                const double ref = exp2((double)x);
+                err = max(err, fabs(fast_exp2f(x) - ref) / ref);
+            }
+            printf("WaveShapeTest: fast_exp2f relative error %g\n", err);
+            TS_ASSERT(err < 2.4e-7);
+        }
+
+        void testLog2() {
+            double err = 0.0;
+            for(int i = 0; i <= STEPS; ++i) {
+                const float x = at(0.25f, 4.0f, i);
+                err = max(err, fabs(ws_log2(x) - log2((double)x)));
+            }
+            printf("WaveShapeTest: ws_log2 error %g\n", err);
+            TS_ASSERT(err < 1.5e-7);
+        }
+
+        void testSin() {
+            double err = 0.0;
+            for(int i = 0; i <= STEPS; ++i) {
+                const float x = at(-200.0f, 200.0f, i);
+                err = max(err, fabs(ws_sin(x) - sin((double)x)));
+            }
+            printf("WaveShapeTest: ws_sin error %g\n", err);
+            TS_ASSERT(err < 1.7e-7);
+        }
+
+        void testAtan() {
+            double err = 0.0;
+            for(int i = 0; i <= STEPS; ++i) {
+                for(float x : {at(-1.0f, 1.0f, i), at(-1000.0f, 1000.0f, i)})
+                    err = max(err, fabs(ws_atan(x) - atan((double)x)));
+            }
+            printf("WaveShapeTest: ws_atan error %g\n", err);
+            TS_ASSERT(err < 1.8e-7);
+        }
+
+        //the scalar formulas of waveShapeSmps() before it was vectorized,
+        //in double precision
+        static double refShape(double x, int type, int drive, int offset,
+                               int funcpar)
+        {
+            double ws = drive / 127.0, par = funcpar / 127.0,
+                   offs = (offset - 64.0) / 64.0, tmpv, tmp;
+            switch(type) {
+                case 1:
+                    ws = pow(10, ws * ws * 3.0) - 1.0 + 0.001;
+                    return atan((x + offs) * ws) / atan(ws) - offs;
+                case 2:
+                    ws   = ws * ws * 32.0 + 0.0001;
+                    tmpv = ws < 1.0 ? sin(ws) + 0.1 : 1.1;
+                    return sin(x * (0.1 + ws - ws * x)) / tmpv;
+                case 3:
+                    ws  = ws * ws * ws * 20.0 + 0.0001;
+                    tmp = x * ws;
+                    if(fabs(tmp) >= 1.0)
+                        return 0.0;
+                    return (tmp - tmp * tmp * tmp) * 3.0 / (ws < 1.0 ? ws : 1.0);
+                case 4:
+                    ws = ws * ws * ws * 32.0 + 0.0001;
+                    return sin(x * ws) / (ws < 1.57 ? sin(ws) : 1.0);
+                case 5:
+                    ws = ws * ws + 0.000001;
+                    return floor(x / ws + 0.5) * ws;
+                case 6:
+                    ws = ws * ws * ws * 32 + 0.0001;
+                    return asin(sin(x * ws)) / (ws < 1.0 ? sin(ws) : 1.0);
+                case 7: {
+                    ws  = pow(2.0, -ws * ws * 8.0);
+                    par = par / 4;
+                    if(par > ws - 0.01)
+                        par = ws - 0.01;
+                    x += offs;
+                    double res = polyblampres(x, ws, par);
+                    if(x >= 0)
+                        x = x > ws ? ws - res : x - res;
+                    else
+                        x = x < -ws ? -ws + res : x + res;
+                    res = polyblampres(offs, ws, par);
+                    if(offs >= 0)
+                        x -= offs >= ws ? ws - res : offs - res;
+                    else
+                        x -= offs <= -ws ? -ws + res : offs + res;
+                    return x / ws;
+                }
+                case 8:
+                    ws = pow(2.0, -ws * ws * 8.0);
+                    return (x > ws ? ws : x) * 2.0;
+                case 9:
+                    ws = pow(2.0, -ws * ws * 8.0);
+                    return (x < -ws ? -ws : x) * 2.0;
+                case 10: {
+                    ws = (pow(2.0, ws * 6.0) - 1.0) / pow(2.0, 6.0);
+                    if(par > ws - 0.01)
+                        par = ws - 0.01;
+                    x += offs;
+                    const double res = polyblampres(x, ws, par);
+                    if(x >= 0)
+                        x = x > ws ? x - ws + res : res;
+                    else
+                        x = x < -ws ? x + ws - res : -res;
+                    return x - offs;
+                }
+                case 11:
+                    ws = pow(5, ws * ws) - 1.0;
+                    tmp = x * (ws + 0.5) * 0.9999;
+                    return tmp - floor(0.5 + tmp);
+                case 12:
+                    ws  = ws * ws * ws * 30 + 0.001;
+                    tmp = x * ws;
+                    if(tmp <= -2.0 || tmp >= 1.0)
+                        return 0.0;
+                    return tmp * (1.0 - tmp) * (tmp + 2.0) / (ws < 0.3 ? ws : 1.0);
+                case 13:
+                    ws  = ws * ws * ws * 32.0 + 0.0001;
+                    tmp = x * ws;
+                    if(tmp > -1.0 && tmp < 1.618034)
+                        return tmp * (1.0 - tmp) / (ws < 1.0 ? ws * (1 + ws) / 2.0 : 1.0);
+                    return tmp > 0.0 ? -1.0 : -2.0;
+                case 14: {
+                    ws   = pow(ws, 5.0) * 80.0 + 0.0001;
+                    tmpv = ws > 10.0 ? 0.5 : 0.5 - 1.0 / (exp(ws) + 1.0);
+                    tmp  = max(-10.0, min(10.0, (x + offs) * ws));
+                    const double tmpo = max(-10.0, min(10.0, offs * ws));
+                    return (0.5 - 1.0 / (exp(tmp) + 1.0)) / tmpv
+                           - (0.5 - 1.0 / (exp(tmpo) + 1.0)) / tmpv;
+                }
+                case 15:
+                    par = 20.0 * par * par + 0.1 * par + 1.0;
+                    ws  = ws * ws * 35.0 + 1.0;
+                    x   = x * ws + offs;
+                    return x / pow(1 + pow(fabs(x), par), 1 / par)
+                           - offs / pow(1 + pow(fabs(offs), par), 1 / par);
+                case 16:
+                    ws = ws * ws * ws * 20.0 + 0.168;
+                    x  = x * ws + offs;
+                    x  = fabs(x) < 1.0 ? 1.5 * (x - x * x * x / 3.0)
+                                       : (x > 0 ? 1.0 : -1.0);
+                    return x - 1.5 * (offs - offs * offs * offs / 3.0);
+                case 17:
+                    ws = ws * ws * ws * 20.0 + 0.168;
+                    x  = x * ws + offs;
+                    x  = fabs(x) < 1.0 ? x * (2 - fabs(x)) : (x > 0 ? 1.0 : -1.0);
+                    return x - offs * (2 - fabs(offs));
+            }
+            return x;
+        }
+
+        //all shapes follow their formulas over a grid of the parameters
+        //and of the input amplitude, also where they saturate
+        void testShapes() {
+            const int n = 2001;
+            for(int type = 1; type < 18; ++type) {
+                double err = 0.0;
+                for(int drive : {0, 1, 16, 32, 64, 100, 126, 127})
+                    for(int offset : {0, 32, 64, 96, 127})
+                        for(int funcpar : {0, 32, 127})
+                            for(float amp : {0.1f, 0.5f, 1.0f, 2.0f, 4.0f}) {
+                                float in[n], out[n];
+                                for(int i = 0; i < n; ++i)
+                                    in[i] = out[i] = amp * (2.0f * i / (n - 1) - 1.0f);
+                                waveShapeSmps(n, out, type, drive, offset, funcpar);
+                                for(int i = 0; i < n; ++i)
+                                    err = max(err, fabs(out[i] - refShape(in[i],
+                                                    type, drive, offset, funcpar)));
+                            }
+                printf("WaveShapeTest: type %d error %g\n", type, err);
+                //the float argument of the periodic shapes at drive 127
+                //limits them to about 7e-5
+                TS_ASSERT(err < 1e-4);
+            }
+        }
+
+        //the integer conversion is limited, a NaN or a huge sample must
+        //not overflow it
+        void testFloorLimits() {
+            TS_ASSERT_EQUAL_INT(ws_floor(2.5f), 2);
+            TS_ASSERT_EQUAL_INT(ws_floor(-2.5f), -3);
+            TS_ASSERT_EQUAL_INT(ws_floor(-3.0f), -3);
+            TS_ASSERT_EQUAL_INT(ws_floor(1e20f), 1 << 30);
+            TS_ASSERT_EQUAL_INT(ws_floor(-1e20f), -(1 << 30));
+            const float nan = numeric_limits<float>::quiet_NaN();
+            TS_ASSERT_EQUAL_INT(ws_floor(nan), -(1 << 30));
+            TS_ASSERT_EQUAL_FLT(fast_exp2f(nan), fast_exp2f(-126.0f));
+
+            //and the shapes which use it pass such samples on without
+            //overflowing, all types and drives
+            float smps[4];
+            for(int type = 1; type < 18; ++type)
+                for(int drive : {1, 64, 127}) {
+                    smps[0] = 1e20f;
+                    smps[1] = -1e20f;
+                    smps[2] = nan;
+                    smps[3] = 0.5f;
+                    waveShapeSmps(4, smps, type, drive);
+                }
+        }
+};
+
+int main()
+{
+    WaveShapeTest test;
+    RUN_TEST(testExp2);
+    RUN_TEST(testLog2);
+    RUN_TEST(testSin);
+    RUN_TEST(testAtan);
+    RUN_TEST(testShapes);
+    RUN_TEST(testFloorLimits);
+    return test_summary();
+}
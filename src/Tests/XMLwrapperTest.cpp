@@ -13,6 +13,11 @@
 #include "test-suite.h"
 #include "../Misc/XMLwrapper.h"
 #include <string>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <vector>
 #include "../globals.h"
 using namespace std;
 using namespace zyn;
@@ -51,6 +56,118 @@ version-revision=\"1\" ZynAddSubFX-author=\"Nasca Octavian Paul\">\n\
             xmlb->putXMLdata(dat.c_str());
         }
 
+        void testBinary()
+        {
+            xmla->beginbranch("INSTRUMENT");
+            xmla->addpar("Pvolume", 96);
+            xmla->addparreal("freq", 440.25f);
+            xmla->addparbool("enabled", 1);
+            xmla->addparstr("name", "a <name> & \"quotes\"");
+            xmla->beginbranch("KIT_ITEM", 3);
+            xmla->addpar("Pminkey", -5);
+            xmla->endbranch();
+            xmla->endbranch();
+
+            const string xml = "/tmp/zyn-xmlwrapper-test.xiz";
+            const string bin = "/tmp/zyn-xmlwrapper-test.bin";
+            TS_ASSERT_EQUAL_INT(xmla->saveXMLfile(xml, 0), 0);
+            TS_ASSERT_EQUAL_INT(xmla->saveBinaryfile(bin), 0);
+
+            //both formats load into the same tree
+            XMLwrapper fromxml;
+            TS_ASSERT_EQUAL_INT(fromxml.loadXMLfile(xml), 0);
+            TS_ASSERT_EQUAL_INT(xmlb->loadXMLfile(bin), 0);
+            char *a = fromxml.getXMLdata(), *b = xmlb->getXMLdata();
+            TS_ASSERT(!strcmp(a, b));
+            free(a);
+            free(b);
+
+            TS_ASSERT(xmlb->enterbranch("INSTRUMENT"));
+            TS_ASSERT_EQUAL_INT(xmlb->getpar127("Pvolume", 0), 96);
+            TS_ASSERT_EQUAL_FLT(xmlb->getparreal("freq", 0), 440.25f);
+            TS_ASSERT_EQUAL_INT(xmlb->getparbool("enabled", 0), 1);
+            TS_ASSERT_EQUAL_CPP(xmlb->getparstr("name", ""),
+                                string("a <name> & \"quotes\""));
+            TS_ASSERT(xmlb->enterbranch("KIT_ITEM", 3));
+            TS_ASSERT_EQUAL_INT(xmlb->getpar("Pminkey", 0, -10, 10), -5);
+
+            //truncated files are rejected
+            FILE *f = fopen(bin.c_str(), "rb");
+            char data[4096];
+            const int len = fread(data, 1, sizeof(data), f);
+            fclose(f);
+            f = fopen(bin.c_str(), "wb");
+            fwrite(data, 1, len - 2, f);
+            fclose(f);
+            XMLwrapper truncated;
+            TS_ASSERT(truncated.loadXMLfile(bin) < 0);
+
+            remove(xml.c_str());
+            remove(bin.c_str());
+        }
+
+        //empty strings keep the open and close tag of the mxml layout and,
+        //as with mxml, read back as having no text
+        void testEmptyString()
+        {
+            xmla->addparstr("comment", "");
+            char *data = xmla->getXMLdata();
+            TS_NON_NULL(strstr(data, "<string name=\"comment\"></string>"));
+            TS_ASSERT(xmlb->putXMLdata(data));
+            free(data);
+            TS_ASSERT_EQUAL_CPP(xmlb->getparstr("comment", "default"),
+                                string("default"));
+        }
+
+        //prints the time to parse a master file and to look up parameters
+        //in a wide branch
+        void testParseSpeed()
+        {
+            string location = string(SOURCE_DIR) + string(
+                "/Tests/guitar-adnote.xmz");
+            TS_ASSERT_EQUAL_INT(xmla->loadXMLfile(location), 0);
+            char *data = xmla->getXMLdata();
+
+            const int loads  = 200;
+            int       failed = 0;
+            int       t_on   = clock();
+            for(int i = 0; i < loads; ++i)
+                failed += !xmlb->putXMLdata(data);
+            int t_load = clock() - t_on;
+            TS_ASSERT_EQUAL_INT(failed, 0);
+            free(data);
+
+            TS_ASSERT(xmlb->enterbranch("MASTER"));
+            TS_ASSERT(xmlb->enterbranch("PART", 0));
+            TS_ASSERT(xmlb->enterbranch("INSTRUMENT"));
+            TS_ASSERT(xmlb->enterbranch("INSTRUMENT_KIT"));
+            TS_ASSERT(xmlb->enterbranch("INSTRUMENT_KIT_ITEM", 15));
+            TS_ASSERT_EQUAL_INT(xmlb->getbranchid(0, 0), 15);
+
+            const int      pars = 1024;
+            vector<string> names;
+            xmla->beginbranch("WIDE");
+            for(int i = 0; i < pars; ++i) {
+                names.push_back("par" + to_string(i));
+                xmla->addpar(names.back(), i);
+            }
+            xmla->endbranch();
+            TS_ASSERT(xmla->enterbranch("WIDE"));
+
+            const int repeats = 100;
+            int       wrong   = 0;
+            t_on = clock();
+            for(int j = 0; j < repeats; ++j)
+                for(int i = 0; i < pars; ++i)
+                    wrong += xmla->getpar(names[i], -1, -1, pars) != i;
+            int t_lookup = clock() - t_on;
+            TS_ASSERT_EQUAL_INT(wrong, 0);
+
+            printf("XMLwrapperTest: %f ms per load, %f us per lookup\n",
+                   1000.0 * t_load / CLOCKS_PER_SEC / loads,
+                   1000000.0 * t_lookup / CLOCKS_PER_SEC / (repeats * pars));
+        }
+
         void tearDown() {
             delete xmla;
             delete xmlb;
@@ -68,6 +185,9 @@ int main()
     RUN_TEST(testAddPar);
     RUN_TEST(testLoad);
     RUN_TEST(testAnotherLoad);
+    RUN_TEST(testBinary);
+    RUN_TEST(testEmptyString);
+    RUN_TEST(testParseSpeed);
     return test_summary();
 }
 
@@ -13,6 +13,7 @@
 */
 
 #include "Misc/Util.h"
+#include "Misc/Denormal.h"
 #include "globals.h"
 
 namespace zyn {
@@ -27,12 +28,40 @@ void SYNTH_T::alias(bool randomize)
     //produce denormal buf
     // note: once there will be more buffers, use a cleanup function
     // for deleting the buffers and also call it in the dtor
+    // with FLUSH_DENORMALS the FPU takes care of denormals, so keep it silent
     denormalkillbuf.resize(buffersize);
     for(int i = 0; i < buffersize; ++i)
-        if(randomize)
+        if(randomize && !FLUSH_DENORMALS)
             denormalkillbuf[i] = (RND - 0.5f) * 1e-16;
         else
             denormalkillbuf[i] = 0;
 }
 
+int SYNTH_T::notebuffersize(void) const
+{
+    if(controlperiod <= 0 || controlperiod >= buffersize)
+        return buffersize;
+    int size = controlperiod;
+    while(buffersize % size)
+        --size;
+    if(2 * size >= controlperiod)
+        return size;
+    for(size = controlperiod + 1; buffersize % size; ++size)
+        ;
+    return size;
+}
+
+SYNTH_T SYNTH_T::noteSynth(void) const
+{
+    SYNTH_T res;
+    res.samplerate    = samplerate;
+    res.buffersize    = notebuffersize();
+    res.oscilsize     = oscilsize;
+    res.controlperiod = controlperiod;
+    res.alias(false);
+    for(int i = 0; i < res.buffersize; ++i)
+        res.denormalkillbuf[i] = denormalkillbuf[i];
+    return res;
+}
+
 }
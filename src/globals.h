@@ -59,6 +59,7 @@ class  FilterParams;
 struct WatchManager;
 class  LFO;
 class  Envelope;
+class  ModulatorBank;
 class  OscilGen;
 
 class  Controller;
@@ -198,6 +199,12 @@ typedef std::complex<fftwf_real> fft_t;
 #define MAX_ENVELOPE_POINTS 40
 #define MIN_ENVELOPE_DB -400
 
+/*
+ * Default number of samples between two updates of the envelopes and LFOs
+ * (see SYNTH_T::controlperiod)
+ */
+#define CONTROL_PERIOD 32
+
 /*
  * The threshold for the amplitude interpolation used if the amplitude
  * is changed (by LFO's or Envelope's). If the change of the amplitude
@@ -309,7 +316,7 @@ public:
 struct SYNTH_T {
 
     SYNTH_T(void)
-        :samplerate(44100), buffersize(256), oscilsize(1024)
+        :samplerate(44100), buffersize(256), oscilsize(1024), controlperiod(0)
     {
         alias(false);
     }
@@ -319,7 +326,8 @@ struct SYNTH_T {
     SYNTH_T& operator=(const SYNTH_T& ) = delete;
     SYNTH_T& operator=(SYNTH_T&& ) = default;
 
-    /** the buffer to add noise in order to avoid denormalisation */
+    /** the buffer to add noise in order to avoid denormalisation
+     *  (all zero when built with FLUSH_DENORMALS) */
     m_unique_array<float> denormalkillbuf;
 
     /**Sampling rate*/
@@ -342,6 +350,15 @@ struct SYNTH_T {
      */
     int oscilsize;
 
+    /**
+     * The number of samples between two updates of the envelopes and LFOs
+     * of the notes. With 0 they are updated once per buffer, otherwise
+     * buffers shorter than this period only get an update every few
+     * buffers, and longer buffers are rendered by the notes in blocks of
+     * about one period, see notebuffersize().
+     */
+    int controlperiod;
+
     //Alias for above terms
     float samplerate_f;
     float halfsamplerate_f;
@@ -353,6 +370,27 @@ struct SYNTH_T {
     {
         return buffersize_f / samplerate_f;
     }
+    /**Time between two envelope/LFO updates in seconds*/
+    float controldt(void) const
+    {
+        return controlperiod > 0 ? controlperiod / samplerate_f : dt();
+    }
+    /**Number of envelope/LFO updates per block of notebuffersize()*/
+    float controlticks(void) const
+    {
+        return controlperiod > 0 ? notebuffersize() / (float)controlperiod
+                                 : 1.0f;
+    }
+    /**
+     * Size of the blocks in which the notes are rendered, so that their
+     * envelopes and LFOs are read once per update: the largest divisor of
+     * the buffer size up to the control period. If that is below half the
+     * period (e.g. for a prime buffer size), the smallest divisor above
+     * the period is used instead.
+     */
+    int notebuffersize(void) const;
+    /**Settings of the notes, with a buffer of notebuffersize()*/
+    SYNTH_T noteSynth(void) const;
     void alias(bool randomize=true);
     static float numRandom(void); //defined in Util.cpp for now
 };
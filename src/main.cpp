@@ -41,6 +41,7 @@
 #include "Misc/Master.h"
 #include "Misc/Part.h"
 #include "Misc/Util.h"
+#include "Misc/XMLwrapper.h"
 #include "zyn-config.h"
 #include "zyn-version.h"
 
@@ -241,6 +242,7 @@ int main(int argc, char *argv[])
     synth.samplerate = config.cfg.SampleRate;
     synth.buffersize = config.cfg.SoundBufferSize;
     synth.oscilsize  = config.cfg.OscilSize;
+    synth.controlperiod = config.cfg.ControlPeriod;
     swaplr = config.cfg.SwapStereo;
     compr = config.cfg.AudioOutputCompressor;
 
@@ -320,6 +322,9 @@ int main(int argc, char *argv[])
         {
             "dump-json-schema", 2, NULL, 'D'
         },
+        {
+            "convert-binary", 1, NULL, 'C'
+        },
         // options without single char equivalents ("getopt_flag" compulsory)
         {
             "list-inputs", no_argument, &getopt_flag, 'i'
@@ -327,6 +332,9 @@ int main(int argc, char *argv[])
         {
             "list-outputs", no_argument, &getopt_flag, 'o'
         },
+        {
+            "pin-buffer-size", no_argument, &getopt_flag, 'B'
+        },
         {
             0, 0, 0, 0
         }
@@ -339,12 +347,14 @@ int main(int argc, char *argv[])
         help,
         version,
         list_inputs,
-        list_outputs
+        list_outputs,
+        converted
     };
     exit_with_t exit_with = exit_with_t::dont_exit;
     int preferred_port = -1;
     int auto_save_interval = 0;
     int wmidi = -1;
+    bool pin_buffer_size = false;
 
     string loadfile, loadinstrument, execAfterInit, loadmidilearn;
 
@@ -354,7 +364,7 @@ int main(int argc, char *argv[])
         /**\todo check this process for a small memory leak*/
         opt = getopt_long(argc,
                           argv,
-                          "l:L:M:r:b:o:I:O:N:e:P:A:d:D:hvapSDUYZ",
+                          "l:L:M:r:b:o:I:O:N:e:P:A:d:D:C:hvapSDUYZ",
                           opts,
                           &option_index);
         char *optarguments = optarg;
@@ -476,6 +486,24 @@ int main(int argc, char *argv[])
                     dump_json(outfile, MiddleWare::getAllPorts());
                 }
                 break;
+            case 'C':
+                if(optarguments)
+                {
+                    //convert in place, so banks keep finding the file
+                    XMLwrapper xml;
+                    const string tmpfile = string(optarguments) + ".tmp";
+                    if(xml.loadXMLfile(optarguments) < 0
+                       || xml.saveBinaryfile(tmpfile) < 0
+                       || rename(tmpfile.c_str(), optarguments)) {
+                        cerr << "ERROR:Could not convert " << optarguments
+                             << endl;
+                        remove(tmpfile.c_str());
+                    }
+                    else
+                        cout << "Converted " << optarguments << endl;
+                }
+                exit_with = exit_with_t::converted;
+                break;
             case 'Z':
                 if(optarguments)
                     wmidi = atoi(optarguments);
@@ -489,6 +517,9 @@ int main(int argc, char *argv[])
                     case 'o':
                         exit_with = exit_with_t::list_outputs;
                         break;
+                    case 'B':
+                        pin_buffer_size = true;
+                        break;
                 }
                 break;
             case '?':
@@ -498,6 +529,10 @@ int main(int argc, char *argv[])
         }
     }
 
+    //render in periods of the driver, so the output adds no latency
+    if(pin_buffer_size)
+        Nio::preferredBufferSize(synth.buffersize);
+
     synth.alias();
 
     switch (exit_with)
@@ -531,6 +566,10 @@ int main(int argc, char *argv[])
                  << "  -e , --exec-after-init\t\t Run post-initialization script\n"
                  << "  -d , --dump-oscdoc=FILE\t\t Dump oscdoc xml to file\n"
                  << "  -D , --dump-json-schema=FILE\t\t Dump osc schema (.json) to file\n"
+                 << "  -C , --convert-binary=FILE\t\t Convert a .xmz/.xiz file to the\n"
+                 << "\t\t\t\t\t binary format and exit\n"
+                 << "      --pin-buffer-size\t\t Use the period of a running JACK\n"
+                 << "\t\t\t\t\t server as buffer size (no added latency)\n"
                  << endl;
             break;
         case exit_with_t::list_inputs:
@@ -805,6 +844,7 @@ done:
         GUI::tickUi(gui);
 #endif // !WIN32
         middleware->tick();
+        Nio::idle();
 #ifdef WIN32
         Sleep(1);
 #endif